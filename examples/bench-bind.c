@@ -0,0 +1,123 @@
+/* benchmark a binding table against the callback it replaces
+ *
+ * usage: bench-bind [megabytes] [runs]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include "json.h"
+
+typedef struct {
+        int32_t id;
+        char name[16];
+        double score;
+        bool active;
+        char city[8];
+        int32_t zip;
+} record;
+
+typedef struct {
+        size_t n;
+        record r[];
+} table;
+
+static unsigned long seed=2019;
+static unsigned int lcg(void) {
+        seed=seed*1103515245+12345;
+        return (seed>>16) & 0x7FFF;
+}
+
+static size_t records(char *t,size_t max) {
+        size_t n=sprintf(t,"[");
+        int i;
+        for(i=0;n<max;i++) {
+                n+=sprintf(t+n,"%s{\"id\":%d,\"name\":\"user%u\",\"score\":%.2f,\"active\":%s,"
+                        "\"tags\":[\"a%u\",\"b%u\",\"c%u\"],\"address\":{\"city\":\"c%u\",\"zip\":%u}}",
+                        (i)?",":"",i,lcg(),lcg()/100.0,(lcg()%2)?"true":"false",lcg()%10,lcg()%10,lcg()%10,lcg()%100,lcg());
+        }
+        return n+sprintf(t+n,"]");
+}
+
+/* -- by hand -- */
+
+static void value(const json_valuecontext *root,const json_value *v,void *context) {
+        table *t=context;
+        record *r;
+        int64_t i;
+
+        if (!root->next || root->next->name.s) return;
+        if ((size_t)root->next->index>=t->n) t->n=root->next->index+1;
+        r=&t->r[root->next->index];
+        if (json_matches_path(root,"#","id",NULL)) {
+                if (json_value_to_int64(v,&i)) r->id=i;
+        }
+        else if (json_matches_path(root,"#","name",NULL)) json_string_to_utf8(r->name,sizeof(r->name),&v->string);
+        else if (json_matches_path(root,"#","score",NULL)) r->score=json_value_to_double(v);
+        else if (json_matches_path(root,"#","active",NULL)) r->active=v->truefalse;
+        else if (json_matches_path(root,"#","address","city",NULL)) json_string_to_utf8(r->city,sizeof(r->city),&v->string);
+        else if (json_matches_path(root,"#","address","zip",NULL)) {
+                if (json_value_to_int64(v,&i)) r->zip=i;
+        }
+}
+
+/* -- by table -- */
+
+static const json_binding fields[]={
+        {.path={"id"},.offset=offsetof(record,id),.type=json_bind_int32,.required=true},
+        {.path={"name"},.offset=offsetof(record,name),.type=json_bind_string,.size=16},
+        {.path={"score"},.offset=offsetof(record,score),.type=json_bind_double},
+        {.path={"active"},.offset=offsetof(record,active),.type=json_bind_bool},
+        {.path={"address","city"},.offset=offsetof(record,city),.type=json_bind_string,.size=8},
+        {.path={"address","zip"},.offset=offsetof(record,zip),.type=json_bind_int32},
+};
+
+static double now(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC,&ts);
+        return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+int main(int argc,char *argv[]) {
+        double mb=(argc>1)?atof(argv[1]):16;
+        int runs=(argc>2)?atoi(argv[2]):5;
+        size_t max=mb*1e6;
+        char *text=malloc(max+(1<<12));
+        size_t most=max/64;
+        table *t[2]={calloc(1,sizeof(table)+most*sizeof(record)),calloc(1,sizeof(table)+most*sizeof(record))};
+        json_binding top={.offset=offsetof(table,r),.type=json_bind_array,.size=sizeof(record),
+                .fields=fields,.nfields=sizeof(fields)/sizeof(*fields),.max=most,.count=offsetof(table,n)};
+        json_callbacks cb={.got_value=value};
+        json_querynode nodes[64];
+        json_binder b;
+        double start,best[2]={1e30,1e30};
+        size_t n;
+        int r;
+
+        if (!text || !t[0] || !t[1] || runs<1) return 1;
+        n=records(text,max);
+        cb.context=t[0];
+        if (!json_bind_init(&b,&top,1,nodes,64)) return 1;
+        for(r=0;r<runs;r++) {
+                t[0]->n=0;
+                start=now();
+                if (!json_parse_n(&cb,text,n)) return 1;
+                if (now()-start<best[0]) best[0]=now()-start;
+                start=now();
+                if (!json_bind_parse(&b,NULL,t[1],text,n)) return 1;
+                if (now()-start<best[1]) best[1]=now()-start;
+        }
+        if (t[0]->n!=t[1]->n || memcmp(t[0]->r,t[1]->r,t[0]->n*sizeof(record))!=0) {
+                printf("results differ\n");
+                return 1;
+        }
+        printf("%zu records, %.1f MB\n",t[0]->n,n/1e6);
+        printf("callback:      %6.1f MB/s\n",n/best[0]/1e6);
+        printf("binding table: %6.1f MB/s\n",n/best[1]/1e6);
+        free(text);
+        free(t[0]);
+        free(t[1]);
+        return 0;
+}
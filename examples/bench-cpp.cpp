@@ -0,0 +1,87 @@
+/* benchmark the C++ front end against a callback using json_matches_path()
+ *
+ * usage: bench-cpp [megabytes] [runs]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "json.hpp"
+
+using namespace stack_json;
+
+struct sums {
+        size_t ids,scores;
+        double total;
+        size_t tags;
+};
+
+static unsigned long seed=2019;
+static unsigned int lcg(void) {
+        seed=seed*1103515245+12345;
+        return (seed>>16) & 0x7FFF;
+}
+
+static size_t records(char *t,size_t max) {
+        size_t n=sprintf(t,"[");
+        for(int i=0;n<max;i++) {
+                n+=sprintf(t+n,"%s{\"id\":%d,\"name\":\"user%u\",\"score\":%.2f,\"active\":%s,"
+                        "\"tags\":[\"a%u\",\"b%u\",\"c%u\"],\"address\":{\"city\":\"c%u\",\"zip\":%u}}",
+                        (i)?",":"",i,lcg(),lcg()/100.0,(lcg()%2)?"true":"false",lcg()%10,lcg()%10,lcg()%10,lcg()%100,lcg());
+        }
+        return n+sprintf(t+n,"]");
+}
+
+static void value(const json_valuecontext *root,const json_value *v,void *context) {
+        sums *s=(sums *)context;
+        if (json_matches_path(root,"#","id",NULL)) s->ids++;
+        else if (json_matches_path(root,"#","score",NULL)) {s->scores++; s->total+=v->number;}
+        else if (json_matches_path(root,"#","tags","#1",NULL)) s->tags++;
+}
+
+static bool compiled(const char *text,size_t n,sums *s) {
+        return parse(nullptr,text,n,
+                on(path("#","id"),[s](const json_value &) {s->ids++;}),
+                on(path("#","score"),[s](const json_value &v) {s->scores++; s->total+=v.number;}),
+                on(path("#","tags",idx<1>),[s](const json_value &) {s->tags++;}));
+}
+
+static double now(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC,&ts);
+        return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+int main(int argc,char *argv[]) {
+        double mb=(argc>1)?atof(argv[1]):16;
+        int runs=(argc>2)?atoi(argv[2]):5;
+        size_t max=mb*1e6;
+        char *text=(char *)malloc(max+(1<<12));
+        double start,best[2]={1e30,1e30};
+        sums s[2];
+        json_callbacks cb={};
+        size_t n;
+
+        if (!text || runs<1) return 1;
+        n=records(text,max);
+        cb.got_value=value;
+        cb.context=&s[0];
+        for(int r=0;r<runs;r++) {
+                s[0]=s[1]=sums{};
+                start=now();
+                if (!json_parse_n(&cb,text,n)) return 1;
+                if (now()-start<best[0]) best[0]=now()-start;
+                start=now();
+                if (!compiled(text,n,&s[1])) return 1;
+                if (now()-start<best[1]) best[1]=now()-start;
+        }
+        if (s[0].ids!=s[1].ids || s[0].scores!=s[1].scores || s[0].tags!=s[1].tags) {
+                printf("results differ\n");
+                return 1;
+        }
+        printf("%zu records, %.1f MB\n",s[0].ids,n/1e6);
+        printf("callback:   %6.1f MB/s\n",n/best[0]/1e6);
+        printf("C++ paths:  %6.1f MB/s\n",n/best[1]/1e6);
+        free(text);
+        return 0;
+}
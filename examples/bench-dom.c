@@ -0,0 +1,89 @@
+/* benchmark: building a document tree in an arena, and memory per node */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+
+typedef struct {
+        char *s;
+        size_t n,max;
+} text;
+
+static void put(text *t,const char *s) {
+        size_t n=strlen(s);
+        if (t->n+n+1 > t->max) {
+                t->max=2*(t->n+n+1);
+                t->s=realloc(t->s,t->max);
+        }
+        memcpy(t->s+t->n,s,n+1);
+        t->n+=n;
+}
+
+/* An array of user records, each with a wide settings object. */
+static void corpus(text *t,int users) {
+        char tmp[256];
+        int i,j;
+        put(t,"[");
+        for(i=0;i<users;i++) {
+                snprintf(tmp,sizeof(tmp),"%s{\"id\":%d,\"name\":\"user %d\",\"tags\":[\"a\",\"b\",\"c\"],\"settings\":{",
+                        (i)?",":"",i,i);
+                put(t,tmp);
+                for(j=0;j<16;j++) {
+                        snprintf(tmp,sizeof(tmp),"%s\"option%d\":%d",(j)?",":"",j,(i+j)%3);
+                        put(t,tmp);
+                }
+                put(t,"}}");
+        }
+        put(t,"]");
+}
+
+static size_t count(const json_node *n) {
+        size_t c=1;
+        for(n=json_dom_first(n);n;n=n->next) c+=count(n);
+        return c;
+}
+
+int main(int argc,char *argv[]) {
+        int users=(argc>1)?atoi(argv[1]):20000;
+        int loops=(argc>2)?atoi(argv[2]):10;
+        size_t size=(size_t)users*4096;
+        text t={};
+        json_arena a;
+        json_node *root=NULL,*n;
+        char name[16][16];
+        clock_t start;
+        double secs,total=0;
+        size_t nodes;
+        int i;
+
+        corpus(&t,users);
+        json_arena_init(&a,malloc(size),size);
+
+        start=clock();
+        for(i=0;i<loops;i++) {
+                json_arena_reset(&a);
+                root=json_dom_parse(&a,NULL,t.s,t.n);
+                if (!root) return 1;
+        }
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        nodes=count(root);
+        printf("build   %zu bytes: %7.1f MB/s\n",t.n,(double)t.n*loops/secs/1e6);
+        printf("memory  %zu nodes, %zu arena bytes: %.1f bytes per node (node %zu, list %zu)\n",
+                nodes,a.used,(double)a.used/nodes,sizeof(json_node),sizeof(json_nodelist));
+
+        for(i=0;i<16;i++) snprintf(name[i],sizeof(name[i]),"option%d",i);
+        start=clock();
+        for(i=0;i<1000000;i++) {
+                n=json_dom_index(root,(int)((long long)i*7919%users));
+                n=json_dom_get(json_dom_get(n,"settings"),name[i%16]);
+                total+=n->value.number;
+        }
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("lookup  1000000 paths: %.0f ns each (total %g)\n",secs*1e3,total);
+
+        free(a.base);
+        free(t.s);
+        return 0;
+}
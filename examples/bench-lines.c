@@ -0,0 +1,53 @@
+/* benchmark: JSON Lines log records on 1..N threads */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "json.h"
+
+typedef struct {
+        double bytes[JSON_THREADS_MAX]; /* per worker, so no locking */
+} totals;
+
+static void sum(const json_valuecontext *root,const json_value *v,void *context) {
+        totals *t=context;
+        if (v->type==json_type_number && json_matches_path(root,"bytes",NULL))
+                t->bytes[json_worker_number(root)]+=v->number;
+}
+
+static double now(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC,&ts);
+        return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+int main(int argc,char *argv[]) {
+        size_t records=(argc>1)?strtoul(argv[1],NULL,10):500000;
+        int maxthreads=(argc>2)?atoi(argv[2]):(int)sysconf(_SC_NPROCESSORS_ONLN);
+        char *text=malloc(records*160);
+        static totals t;
+        json_callbacks cb={.context=&t,.got_value=sum};
+        size_t i,n=0;
+        double start,secs,total;
+        int threads,k;
+
+        for(i=0;i<records;i++) {
+                n+=sprintf(text+n,"{\"time\":\"2019-06-%02zuT12:%02zu:%02zuZ\",\"host\":\"web%zu\","
+                        "\"path\":\"/api/v1/items/%zu\",\"status\":%d,\"bytes\":%zu,\"ms\":%.3f}\n",
+                        1+i%28,i%60,i*7%60,i%16,i,(i%50)?200:404,1000+i*37%50000,(i%997)/7.0);
+        }
+        if (maxthreads<1) maxthreads=1;
+        printf("%zu records, %zu bytes, %d processors\n",records,n,(int)sysconf(_SC_NPROCESSORS_ONLN));
+        for(threads=1;threads<=maxthreads && threads<=JSON_THREADS_MAX;threads++) {
+                memset(&t,0,sizeof(t));
+                start=now();
+                if (!json_parse_lines(&cb,text,n,threads)) return 1;
+                secs=now()-start;
+                for(k=0,total=0;k<JSON_THREADS_MAX;k++) total+=t.bytes[k];
+                printf("%2d threads: %7.1f MB/s (total %g)\n",threads,n/secs/1e6,total);
+        }
+        free(text);
+        return 0;
+}
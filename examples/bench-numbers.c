@@ -0,0 +1,93 @@
+/* benchmark: a GeoJSON-style document that is mostly coordinates */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+
+typedef struct {
+        char *s;
+        size_t n,max;
+} text;
+
+static void put(text *t,const char *s) {
+        size_t n=strlen(s);
+        if (t->n+n+1 > t->max) {
+                t->max=2*(t->n+n+1);
+                t->s=realloc(t->s,t->max);
+        }
+        memcpy(t->s+t->n,s,n+1);
+        t->n+=n;
+}
+
+static unsigned long seed=12345;
+static unsigned int lcg(void) {
+        seed=seed*1103515245+12345;
+        return (seed>>16) & 0x7FFF;
+}
+
+/* Polygons of longitude/latitude pairs with full double precision. */
+static void corpus(text *t,int features) {
+        char tmp[64];
+        int i,j;
+        double lon,lat;
+        seed=12345;
+        put(t,"{\"type\":\"FeatureCollection\",\"features\":[");
+        for(i=0;i<features;i++) {
+                if (i) put(t,",");
+                snprintf(tmp,sizeof(tmp),"{\"type\":\"Feature\",\"id\":%d,",i); put(t,tmp);
+                put(t,"\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[");
+                lon=-180.0+lcg()*360.0/32768;
+                lat=-90.0+lcg()*180.0/32768;
+                for(j=0;j<32;j++) {
+                        lon+=(lcg()-16384)/1e7;
+                        lat+=(lcg()-16384)/1e7;
+                        snprintf(tmp,sizeof(tmp),"%s[%.15g,%.15g]",j?",":"",lon,lat); put(t,tmp);
+                }
+                put(t,"]]}}");
+        }
+        put(t,"]}");
+}
+
+static void sum(const json_valuecontext *root,const json_value *v,void *context) {
+        (void)root;
+        if (v->type==json_type_number) *(double *)context+=json_value_to_double(v);
+}
+
+/* A filter that reads only the feature ids. */
+static void ids(const json_valuecontext *root,const json_value *v,void *context) {
+        const json_valuecontext *c=root;
+        while(c->next) c=c->next;
+        if (v->type==json_type_number && json_matches_name(c,"id")) *(double *)context+=json_value_to_double(v);
+}
+
+static void run(const char *label,const text *t,int loops,int options,
+        void (*fn)(const json_valuecontext *,const json_value *,void *)) {
+        double total=0,secs;
+        json_callbacks cb={.context=&total,.got_value=fn,.options=options};
+        clock_t start;
+        int i;
+
+        start=clock();
+        for(i=0;i<loops;i++) {
+                if (!json_parse_n(&cb,t->s,t->n)) return;
+        }
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("%-12s %zu bytes: %7.1f MB/s (total %g)\n",label,t->n,(double)t->n*loops/secs/1e6,total/loops);
+}
+
+int main(int argc,char *argv[]) {
+        int features=(argc>1)?atoi(argv[1]):20000;
+        int loops=(argc>2)?atoi(argv[2]):10;
+        text t={};
+
+        corpus(&t,features);
+        printf("%d numbers\n",features*65);
+        run("sum",&t,loops,0,sum);
+        run("lazy sum",&t,loops,json_option_lazy_numbers,sum);
+        run("filter",&t,loops,0,ids);
+        run("lazy filter",&t,loops,json_option_lazy_numbers,ids);
+        free(t.s);
+        return 0;
+}
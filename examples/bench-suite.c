@@ -0,0 +1,254 @@
+/* benchmark suite: fixed corpora, reported one JSON line per result
+ *
+ * usage: bench-suite [megabytes per corpus] [runs] [directory to save corpora]
+ *
+ * Each corpus is generated from a fixed seed, so every build sees the same
+ * text.  Saved corpora (.json, or .ndjson for lines) can be given to other
+ * parsers to compare like with like.  The best of the runs is reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+
+typedef struct {
+        const char *path[4]; /* for json_matches_path(), NULL terminated */
+        size_t values,matched,chars;
+} counts;
+
+static unsigned long seed;
+static unsigned int lcg(void) {
+        seed=seed*1103515245+12345;
+        return (seed>>16) & 0x7FFF;
+}
+
+static const char *words[]={"alpha","beta","gamma","delta","caf\xC3\xA9","na\xC3\xAFve",
+        "\xE6\x97\xA5\xE6\x9C\xAC","tab\\t","\\\"quoted\\\"","line\\n","\\u00e9t\\u00e9","\\ud83d\\ude00"};
+#define WORDS (sizeof(words)/sizeof(*words))
+
+/* -- corpora -- */
+
+static size_t strings(char *t,size_t max) {
+        size_t n=sprintf(t,"[");
+        int i,k;
+        for(i=0;n<max;i++) {
+                n+=sprintf(t+n,"%s{\"id\":\"%d\",\"title\":\"",(i)?",":"",i);
+                for(k=lcg()%8;k>=0;k--) n+=sprintf(t+n,"%s ",words[lcg()%WORDS]);
+                n+=sprintf(t+n,"\",\"text\":\"");
+                for(k=20+lcg()%60;k>=0;k--) n+=sprintf(t+n,"%s ",words[lcg()%WORDS]);
+                n+=sprintf(t+n,"\"}");
+        }
+        return n+sprintf(t+n,"]");
+}
+
+static size_t numbers(char *t,size_t max) {
+        size_t n=sprintf(t,"[");
+        int i,k;
+        for(i=0;n<max;i++) {
+                n+=sprintf(t+n,"%s[",(i)?",":"");
+                for(k=0;k<8;k++) {
+                        if (k%4==0) n+=sprintf(t+n,"%s%d",(k)?",":"",(int)lcg()*(int)lcg()-(1<<28));
+                        else n+=sprintf(t+n,",%.*g",1+k*2,(lcg()-16384.0)*lcg()/(1+lcg()%1000));
+                }
+                n+=sprintf(t+n,"]");
+        }
+        return n+sprintf(t+n,"]");
+}
+
+static size_t nested(char *t,size_t max) {
+        size_t n=sprintf(t,"[");
+        int i,k,depth;
+        for(i=0;n<max;i++) {
+                depth=8+lcg()%56;
+                n+=sprintf(t+n,"%s",(i)?",":"");
+                for(k=0;k<depth;k++) n+=sprintf(t+n,(k%2)?"[%d,":"{\"k%d\":",k);
+                n+=sprintf(t+n,"true");
+                for(k=depth-1;k>=0;k--) n+=sprintf(t+n,(k%2)?"]":"}");
+        }
+        return n+sprintf(t+n,"]");
+}
+
+static size_t wide(char *t,size_t max) {
+        size_t n=sprintf(t,"[");
+        int i,k;
+        for(i=0;n<max;i++) {
+                n+=sprintf(t+n,"%s{",(i)?",":"");
+                for(k=0;k<1000;k++) n+=sprintf(t+n,"%s\"field%d\":%u",(k)?",":"",k,lcg());
+                n+=sprintf(t+n,"}");
+        }
+        return n+sprintf(t+n,"]");
+}
+
+static size_t literals(char *t,size_t max) {
+        static const char *words[]={"true","false","null"};
+        size_t n=sprintf(t,"[");
+        int i,k;
+        for(i=0;n<max;i++) {
+                n+=sprintf(t+n,"%s{\"ok\":%s,\"flags\":[",(i)?",":"",words[lcg()%3]);
+                for(k=0;k<16;k++) n+=sprintf(t+n,"%s%s",(k)?",":"",words[lcg()%3]);
+                n+=sprintf(t+n,"]}");
+        }
+        return n+sprintf(t+n,"]");
+}
+
+static size_t escapes(char *t,size_t max) {
+        size_t n=sprintf(t,"[");
+        int i,k;
+        for(i=0;n<max;i++) {
+                n+=sprintf(t+n,"%s\"",(i)?",":"");
+                for(k=8+lcg()%24;k>=0;k--) {
+                        if (lcg()%4) n+=sprintf(t+n,"\\u%04x",0xA0+lcg()%0x2000);
+                        else n+=sprintf(t+n,"\\ud83d\\ude%02x",lcg()%0x50);
+                }
+                n+=sprintf(t+n,"\"");
+        }
+        return n+sprintf(t+n,"]");
+}
+
+static size_t lines(char *t,size_t max) {
+        size_t n=0;
+        int i;
+        for(i=0;n<max;i++) {
+                n+=sprintf(t+n,"{\"time\":\"2019-06-%02dT12:%02d:%02dZ\",\"host\":\"web%d\","
+                        "\"path\":\"/api/v1/items/%d\",\"status\":%d,\"bytes\":%u,\"ms\":%.3f}\n",
+                        1+i%28,i%60,lcg()%60,lcg()%16,i,(lcg()%50)?200:404,1000+lcg(),lcg()/7.0);
+        }
+        return n;
+}
+
+static const struct {
+        const char *name;
+        size_t (*make)(char *t,size_t max);
+        const char *path[4];
+} corpora[]={
+        {"strings",strings,{"#","text"}},
+        {"numbers",numbers,{"#","#3"}},
+        {"nested",nested,{"#","k0","**"}},
+        {"wide",wide,{"#","field500"}},
+        {"ndjson",lines,{"bytes"}},
+        {"literals",literals,{"#","flags","#0"}},
+        {"escapes",escapes,{"#5"}},
+};
+#define CORPORA (sizeof(corpora)/sizeof(*corpora))
+
+/* -- callbacks -- */
+
+static void count(const json_valuecontext *root,const json_value *v,void *context) {
+        counts *c=context;
+        (void)root; (void)v;
+        c->values++;
+}
+
+static void filter(const json_valuecontext *root,const json_value *v,void *context) {
+        counts *c=context;
+        (void)v;
+        c->values++;
+        if (json_matches_path(root,c->path[0],c->path[1],c->path[2],c->path[3])) c->matched++;
+}
+
+/* As filter, but stopping at the first match. */
+static void first(const json_valuecontext *root,const json_value *v,void *context) {
+        counts *c=context;
+        (void)v;
+        c->values++;
+        if (json_matches_path(root,c->path[0],c->path[1],c->path[2],c->path[3])) {
+                c->matched++;
+                json_stop(root);
+        }
+}
+
+static void utf8(const json_valuecontext *root,const json_value *v,void *context) {
+        static char buf[4096];
+        counts *c=context;
+        (void)root;
+        c->values++;
+        if (v->type==json_type_string) c->chars+=json_string_to_utf8(buf,sizeof(buf),&v->string);
+}
+
+/* The counting callback as a loop over the pull reader. */
+static bool pull(const char *text,size_t n,counts *c) {
+        static json_valuecontext stack[128];
+        json_reader r;
+        json_event e;
+        json_reader_init(&r,NULL,text,n,stack,128);
+        do {
+                while(json_next(&r,&e)) c->values+=(e.type==json_event_value);
+        } while(e.type==json_event_end && e.at<text+n);
+        return e.type==json_event_end;
+}
+
+/* Modes without a callback use the pull reader. */
+static const struct {
+        const char *name;
+        void (*got_value)(const json_valuecontext *root,const json_value *v,void *context);
+} modes[]={
+        {"parse",count},
+        {"path",filter},
+        {"first",first},
+        {"utf8",utf8},
+        {"pull",NULL},
+};
+#define MODES (sizeof(modes)/sizeof(*modes))
+
+static double now(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC,&ts);
+        return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+int main(int argc,char *argv[]) {
+        double mb=(argc>1)?atof(argv[1]):4;
+        int runs=(argc>2)?atoi(argv[2]):5;
+        const char *dir=(argc>3)?argv[3]:NULL;
+        size_t max=mb*1e6;
+        char *text=malloc(max+(1<<16));
+        char file[1024];
+        FILE *f;
+        counts c;
+        json_callbacks cb={.context=&c};
+        const char *end;
+        size_t i,m,n,used;
+        double start,secs,best;
+        int r;
+
+        if (!text || runs<1) return 1;
+        for(i=0;i<CORPORA;i++) {
+                seed=2019+i;
+                n=corpora[i].make(text,max);
+                if (dir) {
+                        snprintf(file,sizeof(file),"%s/%s.%s",dir,corpora[i].name,(corpora[i].make==lines)?"ndjson":"json");
+                        if (!(f=fopen(file,"wb")) || fwrite(text,1,n,f)!=n || fclose(f)) {
+                                perror(file);
+                                return 1;
+                        }
+                }
+                for(m=0;m<MODES;m++) {
+                        cb.got_value=modes[m].got_value;
+                        for(r=0,best=1e30;r<runs;r++) {
+                                memset(&c,0,sizeof(c));
+                                memcpy(c.path,corpora[i].path,sizeof(c.path));
+                                used=n;
+                                start=now();
+                                if (!modes[m].got_value) {
+                                        if (!pull(text,n,&c)) return 1;
+                                }
+                                else if (corpora[i].make==lines) {
+                                        if (!json_parse_lines(&cb,text,n,1)) return 1;
+                                }
+                                else if (!(end=json_parse_n(&cb,text,n))) return 1;
+                                else used=end-text; /* less when stopped early */
+                                secs=now()-start;
+                                if (secs<best) best=secs;
+                        }
+                        printf("{\"corpus\":\"%s\",\"mode\":\"%s\",\"bytes\":%zu,\"values\":%zu,"
+                                "\"matched\":%zu,\"mb_per_s\":%.1f,\"values_per_s\":%.0f,\"ns_per_value\":%.2f}\n",
+                                corpora[i].name,modes[m].name,used,c.values,c.matched,
+                                used/best/1e6,c.values/best,best*1e9/c.values);
+                        fflush(stdout);
+                }
+        }
+        free(text);
+        return 0;
+}
@@ -0,0 +1,98 @@
+/* benchmark: many path lookups in one document, parsing each time or
+ * building a tape once
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+
+typedef struct {
+        char *s;
+        size_t n,max;
+} text;
+
+static void put(text *t,const char *s) {
+        size_t n=strlen(s);
+        if (t->n+n+1 > t->max) {
+                t->max=2*(t->n+n+1);
+                t->s=realloc(t->s,t->max);
+        }
+        memcpy(t->s+t->n,s,n+1);
+        t->n+=n;
+}
+
+/* An array of user records. */
+static void corpus(text *t,int users) {
+        char tmp[256];
+        int i;
+        put(t,"{\"users\":[");
+        for(i=0;i<users;i++) {
+                snprintf(tmp,sizeof(tmp),"%s{\"id\":%d,\"name\":\"user %d\",\"tags\":[\"a\",\"b\",\"c\"],"
+                        "\"address\":{\"street\":\"%d Main St\",\"zip\":\"%05d\"},\"score\":%d.25}",
+                        (i)?",":"",i,i,i,i*7%100000,i%1000);
+                put(t,tmp);
+        }
+        put(t,"]}");
+}
+
+typedef struct {
+        char index[16];
+        double total;
+} lookup;
+
+static void want_zip(const json_valuecontext *root,const json_value *v,void *context) {
+        lookup *l=context;
+        if (v->type==json_type_string && json_matches_path(root,"users",l->index,"address","zip",NULL))
+                l->total+=atoi(v->string.s);
+}
+
+int main(int argc,char *argv[]) {
+        int users=(argc>1)?atoi(argv[1]):20000;
+        int queries=(argc>2)?atoi(argv[2]):100;
+        text t={};
+        lookup l={};
+        json_callbacks cb={.context=&l,.got_value=want_zip};
+        json_tapeentry *entries;
+        uint32_t *index;
+        json_tape tape;
+        json_cursor c;
+        json_value v;
+        clock_t start;
+        double secs,total;
+        int i;
+
+        corpus(&t,users);
+        index=malloc((t.n+1)*sizeof(*index));
+        entries=malloc((t.n+1)*sizeof(*entries));
+
+        start=clock();
+        for(i=0;i<queries;i++) {
+                snprintf(l.index,sizeof(l.index),"#%d",i*7919%users);
+                json_parse_n(&cb,t.s,t.n);
+        }
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("parse each   %zu bytes, %d queries: %8.3f ms (total %g)\n",t.n,queries,secs*1e3,l.total);
+
+        start=clock();
+        total=0;
+        if (!json_tape_build(&tape,NULL,t.s,t.n,index,t.n+1,entries,t.n+1)) return 1;
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("tape build   %zu bytes, %zu entries: %8.3f ms (%.1f MB/s)\n",t.n,tape.used,secs*1e3,t.n/secs/1e6);
+        start=clock();
+        for(i=0;i<queries;i++) {
+                snprintf(l.index,sizeof(l.index),"#%d",i*7919%users);
+                c=json_tape_cursor(&tape);
+                if (!json_cursor_find(&c,"users",l.index,"address","zip",NULL)) return 1;
+                json_cursor_value(&c,&v);
+                total+=atoi(v.string.s);
+        }
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("tape lookup  %zu bytes, %d queries: %8.3f ms (total %g)\n",t.n,queries,secs*1e3,total);
+
+        free(entries);
+        free(index);
+        free(t.s);
+        return 0;
+}
@@ -0,0 +1,51 @@
+/* benchmark: converting strings to UTF-8, byte at a time and in bulk */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+
+int main(int argc,char *argv[]) {
+        int len=(argc>1)?atoi(argv[1]):200;
+        int loops=(argc>2)?atoi(argv[2]):200000;
+        char *text=malloc(len+16),*out=malloc(len+16),*copy=malloc(len+16);
+        json_nchar in;
+        clock_t start;
+        double secs;
+        size_t total=0;
+        int i,n,k;
+
+        /* prose with an escape or emoji now and then */
+        for(n=0;n<len;) {
+                if (n%97==50) n+=sprintf(text+n,"\\n");
+                else if (n%251==120) n+=sprintf(text+n,"\\ud83d\\ude00");
+                else {text[n]="lorem ipsum "[n%12]; n++;}
+        }
+        in.s=text;
+        in.n=n;
+
+        start=clock();
+        for(i=0;i<loops;i++) total+=json_string_to_utf8(out,n,&in);
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("byte at a time  %d bytes: %7.1f MB/s\n",n,(double)n*loops/secs/1e6);
+
+        start=clock();
+        for(i=0;i<loops;i++) total+=json_string_to_utf8(out,n+1,&in);
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("bulk            %d bytes: %7.1f MB/s\n",n,(double)n*loops/secs/1e6);
+
+        start=clock();
+        for(i=0;i<loops;i++) {
+                memcpy(copy,text,n);
+                k=n;
+                if (json_string_in_place(copy,&k)) total+=k;
+        }
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("in place (+copy) %d bytes: %7.1f MB/s (total %zu)\n",n,(double)n*loops/secs/1e6,total);
+
+        free(text);
+        free(out);
+        free(copy);
+        return 0;
+}
@@ -0,0 +1,55 @@
+/* benchmark: the cost of json_option_validate_utf8 on ASCII and on CJK text */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "json.h"
+
+static void ignore(const json_valuecontext *c,const json_value *v,void *context) {
+        (void)c; (void)v; (void)context;
+}
+
+static void run(const char *what,const char *text,size_t n,int loops) {
+        json_callbacks cb={.got_value=ignore};
+        clock_t start;
+        double secs[2];
+        int opt,i;
+        for(opt=0;opt<2;opt++) {
+                cb.options=(opt)?json_option_validate_utf8:0;
+                start=clock();
+                for(i=0;i<loops;i++) json_parse_n(&cb,text,n);
+                secs[opt]=(double)(clock()-start)/CLOCKS_PER_SEC;
+        }
+        printf("%-6s %zu bytes: %7.1f MB/s, validating %7.1f MB/s\n",
+                what,n,(double)n*loops/secs[0]/1e6,(double)n*loops/secs[1]/1e6);
+}
+
+int main(int argc,char *argv[]) {
+        int records=(argc>1)?atoi(argv[1]):100000;
+        int loops=(argc>2)?atoi(argv[2]):10;
+        char *text=malloc((size_t)records*200+4096);
+        size_t n;
+        int i,k;
+
+        /* short ASCII strings, as in most records */
+        n=sprintf(text,"[");
+        for(i=0;i<records;i++) {
+                n+=sprintf(text+n,"%s{\"name\":\"user %d\",\"text\":\"lorem ipsum dolor sit amet, consectetur %d\",\"n\":%d}",
+                        (i)?",":"",i,i,i);
+        }
+        n+=sprintf(text+n,"]");
+        run("ASCII",text,n,loops);
+
+        /* long strings of three-byte characters */
+        n=sprintf(text,"[");
+        for(i=0;i<records/50;i++) {
+                n+=sprintf(text+n,"%s\"",(i)?",":"");
+                for(k=0;k<800;k++) n+=sprintf(text+n,"%s",(k%8)?"\xE6\x97\xA5":"a ");
+                n+=sprintf(text+n,"\"");
+        }
+        n+=sprintf(text+n,"]");
+        run("CJK",text,n,loops);
+
+        free(text);
+        return 0;
+}
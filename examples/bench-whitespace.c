@@ -0,0 +1,102 @@
+/* benchmark: the same corpus minified and pretty-printed */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+
+typedef struct {
+        char *s;
+        size_t n,max;
+} text;
+
+static void put(text *t,const char *s) {
+        size_t n=strlen(s);
+        if (t->n+n+1 > t->max) {
+                t->max=2*(t->n+n+1);
+                t->s=realloc(t->s,t->max);
+        }
+        memcpy(t->s+t->n,s,n+1);
+        t->n+=n;
+}
+
+static void newline(text *t,int pretty,int depth) {
+        if (!pretty) return;
+        put(t,"\n");
+        while(depth-->0) put(t,"        ");
+}
+
+static unsigned long seed=12345;
+static unsigned int lcg(void) {
+        seed=seed*1103515245+12345;
+        return (seed>>16) & 0x7FFF;
+}
+
+/* An array of records, each with scalars, a nested object and a short list. */
+static void corpus(text *t,int pretty,int records) {
+        char tmp[64];
+        int i,j;
+        seed=12345;
+        put(t,"[");
+        for(i=0;i<records;i++) {
+                if (i) put(t,",");
+                newline(t,pretty,1); put(t,"{");
+                newline(t,pretty,2); snprintf(tmp,sizeof(tmp),"\"id\":%s%d,",pretty?" ":"",i); put(t,tmp);
+                newline(t,pretty,2); snprintf(tmp,sizeof(tmp),"\"name\":%s\"item%u\",",pretty?" ":"",lcg()); put(t,tmp);
+                newline(t,pretty,2); put(t,pretty?"\"active\": true,":"\"active\":true,");
+                newline(t,pretty,2); put(t,pretty?"\"where\": {":"\"where\":{");
+                newline(t,pretty,3); snprintf(tmp,sizeof(tmp),"\"x\":%s%u.%u,",pretty?" ":"",lcg(),lcg()%100); put(t,tmp);
+                newline(t,pretty,3); snprintf(tmp,sizeof(tmp),"\"y\":%s%u.%u",pretty?" ":"",lcg(),lcg()%100); put(t,tmp);
+                newline(t,pretty,2); put(t,"},");
+                newline(t,pretty,2); put(t,pretty?"\"tags\": [":"\"tags\":[");
+                for(j=0;j<4;j++) {
+                        if (j) put(t,",");
+                        newline(t,pretty,3); snprintf(tmp,sizeof(tmp),"\"t%u\"",lcg()%50); put(t,tmp);
+                }
+                newline(t,pretty,2); put(t,"]");
+                newline(t,pretty,1); put(t,"}");
+        }
+        newline(t,pretty,0);
+        put(t,"]");
+}
+
+static void count(const json_valuecontext *root,const json_value *v,void *context) {
+        (void)root; (void)v;
+        (*(long *)context)++;
+}
+
+static double run(const char *label,const text *t,int loops) {
+        long values=0;
+        json_callbacks cb={.context=&values,.got_value=count};
+        clock_t start,stop;
+        double secs,mbs;
+        int i;
+
+        start=clock();
+        for(i=0;i<loops;i++) {
+                if (!json_parse(&cb,t->s)) return 0;
+        }
+        stop=clock();
+        secs=(double)(stop-start)/CLOCKS_PER_SEC;
+        mbs=(double)t->n*loops/secs/1e6;
+        printf("%-8s %10zu bytes %8ld values %9.1f MB/s %9.1f Mvalues/s\n",
+                label,t->n,values/loops,mbs,values/secs/1e6);
+        return mbs;
+}
+
+int main(int argc,char *argv[]) {
+        int records=(argc>1)?atoi(argv[1]):20000;
+        int loops=(argc>2)?atoi(argv[2]):20;
+        text minified={},pretty={};
+
+        corpus(&minified,0,records);
+        corpus(&pretty,1,records);
+
+        run("minified",&minified,loops);
+        run("pretty",&pretty,loops);
+
+        free(minified.s);
+        free(pretty.s);
+        return 0;
+}
@@ -0,0 +1,71 @@
+/* benchmark: writing JSON against reading it back */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+
+static void ignore(const json_valuecontext *c,const json_value *v,void *context) {
+        (void)c; (void)v; (void)context;
+}
+
+/* Log records with integers, doubles, strings and a nested array. */
+static void records(json_writer *w,int n) {
+        static char host[16][32];
+        int i,k;
+        for(i=0;i<16;i++) snprintf(host[i],sizeof(host[i]),"web%d.example.com",i);
+        json_write_begin_array(w);
+        for(i=0;i<n;i++) {
+                json_write_begin_object(w);
+                json_write_key(w,"id",2);
+                json_write_integer(w,i);
+                json_write_key(w,"host",4);
+                json_write_string(w,host[i%16],strlen(host[i%16]));
+                json_write_key(w,"path",4);
+                json_write_string(w,"/api/v1/items?q=\"a b\"",21);
+                json_write_key(w,"ms",2);
+                json_write_number(w,(i%997)/7.0);
+                json_write_key(w,"score",5);
+                json_write_number(w,i*1.0e-3+0.1);
+                json_write_key(w,"ok",2);
+                json_write_bool(w,i%50!=0);
+                json_write_key(w,"tags",4);
+                json_write_begin_array(w);
+                for(k=0;k<3;k++) json_write_integer(w,(i+k)%100);
+                json_write_end_array(w);
+                json_write_end_object(w);
+        }
+        json_write_end_array(w);
+}
+
+int main(int argc,char *argv[]) {
+        int n=(argc>1)?atoi(argv[1]):200000;
+        int loops=(argc>2)?atoi(argv[2]):10;
+        size_t size=(size_t)n*200+64;
+        char *buf=malloc(size);
+        json_callbacks cb={.got_value=ignore};
+        json_writer w;
+        clock_t start;
+        double secs;
+        int i;
+
+        start=clock();
+        for(i=0;i<loops;i++) {
+                json_writer_init(&w,buf,size);
+                records(&w,n);
+                if (!json_writer_finish(&w)) return 1;
+        }
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("write %zu bytes: %7.1f MB/s\n",w.used,(double)w.used*loops/secs/1e6);
+
+        start=clock();
+        for(i=0;i<loops;i++) {
+                if (!json_parse_n(&cb,buf,w.used)) return 1;
+        }
+        secs=(double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("read  %zu bytes: %7.1f MB/s\n",w.used,(double)w.used*loops/secs/1e6);
+
+        free(buf);
+        return 0;
+}
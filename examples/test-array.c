@@ -0,0 +1,146 @@
+/* test parsing one big array on several threads */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json.h"
+
+/* Values are summed as hashes of their path and text, so the order they
+ * arrive in does not matter.
+ */
+typedef struct {
+        unsigned long long sum;
+        int values,begins,ends,matched,errors;
+} result;
+
+static unsigned long long hash(unsigned long long h,const char *s,int n) {
+        int i;
+        for(i=0;i<n;i++) h=(h^(unsigned char)s[i])*1099511628211ULL;
+        return h;
+}
+
+static void got(const json_valuecontext *root,const json_value *v,void *context) {
+        result *r=context;
+        const json_valuecontext *c;
+        unsigned long long h=14695981039346656037ULL;
+        char tmp[64];
+        for(c=root->next;c;c=c->next) {
+                if (c->name.s) h=hash(h,c->name.s,c->name.n);
+                else h=hash(h,tmp,snprintf(tmp,sizeof(tmp),"#%d",c->index));
+        }
+        switch(v->type) {
+        case json_type_string: h=hash(h,v->string.s,v->string.n); break;
+        case json_type_number: h=hash(h,tmp,snprintf(tmp,sizeof(tmp),"%.17g",v->number)); break;
+        case json_type_bool:   h=hash(h,(v->truefalse)?"t":"f",1); break;
+        default:               h=hash(h,"n",1); break;
+        }
+        __atomic_fetch_add(&r->sum,h,__ATOMIC_RELAXED);
+        __atomic_fetch_add(&r->values,1,__ATOMIC_RELAXED);
+}
+
+static void begin_array(const json_valuecontext *root,json_in start,void *context) {
+        result *r=context;
+        (void)start;
+        if (!root->next) r->begins++;
+}
+
+static void end_array(const json_valuecontext *root,json_in start,json_in end,void *context) {
+        result *r=context;
+        (void)start; (void)end;
+        if (!root->next) r->ends++;
+}
+
+static void seventh(const json_valuecontext *root,const json_value *v,void *context) {
+        result *r=context;
+        (void)root;
+        if (v->type==json_type_number && v->number==7) __atomic_fetch_add(&r->matched,1,__ATOMIC_RELAXED);
+}
+
+static void counterr(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        result *r=context;
+        (void)c; (void)etype; (void)s; (void)p; (void)msg;
+        __atomic_fetch_add(&r->errors,1,__ATOMIC_RELAXED);
+}
+
+static unsigned long seed=12345;
+static unsigned int lcg(void) {
+        seed=seed*1103515245+12345;
+        return (seed>>16) & 0x7FFF;
+}
+
+/* Strings full of the characters the split must not be fooled by. */
+static int nasty(char *out) {
+        static const char *bits[]={"\\\"","\\\\","],[","{","}",",","\\\\\\\"",":","x","\\n","[[","]]"};
+        int n=0,k=lcg()%8;
+        out[n++]='\"';
+        while(k--) n+=sprintf(out+n,"%s",bits[lcg()%12]);
+        out[n++]='\"';
+        return n;
+}
+
+int main(void) {
+        static char text[400000];
+        static const char *bad[]={
+                "[1,2", "[1,,2]", "[1 2]", "[\"],[\"]]", "[[1,2],3]]", "[1,2,]", "[,]",
+                "[{\"a\":1},{\"b\":}]", " [1] x", "[\"unterminated]",
+        };
+        json_querynode nodes[8];
+        json_queries q;
+        result want,r;
+        json_callbacks cb={.context=&r,.got_value=got,.error=counterr,
+                .begin_array=begin_array,.end_array=end_array,.queries=&q};
+        int goodc=0,badc=0;
+        int threads,i,n,round;
+        size_t b;
+
+        json_query_init(&q,nodes,8);
+        json_query_compile(&q,seventh,&r,"#7","id",NULL);
+
+        for(round=0;round<3;round++) {
+                n=sprintf(text,"%s[",(round==1)?"  \n":"");
+                for(i=0;i<((round==2)?1:3000);i++) {
+                        if (i) n+=sprintf(text+n,",%s",(i%3)?"":" \n ");
+                        n+=sprintf(text+n,"{\"id\":%d,\"s\":",i);
+                        n+=nasty(text+n);
+                        n+=sprintf(text+n,",\"a\":[[%d,",i%5);
+                        n+=nasty(text+n);
+                        n+=sprintf(text+n,"],{\"%s\":null}],\"t\":true}",(i%2)?"k,":"]");
+                }
+                n+=sprintf(text+n,"]%s",(round==1)?" \r\n":"");
+
+                memset(&want,0,sizeof(want));
+                cb.context=&want;
+                if (json_parse_n(&cb,text,n)!=text+n) badc++;
+                for(threads=1;threads<=16;threads++) {
+                        memset(&r,0,sizeof(r));
+                        cb.context=&r;
+                        if (json_parse_array(&cb,text,n,threads) && r.sum==want.sum && r.values==want.values &&
+                            r.begins==1 && r.ends==1 && r.errors==0 && r.matched==(round==2?0:1)) goodc++;
+                        else {
+                                badc++;
+                                printf("FAIL (round %d, %d threads): values %d/%d, begins %d, ends %d, errors %d, matched %d\n",
+                                        round,threads,r.values,want.values,r.begins,r.ends,r.errors,r.matched);
+                        }
+                }
+        }
+
+        /* not arrays, empty arrays, and broken ones */
+        cb.context=&r;
+        memset(&r,0,sizeof(r));
+        if (json_parse_array(&cb,"{\"a\":[1]}",9,4) && r.values==1 && json_parse_array(&cb," [ ] ",5,4) &&
+            json_parse_array(&cb,"[]",2,4) && r.begins==2 && r.ends==2) goodc++; else badc++;
+        for(b=0;b<sizeof(bad)/sizeof(*bad);b++) {
+                for(threads=1;threads<=4;threads+=3) {
+                        memset(&r,0,sizeof(r));
+                        if (!json_parse_array(&cb,bad[b],strlen(bad[b]),threads) && r.errors>0) goodc++;
+                        else {
+                                badc++;
+                                printf("FAIL: accepted %s\n",bad[b]);
+                        }
+                }
+        }
+
+        printf("Array test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,203 @@
+/* test binding tables */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "json.h"
+
+typedef struct {
+        int32_t x,y;
+} point;
+
+typedef struct {
+        int32_t id;
+        char name[8];
+        bool admin;
+        point points[4];
+        size_t npoints;
+} user;
+
+typedef struct {
+        double version;
+        int64_t big;
+        char title[32];
+        user users[3];
+        size_t nusers;
+        int32_t scores[4];
+        size_t nscores;
+        int32_t deep;
+        int32_t any;
+} doc;
+
+static const json_binding points[]={
+        {.path={"#0"},.offset=offsetof(point,x),.type=json_bind_int32,.required=true},
+        {.path={"#1"},.offset=offsetof(point,y),.type=json_bind_int32,.required=true},
+};
+
+static const json_binding users[]={
+        {.path={"id"},.offset=offsetof(user,id),.type=json_bind_int32,.required=true},
+        {.path={"name"},.offset=offsetof(user,name),.type=json_bind_string,.size=sizeof(((user *)0)->name)},
+        {.path={"admin"},.offset=offsetof(user,admin),.type=json_bind_bool},
+        {.path={"points"},.offset=offsetof(user,points),.type=json_bind_array,.size=sizeof(point),
+                .fields=points,.nfields=2,.max=4,.count=offsetof(user,npoints)},
+};
+
+static const json_binding scores[]={
+        {.type=json_bind_int32},
+};
+
+static const json_binding fields[]={
+        {.path={"version"},.offset=offsetof(doc,version),.type=json_bind_double,.required=true},
+        {.path={"big"},.offset=offsetof(doc,big),.type=json_bind_int64},
+        {.path={"meta","title"},.offset=offsetof(doc,title),.type=json_bind_string,.size=sizeof(((doc *)0)->title)},
+        {.path={"users"},.offset=offsetof(doc,users),.type=json_bind_array,.size=sizeof(user),.required=true,
+                .fields=users,.nfields=4,.max=3,.count=offsetof(doc,nusers)},
+        {.path={"scores"},.offset=offsetof(doc,scores),.type=json_bind_array,.size=sizeof(int32_t),
+                .fields=scores,.nfields=1,.max=4,.count=offsetof(doc,nscores)},
+        {.path={"a","b","c","d"},.offset=offsetof(doc,deep),.type=json_bind_int32},
+        {.path={"*","n"},.offset=offsetof(doc,any),.type=json_bind_int32},
+};
+#define FIELDS (int)(sizeof(fields)/sizeof(*fields))
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg;
+        (*(int *)context)++;
+}
+
+static const char *parse(json_binder *b,doc *d,const char *text) {
+        memset(d,0x55,sizeof(*d)); /* bindings must not need a clean struct */
+        return json_bind_parse(b,NULL,d,text,strlen(text));
+}
+
+int main(void) {
+        const char *text=
+                "{\"version\":1.5,\"big\":9007199254740993,\"meta\":{\"title\":\"caf\\u00e9 \\\"x\\\"\"},"
+                "\"users\":[{\"id\":1,\"name\":\"ann\",\"admin\":true,\"points\":[[1,2],[3,4]],\"other\":[5]},"
+                "{\"name\":\"bob\",\"id\":2,\"points\":[]},"
+                "{\"id\":3,\"admin\":false,\"points\":[[5,6]],\"name\":null}],"
+                "\"scores\":[7,8,9],\"a\":{\"b\":{\"c\":{\"d\":42}}},\"z\":{\"n\":-1},\"junk\":[{},[],\"x\"]}";
+        json_querynode nodes[64];
+        json_binder b;
+        doc d;
+        int goodc=0,badc=0,errors=0;
+        json_callbacks cb={.error=quiet,.context=&errors};
+
+        if (json_bind_init(&b,fields,FIELDS,nodes,64)) goodc++;
+        else {
+                badc++;
+                printf("FAIL: init\n");
+        }
+
+        if (parse(&b,&d,text)==text+strlen(text) && !b.bad) goodc++;
+        else {
+                badc++;
+                printf("FAIL: parse\n");
+        }
+        if (d.version==1.5 && d.big==9007199254740993LL && strcmp(d.title,"caf\xC3\xA9 \"x\"")==0 &&
+            d.deep==42 && d.any==-1) goodc++;
+        else {
+                badc++;
+                printf("FAIL: fields %g %lld \"%s\" %d %d\n",d.version,(long long)d.big,d.title,d.deep,d.any);
+        }
+        if (d.nusers==3 && d.users[0].id==1 && strcmp(d.users[0].name,"ann")==0 && d.users[0].admin &&
+            d.users[1].id==2 && strcmp(d.users[1].name,"bob")==0 &&
+            d.users[2].id==3 && !d.users[2].admin) goodc++;
+        else {
+                badc++;
+                printf("FAIL: users\n");
+        }
+        if (d.users[0].npoints==2 && d.users[0].points[0].x==1 && d.users[0].points[0].y==2 &&
+            d.users[0].points[1].x==3 && d.users[0].points[1].y==4 &&
+            d.users[1].npoints==0 && d.users[2].npoints==1 && d.users[2].points[0].x==5 &&
+            d.users[2].points[0].y==6) goodc++;
+        else {
+                badc++;
+                printf("FAIL: points\n");
+        }
+        if (d.nscores==3 && d.scores[0]==7 && d.scores[1]==8 && d.scores[2]==9) goodc++;
+        else {
+                badc++;
+                printf("FAIL: scores\n");
+        }
+
+        /* what goes wrong, and which binding it was */
+        static const struct {
+                const char *text;
+                const json_binding *bad;
+        } bad[]={
+                {"{\"users\":[{\"id\":1}]}",&fields[0]},                         /* no version */
+                {"{\"version\":1}",&fields[3]},                                  /* no users */
+                {"{\"version\":1,\"users\":[{\"id\":1},{\"name\":\"x\"}]}",&users[0]}, /* one without id */
+                {"{\"version\":1,\"users\":[{\"id\":1},{}]}",&users[0]},           /* an empty one */
+                {"{\"version\":1,\"users\":[{\"id\":1,\"id\":2},{\"name\":\"x\"}]}",&users[0]}, /* id twice in one */
+                {"{\"version\":\"1\",\"users\":[{\"id\":1}]}",&fields[0]},       /* wrong type */
+                {"{\"version\":1,\"users\":[{\"id\":1.5}]}",&users[0]},
+                {"{\"version\":1,\"users\":[{\"id\":3000000000}]}",&users[0]},
+                {"{\"version\":1,\"users\":[{\"id\":1,\"name\":\"too long\"}]}",&users[1]},
+                {"{\"version\":1,\"users\":[{\"id\":1},{\"id\":2},{\"id\":3},{\"id\":4}]}",&fields[3]}, /* too many */
+                {"{\"version\":1,\"users\":[{\"id\":1,\"points\":[[1]]}]}",&points[1]},
+                {"{\"version\":1,\"users\":[{\"id\":1}],\"scores\":[1,2,3,4,5]}",&fields[4]},
+        };
+        for(size_t i=0;i<sizeof(bad)/sizeof(*bad);i++) {
+                if (!parse(&b,&d,bad[i].text) && b.bad==bad[i].bad) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: %s: binding %d\n",bad[i].text,(b.bad)?(int)(b.bad-fields):-1);
+                }
+        }
+
+        /* elements are counted when they end, even with nothing bound in them */
+        if (parse(&b,&d,"{\"version\":1,\"users\":[{\"id\":1,\"x\":2}],\"scores\":[7,null,[]]}") &&
+            d.nusers==1 && d.users[0].npoints==0 && d.nscores==3 && d.scores[0]==7) goodc++;
+        else {
+                badc++;
+                printf("FAIL: counts %zu %zu\n",d.nusers,d.nscores);
+        }
+
+        /* a syntax error is reported as by json_parse_n() */
+        if (!json_bind_parse(&b,&cb,&d,"{\"version\":1,",13) && !b.bad && errors==1) goodc++; else badc++;
+
+        /* so is more match state than the queries have room for */
+        {
+                static const json_binding many[]={
+                        {.path={"**"},.type=json_bind_int32},
+                        {.path={"*","**"},.type=json_bind_int32},
+                        {.path={"*","*","**"},.type=json_bind_int32},
+                        {.path={"*","*","*","**"},.type=json_bind_int32},
+                        {.path={"*","*","*","*","**"},.type=json_bind_int32},
+                        {.path={"*","*","*","*","*","**"},.type=json_bind_int32},
+                        {.path={"*","*","*","*","*","*","**"},.type=json_bind_int32},
+                        {.path={"*","*","*","*","*","*","*","**"},.type=json_bind_int32},
+                };
+                char deep[256];
+                int n=0,k;
+                int32_t x;
+
+                for(k=0;k<40;k++) n+=sprintf(deep+n,"{\"a\":");
+                n+=sprintf(deep+n,"1");
+                for(k=0;k<40;k++) n+=sprintf(deep+n,"}");
+                if (json_bind_init(&b,many,8,nodes,64) && !json_bind_parse(&b,&cb,&x,deep,n) && errors==2) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: too many states: %d\n",errors);
+                }
+        }
+
+        /* invalid tables */
+        {
+                static const json_binding rest[]={
+                        {.path={"**","x"},.type=json_bind_int32},
+                };
+                static const json_binding array[]={
+                        {.path={"a","**"},.type=json_bind_array,.size=4,.fields=scores,.nfields=1,.max=4},
+                };
+                json_querynode few[4];
+                if (!json_bind_init(&b,rest,1,nodes,64) && !json_bind_init(&b,array,1,nodes,64) &&
+                    !json_bind_init(&b,fields,FIELDS,few,4)) goodc++;
+                else badc++;
+        }
+
+        printf("Bind test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,136 @@
+/* test the C++ front end against json_matches_path() */
+
+#include <cstdio>
+#include <cstring>
+#include "json.hpp"
+
+using namespace stack_json;
+
+/* The paths, for json_matches_path(). */
+static const char *paths[][4]={
+        {NULL},
+        {"johnny",NULL},
+        {"johnny","#5",NULL},
+        {"johnny","#",NULL},
+        {"*","#1",NULL},
+        {"a","**",NULL},
+        {"**",NULL},
+        {"a","b","c",NULL},
+};
+#define PATHS (sizeof(paths)/sizeof(*paths))
+
+struct counts {
+        int n[PATHS];
+};
+
+static void value(const json_valuecontext *root,const json_value *v,void *context) {
+        counts *c=(counts *)context;
+        (void)v;
+        for(size_t i=0;i<PATHS;i++) {
+                if (json_matches_path(root,paths[i][0],paths[i][1],paths[i][2],paths[i][3])) c->n[i]++;
+        }
+}
+
+/* The same paths, known when compiling. */
+static bool pulled(const char *doc,counts *c) {
+        auto count=[c](int i) {return [c,i](const json_value &) {c->n[i]++;};};
+        return parse(doc,
+                on(path(),count(0)),
+                on(path("johnny"),count(1)),
+                on(path("johnny",idx<5>),count(2)),
+                on(path("johnny","#"),count(3)),
+                on(path("*",1),count(4)),
+                on(path("a","**"),count(5)),
+                on(path("**"),count(6)),
+                on(path("a","b","c"),count(7)));
+}
+
+int main(void) {
+        static const char *docs[]={
+                "{\"johnny\":[0,1,2,3,4,5,6]}",
+                "{\"johnny\":{\"5\":5},\"johnnyy\":[0,1,2,3,4,5]}",
+                "{\"a\":{\"b\":{\"c\":1,\"d\":[1,2]}},\"b\":[3,[4,5]]}",
+                "[1,[2,3],{\"a\":4}]",
+                "\"top\"",
+                "{\"a\":1} {\"a\":{\"b\":{\"c\":2}}}\n",
+        };
+        int goodc=0,badc=0;
+
+        for(size_t d=0;d<sizeof(docs)/sizeof(*docs);d++) {
+                counts want={},got={};
+                json_callbacks cb={};
+                cb.got_value=value;
+                cb.context=&want;
+                for(const char *p=docs[d];*p;) {
+                        p=json_parse(&cb,p);
+                        if (!p) break;
+                        while(*p==' ' || *p=='\n') p++;
+                }
+                if (pulled(docs[d],&got) && memcmp(&want,&got,sizeof(want))==0) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: %s\n",docs[d]);
+                        for(size_t i=0;i<PATHS;i++) printf("  path %zu: want %d got %d\n",i,want.n[i],got.n[i]);
+                }
+        }
+
+        /* handlers see the value, and the path if they ask */
+        {
+                const char *doc="{\"johnny\":[0,1,2,3,4,5.5],\"name\":\"five\"}";
+                constexpr auto johnny5=path("johnny",idx<5>);
+                double number=0;
+                int strings=0,names=0;
+                bool ok=parse(doc,
+                        on(johnny5,[&](const json_value &v) {
+                                if (v.type==json_value::json_type_number) number=v.number;
+                        }),
+                        on(path("*"),[&](const json_valuecontext *root,const json_value &v) {
+                                if (v.type==json_value::json_type_string && json_matches_path(root,"name",NULL)) strings++;
+                        }),
+                        on(path("name"),[&](const json_value &v) {
+                                names+=(v.string.n==4 && memcmp(v.string.s,"five",4)==0);
+                        }));
+                if (ok && number==5.5 && strings==1 && names==1) goodc++; else badc++;
+        }
+
+        /* errors, and options passed through json_callbacks */
+        {
+                int calls=0,errors=0;
+                json_callbacks cb={};
+                cb.context=&errors;
+                cb.error=[](const json_valuecontext *,const char *,json_in,json_in,const char *,void *context) {
+                        (*(int *)context)++;
+                };
+                const char *bad="[1,2,}";
+                if (!parse(&cb,bad,strlen(bad),on(path("#"),[&](const json_value &) {calls++;})) && errors==1 && calls==2) goodc++;
+                else badc++;
+                if (!parse<2>(&cb,"[[[1]]]",7,on(path("**"),[](const json_value &) {})) && errors==2) goodc++;
+                else badc++;
+        }
+
+        /* a handler returning false stops the parse, which is not an error */
+        {
+                const char *doc="[1,2,3,[4],}";
+                int seen=0;
+                if (parse(doc,on(path("#"),[&](const json_value &v) {
+                        seen++;
+                        return !(v.type==json_value::json_type_number && v.number==2);
+                })) && seen==2) goodc++;
+                else badc++;
+        }
+
+        /* handlers for the same value are called in the order given */
+        {
+                char order[8]={0};
+                int n=0;
+                bool ok=parse("{\"a\":1}",
+                        on(path("a"),[&](const json_value &) {order[n++]='1'; return false;}),
+                        on(path("*"),[&](const json_value &) {order[n++]='2';}),
+                        on(path("**"),[&](const json_value &) {order[n++]='3';}));
+                if (ok && strcmp(order,"123")==0) goodc++; else badc++;
+        }
+
+        printf("C++ test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,87 @@
+/* measure the stack used per nesting level, and test the depth limit */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "json.h"
+
+/* Note where the stack is when the innermost value is reached. */
+static void probe(const json_valuecontext *root,const json_value *v,void *context) {
+        volatile char here=0;
+        (void)root; (void)v;
+        *(uintptr_t *)context=(uintptr_t)&here;
+}
+
+static const char *seen;
+static void remember(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)context;
+        seen=msg;
+}
+
+/* depth nested arrays around a single value */
+static char *nest(int depth) {
+        char *s=malloc(2*depth+2);
+        memset(s,'[',depth);
+        s[depth]='1';
+        memset(s+depth+1,']',depth);
+        s[2*depth+1]='\0';
+        return s;
+}
+
+static uintptr_t where(bool recursive,int depth) {
+        uintptr_t sp=0;
+        json_callbacks cb={.context=&sp,.got_value=probe,.error=remember};
+        json_valuecontext *stack=malloc(depth*sizeof(*stack));
+        char *s=nest(depth);
+        if (recursive) json_parse(&cb,s);
+        else json_parse_stack(&cb,s,strlen(s),stack,depth);
+        free(s);
+        free(stack);
+        return sp;
+}
+
+int main(void) {
+        const int d1=10,d2=1000;
+        long recursive,iterative;
+        int goodc=0,badc=0;
+
+        recursive=(long)(where(true,d1)-where(true,d2))/(d2-d1);
+        iterative=(long)(where(false,d1)-where(false,d2))/(d2-d1);
+        printf("recursive parser:     %ld bytes of C stack per level\n",recursive);
+        printf("non-recursive parser: %ld bytes of C stack per level, plus %zu bytes in the caller's array\n",
+                iterative,sizeof(json_valuecontext));
+        if (iterative==0) goodc++; else badc++;
+
+        /* the limit is exact */
+        {
+                json_callbacks cb={.got_value=probe,.error=remember};
+                json_valuecontext stack[64];
+                uintptr_t sp;
+                char *s=nest(64);
+                cb.context=&sp;
+                seen=NULL;
+                if (json_parse_stack(&cb,s,strlen(s),stack,64)==s+strlen(s) && !seen) goodc++; else badc++;
+                if (!json_parse_stack(&cb,s,strlen(s),stack,63) && seen && strcmp(seen,"nested too deeply")==0) goodc++;
+                else badc++;
+                free(s);
+        }
+
+        /* hostile input: a million open brackets */
+        {
+                json_callbacks cb={.got_value=probe,.error=remember};
+                json_valuecontext stack[64];
+                uintptr_t sp;
+                size_t n=1000000;
+                char *s=malloc(n);
+                memset(s,'[',n);
+                cb.context=&sp;
+                seen=NULL;
+                if (!json_parse_stack(&cb,s,n,stack,64) && seen) goodc++; else badc++;
+                free(s);
+        }
+
+        printf("Depth test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,85 @@
+/* test the document tree */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+static bool is_string(const json_node *n,const char *s) {
+        return n && n->value.type==json_type_string &&
+                n->value.string.n==(int)strlen(s) && memcmp(n->value.string.s,s,strlen(s))==0;
+}
+
+static bool is_number(const json_node *n,double x) {
+        return n && n->value.type==json_type_number && n->value.number==x;
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg; (void)context;
+}
+
+int main(void) {
+        static char mem[1<<16];
+        static char text[8192];
+        const char *doc="{\"johnny\":[\"broken\",\"in pieces\",\"behind shed\",\"upside down\","
+                "\"watching tv\",\"alive\",\"passed out\"],\"empty\":{},\"none\":[],\"n\":-1.5,"
+                "\"nested\":{\"a\":{\"b\":[true,null]}},\"dup\":1,\"dup\":2}";
+        json_callbacks quietcb={.error=quiet};
+        json_arena a;
+        json_node *root,*n;
+        size_t used;
+        int goodc=0,badc=0;
+        int i,k,len;
+        char name[16];
+
+        json_arena_init(&a,mem,sizeof(mem));
+        root=json_dom_parse(&a,NULL,doc,strlen(doc));
+        if (root && root->value.type==json_type_object && json_dom_count(root)==7) goodc++; else badc++;
+        if (is_string(json_dom_index(json_dom_get(root,"johnny"),5),"alive")) goodc++; else badc++;
+        if (!json_dom_index(json_dom_get(root,"johnny"),7) && !json_dom_index(root,0)) goodc++; else badc++;
+        if (json_dom_count(json_dom_get(root,"empty"))==0 && !json_dom_first(json_dom_get(root,"none"))) goodc++; else badc++;
+        if (is_number(json_dom_get(root,"n"),-1.5) && !json_dom_get(root,"missing")) goodc++; else badc++;
+        n=json_dom_index(json_dom_get(json_dom_get(json_dom_get(root,"nested"),"a"),"b"),0);
+        if (n && n->value.type==json_type_bool && n->value.truefalse && n->next && n->next->value.type==json_type_null) goodc++; else badc++;
+        if (is_number(json_dom_get(root,"dup"),1)) goodc++; else badc++;
+
+        /* names and order are kept */
+        for(i=0,n=json_dom_first(root);n;n=n->next) i+=n->name.s!=NULL;
+        if (i==7 && json_dom_first(root)->name.n==6) goodc++; else badc++;
+
+        /* large objects and arrays are indexed, and agree with the lists */
+        len=sprintf(text,"{");
+        for(i=0;i<200;i++) len+=sprintf(text+len,"%s\"k%d\":[%d,%d]",(i)?",":"",i,i,i*2);
+        len+=sprintf(text+len,",\"k7\":0}");
+        json_arena_reset(&a);
+        root=json_dom_parse(&a,NULL,text,len);
+        for(i=k=0;root && i<200;i++) {
+                snprintf(name,sizeof(name),"k%d",i);
+                n=json_dom_get(root,name);
+                if (is_number(json_dom_index(n,1),i*2) && is_number(json_dom_first(n),i)) k++;
+        }
+        if (k==200 && root->list->hash && !json_dom_get(root,"k200") && !json_dom_get(root,"k")) goodc++; else badc++;
+        len=sprintf(text,"[");
+        for(i=0;i<100;i++) len+=sprintf(text+len,"%s%d",(i)?",":"",i);
+        len+=sprintf(text+len,"]");
+        root=json_dom_parse(&a,NULL,text,len);
+        for(i=k=0;root && i<100;i++) k+=is_number(json_dom_index(root,i),i);
+        if (k==100 && root->list->hash && !json_dom_index(root,100)) goodc++; else badc++;
+
+        /* freeing is a reset; a full arena or bad text gives NULL */
+        json_arena_reset(&a);
+        if (a.used==0) goodc++; else badc++;
+        root=json_dom_parse(&a,NULL,doc,strlen(doc));
+        used=a.used;
+        for(k=0,i=0;i<(int)used;i+=8) {
+                json_arena small;
+                json_arena_reset(&a);
+                json_arena_init(&small,mem,i);
+                if (json_dom_parse(&small,NULL,doc,strlen(doc))) k++;
+        }
+        if (root && k==0) goodc++; else badc++;
+        if (!json_dom_parse(&a,&quietcb,"{\"a\":",5) && !json_dom_parse(&a,&quietcb,"[1,]",4)) goodc++; else badc++;
+
+        printf("DOM test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,144 @@
+/* test begin/end events for objects and arrays */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+/* Rebuild the text (without whitespace) from the events and values. */
+typedef struct {
+        char out[1024];
+        int n;
+        bool comma[32];  /* a value has been seen at this depth */
+        int depth;
+        int badspans;
+        int unknown;     /* spans that began in an earlier chunk */
+} rebuild;
+
+static void put(rebuild *r,const char *s,int n) {
+        if (r->n+n < (int)sizeof(r->out)) {
+                memcpy(r->out+r->n,s,n);
+                r->n+=n;
+                r->out[r->n]='\0';
+        }
+}
+
+static const json_valuecontext *leaf(const json_valuecontext *c) {
+        while(c->next) c=c->next;
+        return c;
+}
+
+/* Put the separator and name before a value at c. */
+static void prefix(rebuild *r,const json_valuecontext *c) {
+        if (r->depth>0 && r->comma[r->depth]) put(r,",",1);
+        if (r->depth>0) r->comma[r->depth]=true;
+        if (r->depth>0 && c->name.s) {
+                put(r,"\"",1);
+                put(r,c->name.s,c->name.n);
+                put(r,"\":",2);
+        }
+}
+
+static void value(const json_valuecontext *root,const json_value *v,void *context) {
+        rebuild *r=context;
+        char tmp[32];
+        prefix(r,leaf(root));
+        switch(v->type) {
+        case json_type_null:   put(r,"null",4); break;
+        case json_type_bool:   put(r,(v->truefalse)?"true":"false",(v->truefalse)?4:5); break;
+        case json_type_number: put(r,tmp,snprintf(tmp,sizeof(tmp),"%g",v->number)); break;
+        case json_type_string: put(r,"\"",1); put(r,v->string.s,v->string.n); put(r,"\"",1); break;
+        default: break;
+        }
+}
+
+static void begin(rebuild *r,const json_valuecontext *root,json_in start,char open) {
+        prefix(r,leaf(root));
+        put(r,&open,1);
+        if (start && *start!=open) r->badspans++;
+        r->comma[++r->depth]=false;
+}
+
+static void nothing(const json_valuecontext *root,const json_value *v,void *context) {
+        (void)root; (void)v; (void)context;
+}
+
+static void end(rebuild *r,json_in start,json_in e,char open,char close) {
+        json_callbacks quiet={.got_value=nothing};
+        put(r,&close,1);
+        r->depth--;
+        if (e[-1]!=close) r->badspans++;
+        /* the span holds the whole container */
+        if (!start) r->unknown++;
+        else if (*start!=open || json_parse_n(&quiet,start,e-start)!=e) r->badspans++;
+}
+
+static void begin_object(const json_valuecontext *root,json_in start,void *context) {
+        begin(context,root,start,'{');
+}
+static void end_object(const json_valuecontext *root,json_in start,json_in e,void *context) {
+        (void)root;
+        end(context,start,e,'{','}');
+}
+static void begin_array(const json_valuecontext *root,json_in start,void *context) {
+        begin(context,root,start,'[');
+}
+static void end_array(const json_valuecontext *root,json_in start,json_in e,void *context) {
+        (void)root;
+        end(context,start,e,'[',']');
+}
+
+int main(void) {
+        static const char *docs[]={
+                "{}",
+                "[]",
+                "[[],{},[[]],{\"a\":{}}]",
+                "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"e\",\"f\":[{}]}}",
+                " [ 1 , [ 2 , { \"x\" : [ ] } ] , 3 ] ",
+                "\"not a container\"",
+        };
+        static const char *want[]={
+                "{}",
+                "[]",
+                "[[],{},[[]],{\"a\":{}}]",
+                "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"e\",\"f\":[{}]}}",
+                "[1,[2,{\"x\":[]}],3]",
+                "\"not a container\"",
+        };
+        json_valuecontext stack[8];
+        char buf[64];
+        json_parser jp;
+        rebuild r;
+        json_callbacks cb={.context=&r,.got_value=value,
+                .begin_object=begin_object,.end_object=end_object,
+                .begin_array=begin_array,.end_array=end_array};
+        int goodc=0,badc=0;
+        size_t d,len,split;
+        int how;
+
+        for(d=0;d<sizeof(docs)/sizeof(*docs);d++) {
+                len=strlen(docs[d]);
+                for(how=0;how<2+(int)len+1;how++) {
+                        bool ok;
+                        memset(&r,0,sizeof(r));
+                        if (how==0) ok=json_parse(&cb,docs[d])!=NULL;
+                        else if (how==1) ok=json_parse_stack(&cb,docs[d],len,stack,8)!=NULL;
+                        else {
+                                /* two chunks */
+                                split=how-2;
+                                json_parser_init(&jp,&cb,stack,8,buf,sizeof(buf));
+                                ok=json_parser_feed(&jp,docs[d],split) && json_parser_feed(&jp,docs[d]+split,len-split);
+                                ok=json_parser_finish(&jp) && ok;
+                        }
+                        if (how<2 && r.unknown) r.badspans++; /* whole texts have every span */
+                        if (ok && r.depth==0 && r.badspans==0 && strcmp(r.out,want[d])==0) goodc++;
+                        else {
+                                badc++;
+                                printf("FAIL (parser %d): %s\n  got  %s (depth %d, bad spans %d)\n",how,docs[d],r.out,r.depth,r.badspans);
+                        }
+                }
+        }
+
+        printf("Events test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,104 @@
+/* test registered key IDs */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+static const char *names[]={"id","name","tags","a\\\"b","ab","ba","abc","acc","x"};
+#define NAMES (int)(sizeof(names)/sizeof(*names))
+
+typedef struct {
+        const json_keys *k;
+        int seen,wrong;
+} result;
+
+/* Every context on the path must have the ID of its name. */
+static void check(const json_valuecontext *root,const json_value *v,void *context) {
+        result *r=context;
+        const json_valuecontext *c;
+        int i,want;
+        (void)v;
+        for(c=root->next;c;c=c->next) {
+                want=0;
+                for(i=0;c->name.s && i<NAMES;i++) {
+                        if (json_matches_name(c,names[i])) want=i+1;
+                }
+                if (c->key!=want) r->wrong++;
+                r->seen++;
+        }
+}
+
+int main(void) {
+        const char *doc="{\"id\":1,\"name\":\"n\",\"tags\":[{\"x\":1,\"y\":2},{\"ab\":{\"ba\":[3]}}],"
+                "\"a\\\"b\":true,\"abc\":0,\"acc\":1,\"abd\":2,\"\":3,\"idx\":4,\"i\":5,\"x\\u0000\":6}";
+        static char buf[256],big[64][24];
+        const char *bignames[64];
+        json_valuecontext stack[16];
+        json_tapeentry entries[128];
+        uint32_t index[128];
+        json_tape t;
+        json_cursor cur;
+        int slots[64],bigslots[1024];
+        json_keys k,kb;
+        result r;
+        json_callbacks cb={.context=&r,.got_value=check,.keys=&k};
+        json_nchar s;
+        int goodc=0,badc=0;
+        int i,how,found;
+        size_t len=strlen(doc);
+
+        if (json_keys_init(&k,names,NAMES,slots,64)) goodc++; else badc++;
+        for(how=0;how<3;how++) {
+                memset(&r,0,sizeof(r));
+                if (how==0) json_parse(&cb,doc);
+                else if (how==1) json_parse_stack(&cb,doc,len,stack,16);
+                else {
+                        json_tape_build(&t,NULL,doc,len,index,128,entries,128);
+                        cur=json_tape_cursor(&t);
+                        json_cursor_walk(&cur,&cb);
+                }
+                if (r.seen>20 && r.wrong==0) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL (parser %d): %d of %d keys wrong\n",how,r.wrong,r.seen);
+                }
+        }
+
+        /* the resumable parser, with names copied into its buffer */
+        {
+                json_parser jp;
+                memset(&r,0,sizeof(r));
+                json_parser_init(&jp,&cb,stack,16,buf,sizeof(buf));
+                for(i=0;i<(int)len;i++) json_parser_feed(&jp,doc+i,1);
+                if (json_parser_finish(&jp) && r.seen>20 && r.wrong==0) goodc++; else badc++;
+        }
+
+        /* many names that differ only in the middle */
+        for(i=0;i<64;i++) {
+                snprintf(big[i],sizeof(big[i]),"field%02dx",i);
+                bignames[i]=big[i];
+        }
+        if (json_keys_init(&kb,bignames,64,bigslots,1024)) {
+                for(i=found=0;i<64;i++) {
+                        s.s=big[i];
+                        s.n=strlen(big[i]);
+                        found+=(json_key_id(&kb,&s)==i+1);
+                }
+                s.s="field64x";
+                s.n=8;
+                if (found==64 && json_key_id(&kb,&s)==0) goodc++; else badc++;
+        }
+        else badc++;
+
+        /* duplicates cannot be told apart, and too few slots fail */
+        bignames[1]=bignames[0];
+        if (!json_keys_init(&kb,bignames,64,bigslots,1024)) goodc++; else badc++;
+        if (!json_keys_init(&kb,names,NAMES,slots,4)) goodc++; else badc++;
+        s.s="id";
+        s.n=2;
+        if (json_key_id(&kb,&s)==0) goodc++; else badc++;
+
+        printf("Keys test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
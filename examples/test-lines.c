@@ -0,0 +1,89 @@
+/* test parsing JSON Lines on several threads */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json.h"
+
+#define LINES 5000
+
+typedef struct {
+        int id[LINES+10];         /* id seen on each line, by record number */
+        int values[JSON_THREADS_MAX]; /* values seen by each worker */
+        int matched[LINES+10];    /* query matches on each line */
+        int errors;
+} result;
+
+static void got(const json_valuecontext *root,const json_value *v,void *context) {
+        result *r=context;
+        size_t line=json_record_number(root);
+        r->values[json_worker_number(root)]++;
+        if (line<LINES+10 && v->type==json_type_number && json_matches_path(root,"id",NULL))
+                r->id[line]=(int)v->number;
+}
+
+static void tag(const json_valuecontext *root,const json_value *v,void *context) {
+        result *r=context;
+        size_t line=json_record_number(root);
+        (void)v;
+        if (line<LINES+10) r->matched[line]++;
+}
+
+static void counterr(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        result *r=context;
+        (void)etype; (void)s; (void)p; (void)msg;
+        __atomic_fetch_add(&r->errors,1,__ATOMIC_RELAXED);
+        if (json_record_number(c)!=LINES/2+1) r->errors+=1000; /* wrong line */
+}
+
+int main(void) {
+        static result r;
+        static char text[LINES*80];
+        json_querynode nodes[16];
+        json_queries q;
+        json_callbacks cb={.context=&r,.got_value=got,.error=counterr,.queries=&q};
+        int goodc=0,badc=0;
+        int threads[]={1,2,3,4,8,0};
+        size_t t,n,line;
+        int i,total;
+        bool ok;
+
+        json_query_init(&q,nodes,16);
+        json_query_compile(&q,tag,&r,"tags","#1",NULL);
+
+        /* one record per line, with a blank line, a CRLF line and a bad line */
+        n=0;
+        line=0;
+        for(i=0;i<LINES;i++) {
+                if (i==10) {n+=sprintf(text+n,"  \n"); line++;}
+                if (i==LINES/2) {n+=sprintf(text+n,"{\"id\":oops}\n"); line++;}
+                n+=sprintf(text+n,"{\"id\":%zu,\"tags\":[\"x\",\"y\"],\"v\":%d}%s\n",line,i,(i==20)?"\r":"");
+                line++;
+        }
+        n+=sprintf(text+n,"[1,2]");
+
+        for(t=0;t<sizeof(threads)/sizeof(*threads);t++) {
+                memset(&r,0,sizeof(r));
+                ok=json_parse_lines(&cb,text,n,threads[t]);
+                for(i=total=0;i<JSON_THREADS_MAX;i++) total+=r.values[i];
+                /* every good line seen once, in its place, and nothing else */
+                for(line=0,i=0;line<LINES+2;line++) {
+                        if (line==10 || line==LINES/2+1) continue;
+                        if (r.id[line]!=(int)line || r.matched[line]!=1) i++;
+                }
+                if (!ok && r.errors>0 && r.errors<1000 && i==0 && total==LINES*4+2) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL (%d threads): ok=%d errors=%d wrong=%d values=%d\n",threads[t],ok,r.errors,i,total);
+                }
+        }
+
+        /* all good */
+        memset(&r,0,sizeof(r));
+        if (json_parse_lines(&cb,"1\n\n2\n",5,4) && r.errors==0) goodc++; else badc++;
+        if (json_parse_lines(&cb,"",0,4) && !json_parse_lines(&cb,"1 2",3,2)) goodc++; else badc++;
+
+        printf("Lines test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
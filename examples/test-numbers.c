@@ -0,0 +1,214 @@
+/* test number conversion: doubles must match strtod() bit for bit */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "json.h"
+
+typedef struct {
+        json_value v;
+        int count;
+} result;
+
+static void keep(const json_valuecontext *root,const json_value *v,void *context) {
+        result *r=context;
+        (void)root;
+        r->v=*v;
+        r->count++;
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg; (void)context;
+}
+
+/* Parse the number from an exact-size copy, so nothing past it is read.
+ * A lazy value points into the copy, which is kept until the next call.
+ */
+static bool parse(const char *text,int options,json_value *v) {
+        static char *copy;
+        result r={};
+        json_callbacks cb={.context=&r,.got_value=keep,.error=quiet,.options=options};
+        size_t n=strlen(text);
+        bool ok;
+        free(copy);
+        copy=malloc(n);
+        memcpy(copy,text,n);
+        ok=json_parse_n(&cb,copy,n)==copy+n && r.count==1;
+        *v=r.v;
+        return ok;
+}
+
+static bool same_double(double a,double b) {
+        return memcmp(&a,&b,sizeof(a))==0;
+}
+
+/* Returns true if text converts to the same double as strtod(). */
+static bool check_double(const char *text) {
+        json_value v;
+        double want=strtod(text,NULL);
+        if (parse(text,0,&v) && v.type==json_type_number && same_double(v.number,want)) return true;
+        printf("FAIL: %s: got %.17g, want %.17g\n",text,v.number,want);
+        return false;
+}
+
+static unsigned long long seed=12345;
+static unsigned int lcg(void) {
+        seed=seed*6364136223846793005ULL+1442695040888963407ULL;
+        return (unsigned int)(seed>>33);
+}
+
+int main(void) {
+        static const char *doubles[]={
+                "0","-0","1","-1","0.1","0.5","1e23","-123.456e-78","3.14159265358979323846",
+                "9007199254740992","9007199254740993","9007199254740995","4503599627370497.5",
+                "123456789012345678901234567890","18446744073709551615","18446744073709551616",
+                "2.2250738585072011e-308","2.2250738585072014e-308","2.225073858507201136057409796709131975934819546351645648e-308",
+                "4.9406564584124654e-324","2.4703282292062327e-324","2.4703282292062328e-324","1e-324","1e-400",
+                "1.7976931348623157e308","1.7976931348623158e308","1.7976931348623159e308","1e309","1e400",
+                "0.000000000000000000000000000001234","100000000000000000000000e-23","1E+22","1e-22",
+                "1.00000000000000011102230246251565404236316680908203125",
+                "1.00000000000000011102230246251565404236316680908203124",
+                "1.00000000000000011102230246251565404236316680908203126",
+                "7.2057594037927933e16","8.98846567431158e307","-2.0e-7","5e-324","0.0e99999999999",
+                "1.","-0.0","0e0","123e0000000000000000000000000001",
+        };
+        static const struct {
+                const char *text;
+                int64_t value;
+        } integers[]={
+                {"0",0},{"-0",0},{"42",42},{"-42",-42},
+                {"9007199254740993",9007199254740993LL},
+                {"9223372036854775807",INT64_MAX},
+                {"-9223372036854775808",INT64_MIN},
+                {"1234567890123456789",1234567890123456789LL},
+        };
+        static const char *not_integers[]={
+                "9223372036854775808","-9223372036854775809","12345678901234567890",
+                "100000000000000000000","1.0","1e2","-0.0",
+        };
+        char text[1024];
+        json_value v;
+        int goodc=0,badc=0;
+        size_t i;
+        int j,k;
+
+        for(i=0;i<sizeof(doubles)/sizeof(*doubles);i++) {
+                if (check_double(doubles[i])) goodc++; else badc++;
+        }
+
+        /* a mantissa longer than strtod fallback keeps */
+        k=snprintf(text,sizeof(text),"0.");
+        for(j=0;j<900;j++) text[k++]=(j<800)?"12345"[j%5]:'0';
+        text[k]='\0';
+        if (check_double(text)) goodc++; else badc++;
+        text[k-1]='1';
+        if (check_double(text)) goodc++; else badc++;
+
+        /* integers */
+        for(i=0;i<sizeof(integers)/sizeof(*integers);i++) {
+                if (parse(integers[i].text,json_option_integers,&v) &&
+                    v.type==json_type_integer && v.integer==integers[i].value) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: %s is not integer %lld\n",integers[i].text,(long long)integers[i].value);
+                }
+                /* without the option, still a number */
+                if (parse(integers[i].text,0,&v) && v.type==json_type_number) goodc++; else badc++;
+        }
+        for(i=0;i<sizeof(not_integers)/sizeof(*not_integers);i++) {
+                if (parse(not_integers[i],json_option_integers,&v) && v.type==json_type_number &&
+                    same_double(v.number,strtod(not_integers[i],NULL))) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: %s is not a double\n",not_integers[i]);
+                }
+        }
+
+        /* random lexemes: up to 30 digits, a point anywhere, wide exponents */
+        for(j=0;j<200000;j++) {
+                int digits=1+lcg()%30,point=lcg()%(digits+1),n=0,d;
+                bool ok;
+                if (lcg()%2) text[n++]='-';
+                for(d=0;d<digits;d++) {
+                        if (d==point && d>0) text[n++]='.';
+                        text[n++]=(d==0)?'1'+lcg()%9:'0'+lcg()%10;
+                }
+                if (lcg()%4) n+=sprintf(text+n,"e%d",(int)(lcg()%700)-350);
+                text[n]='\0';
+                ok=check_double(text);
+                if (!ok && ++badc>20) break;
+        }
+        if (j==200000) goodc++;
+
+        /* random doubles round trip through %.17g */
+        for(j=0;j<200000;j++) {
+                uint64_t bits=((uint64_t)lcg()<<32)^lcg();
+                double x;
+                memcpy(&x,&bits,sizeof(x));
+                if (x!=x || x-x!=0) continue; /* NaN or infinity */
+                snprintf(text,sizeof(text),"%.17g",x);
+                if (!parse(text,0,&v) || !same_double(v.number,x)) {
+                        printf("FAIL: %s does not round trip\n",text);
+                        if (++badc>20) break;
+                }
+        }
+        if (j==200000) goodc++;
+
+        /* lazy numbers keep the text, and convert the same way */
+        for(i=0;i<sizeof(doubles)/sizeof(*doubles);i++) {
+                char out[64];
+                int64_t x;
+                bool whole;
+                double want=strtod(doubles[i],NULL);
+                if (!parse(doubles[i],json_option_lazy_numbers,&v) || v.type!=json_type_number || !v.lazy) {
+                        badc++;
+                        printf("FAIL: %s is not lazy\n",doubles[i]);
+                        continue;
+                }
+                whole=(want>=-9223372036854775808.0 && want<9223372036854775808.0 && (double)(int64_t)want==want);
+                if (same_double(json_value_to_double(&v),want) &&
+                    json_value_to_int64(&v,&x)==whole && (!whole || x==(int64_t)want || x==strtoll(doubles[i],NULL,10)) &&
+                    json_value_to_decimal_string(out,sizeof(out),&v)==strlen(doubles[i])+1 &&
+                    strncmp(out,doubles[i],sizeof(out)-1)==0) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: lazy %s\n",doubles[i]);
+                }
+        }
+        for(i=0;i<sizeof(integers)/sizeof(*integers);i++) {
+                int64_t x=0;
+                /* exact, where a double would not be */
+                if (parse(integers[i].text,json_option_lazy_numbers,&v) &&
+                    json_value_to_int64(&v,&x) && x==integers[i].value) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: lazy %s is not integer %lld\n",integers[i].text,(long long)integers[i].value);
+                }
+                if (parse(integers[i].text,json_option_lazy_numbers|json_option_integers,&v) &&
+                    v.type==json_type_integer && v.integer==integers[i].value) goodc++; else badc++;
+        }
+        {
+                /* converting values that were not lazy */
+                char out[64];
+                int64_t x;
+                parse("[1.5]",0,&v);
+                if (json_value_to_double(&v)==1.5 && !json_value_to_int64(&v,&x) &&
+                    json_value_to_decimal_string(out,sizeof(out),&v)==4 && strcmp(out,"1.5")==0) goodc++; else badc++;
+                parse("1e2",0,&v);
+                if (json_value_to_int64(&v,&x) && x==100) goodc++; else badc++;
+                parse("-42",json_option_integers,&v);
+                if (json_value_to_double(&v)==-42 && json_value_to_decimal_string(out,3,&v)==4 && strcmp(out,"-4")==0) goodc++; else badc++;
+                parse("\"12\"",0,&v);
+                if (json_value_to_decimal_string(out,sizeof(out),&v)==0 && !json_value_to_int64(&v,&x)) goodc++; else badc++;
+        }
+
+        /* not numbers */
+        if (!parse("1e",0,&v)) goodc++; else badc++;
+        if (!parse("-",0,&v)) goodc++; else badc++;
+        if (!parse("1e+",0,&v)) goodc++; else badc++;
+
+        printf("Numbers test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
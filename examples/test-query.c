@@ -0,0 +1,224 @@
+/* test compiled path queries against json_matches_path() */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+#define MAXSTEPS 4
+
+static const char *paths[][MAXSTEPS+1]={
+        {"johnny","#5"},
+        {"johnny","#"},
+        {"johnny","*"},
+        {"glossary","title"},
+        {"glossary","GlossDiv","title"},
+        {"*","title"},
+        {"*","*","title"},
+        {"**"},
+        {"glossary","**"},
+        {"#"},
+        {"#1"},
+        {"#0x2"},
+        {"*"},
+        {"list","#3"},
+        {"a/b"},
+        {"0"},
+        {"glossary","title"}, /* twice */
+        {NULL},
+};
+static const int npaths=sizeof(paths)/sizeof(*paths);
+
+/* JSON Pointers with the same meaning as some of the paths above */
+static const struct {
+        const char *pointer;
+        int same; /* index in paths[] */
+} pointers[]={
+        {"/johnny/5",0},
+        {"/glossary/title",3},
+        {"/glossary/GlossDiv/title",4},
+        {"/1",10},
+        {"/list/3",13},
+        {"/a~1b",14},
+        {"",17},
+};
+static const int npointers=sizeof(pointers)/sizeof(*pointers);
+
+static int compiled[64];
+
+static void hit(const json_valuecontext *root,const json_value *v,void *context) {
+        (void)root; (void)v;
+        (*(int *)context)++;
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg;
+        (*(int *)context)++;
+}
+
+/* For each value, count the paths that match the old way. */
+static int expected[64];
+static void check_all(const json_valuecontext *root,const json_value *v,void *context) {
+        int i;
+        (void)v; (void)context;
+        for(i=0;i<npaths;i++) {
+                const char *const *p=paths[i];
+                if (json_matches_path(root,p[0],p[1],p[2],p[3],p[4])) expected[i]++;
+        }
+        /* "0" as a pointer step matches an index too */
+        if (json_matches_path(root,"#0",NULL)) expected[npaths]++;
+}
+
+int main(void) {
+        const char *docs[]={
+                "{\"johnny\":[\"broken\",\"in pieces\",\"behind shed\",\"upside down\",\"watching tv\",\"alive\",\"passed out\"]}",
+                "{\"glossary\":{\"title\":\"example glossary\",\"GlossDiv\":{\"title\":\"S\",\"GlossList\":{\"GlossEntry\":{\"ID\":\"SGML\",\"GlossSeeAlso\":[\"GML\",\"XML\"]}}}}}",
+                "[10,11,[12,[13,14]],{\"title\":15}]",
+                "{\"list\":[10,11,\"hi\",-3e-10],\"a/b\":1,\"0\":2,\"title\":{\"title\":3}}",
+                "{\"title\":{\"x\":{\"title\":4}},\"y\":{\"title\":5}}",
+                "42",
+                "[]",
+        };
+        int ndocs=sizeof(docs)/sizeof(*docs);
+        int goodc=0,badc=0;
+        int d,i;
+
+        for(d=0;d<ndocs;d++) {
+                json_querynode nodes[128];
+                json_queries q;
+                int bypointer[16],pointer0=0;
+                json_callbacks cb={.queries=&q};
+                json_callbacks old={.got_value=check_all,.error=NULL};
+                json_valuecontext stack[8];
+
+                memset(compiled,0,sizeof(compiled));
+                memset(bypointer,0,sizeof(bypointer));
+                memset(expected,0,sizeof(expected));
+
+                json_query_init(&q,nodes,128);
+                for(i=0;i<npaths;i++) {
+                        const char *const *p=paths[i];
+                        if (!json_query_compile(&q,hit,&compiled[i],p[0],p[1],p[2],p[3],p[4])) {
+                                printf("FAIL: compile %d\n",i);
+                                badc++;
+                        }
+                }
+                for(i=0;i<npointers;i++) {
+                        if (!json_query_compile_pointer(&q,hit,&bypointer[i],pointers[i].pointer)) {
+                                printf("FAIL: compile %s\n",pointers[i].pointer);
+                                badc++;
+                        }
+                }
+                json_query_compile_pointer(&q,hit,&pointer0,"/0");
+
+                json_parse(&old,docs[d]);
+
+                /* the same counts from both parsers */
+                for(int pass=0;pass<2;pass++) {
+                        int want;
+                        if (pass==0) json_parse(&cb,docs[d]);
+                        else json_parse_stack(&cb,docs[d],strlen(docs[d]),stack,8);
+                        for(i=0;i<npaths;i++) {
+                                if (compiled[i]==expected[i]*(pass+1)) goodc++;
+                                else {
+                                        badc++;
+                                        printf("FAIL: doc %d path %d: %d, expected %d\n",d,i,compiled[i],expected[i]);
+                                }
+                        }
+                        for(i=0;i<npointers;i++) {
+                                want=expected[pointers[i].same]*(pass+1);
+                                if (bypointer[i]==want) goodc++;
+                                else {
+                                        badc++;
+                                        printf("FAIL: doc %d pointer %s: %d, expected %d\n",d,pointers[i].pointer,bypointer[i],want);
+                                }
+                        }
+                        want=(expected[15]+expected[npaths])*(pass+1);
+                        if (pointer0==want) goodc++;
+                        else {
+                                badc++;
+                                printf("FAIL: doc %d pointer /0: %d, expected %d\n",d,pointer0,want);
+                        }
+                }
+        }
+
+        /* bad paths, and running out of nodes */
+        {
+                json_querynode nodes[8];
+                json_queries q;
+                json_query_init(&q,nodes,8);
+                if (!json_query_compile(&q,hit,NULL,"#x",NULL)) goodc++; else badc++;
+                if (!json_query_compile_pointer(&q,hit,NULL,"no/slash")) goodc++; else badc++;
+                if (!json_query_compile_pointer(&q,hit,NULL,"/bad~2escape")) goodc++; else badc++;
+                if (!json_query_compile(&q,hit,NULL,"a","b","c","d","e","f","g",NULL)) goodc++; else badc++;
+        }
+
+        /* a table with room for the empty path only */
+        {
+                json_querynode one[1];
+                json_queries q;
+                json_callbacks cb={.queries=&q};
+                int root=0;
+                json_query_init(&q,one,1);
+                if (!json_query_compile(&q,hit,&root,"a",NULL) && json_query_compile(&q,hit,&root,NULL) &&
+                    json_parse(&cb,"{\"a\":1}") && json_parse(&cb,"5") && root==1) goodc++;
+                else badc++;
+        }
+
+        /* deep documents are parsed; more match state than fits is an error */
+        {
+                json_querynode nodes[128];
+                json_queries q;
+                int errors=0;
+                json_callbacks cb={.queries=&q,.error=quiet,.context=&errors};
+                json_valuecontext stack[48];
+                char doc[256];
+                json_in end;
+                int n=0,deep=0,some=0,many=0,k;
+
+                for(k=0;k<40;k++) n+=sprintf(doc+n,"{\"a\":");
+                n+=sprintf(doc+n,"1");
+                for(k=0;k<40;k++) n+=sprintf(doc+n,"}");
+
+                json_query_init(&q,nodes,128);
+                if (!json_query_compile(&q,hit,&deep,"a","a","a","a","a","a","a","a","a","a",
+                        "a","a","a","a","a","a","a","a","a","a",NULL)) goodc++; else badc++;
+                if (json_query_compile(&q,hit,&deep,"a","a","a","a","a","a","a","a","a","a",
+                        "a","a","a","**",NULL)) goodc++; else badc++;
+                if (json_parse(&cb,doc) && json_parse_stack(&cb,doc,n,stack,48) && deep==2) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: deep: %d\n",deep);
+                }
+
+                /* "**", "*","**", "*","*","**" and so on: a level holds one more state than the last */
+                for(k=0;k<14;k++) {
+                        const char *p[16]={NULL};
+                        int i;
+                        if (k==0 || k==5) json_query_init(&q,nodes,128);
+                        for(i=0;i<k;i++) p[i]="*";
+                        p[k]="**";
+                        if (!json_query_compile(&q,hit,(k<5)?&some:&many,p[0],p[1],p[2],p[3],p[4],p[5],p[6],p[7],
+                                p[8],p[9],p[10],p[11],p[12],p[13],p[14])) badc++;
+                        if (k==4) {
+                                /* five fit, and each matches the 1 */
+                                if (json_parse(&cb,doc) && json_parse_stack(&cb,doc,n,stack,48) &&
+                                    some==10 && errors==0) goodc++;
+                                else {
+                                        badc++;
+                                        printf("FAIL: some state: %d %d\n",some,errors);
+                                }
+                        }
+                }
+                /* fourteen do not, and both parsers say so rather than miss the 1 */
+                if (json_parse_status(&cb,doc,n,&end)==json_status_error &&
+                    !json_parse_stack(&cb,doc,n,stack,48) && errors==2) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: too many states: %d\n",errors);
+                }
+        }
+
+        printf("Query test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
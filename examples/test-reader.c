@@ -0,0 +1,156 @@
+/* test the pull reader against the callbacks */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+/* A log of events, one per line: a letter, the depth and the path. */
+typedef struct {
+        char text[4096];
+        int n;
+} events;
+
+static void add(events *l,char what,const json_valuecontext *root) {
+        const json_valuecontext *c;
+        int depth=0;
+        for(c=root->next;c;c=c->next) depth++;
+        l->n+=snprintf(l->text+l->n,sizeof(l->text)-l->n,"%c%d",what,depth);
+        for(c=root->next;c;c=c->next) {
+                if (c->name.s) l->n+=snprintf(l->text+l->n,sizeof(l->text)-l->n,"/%.*s",c->name.n,c->name.s);
+                else l->n+=snprintf(l->text+l->n,sizeof(l->text)-l->n,"/#%d",c->index);
+        }
+        l->n+=snprintf(l->text+l->n,sizeof(l->text)-l->n,"\n");
+}
+
+static void value(const json_valuecontext *root,const json_value *v,void *context) {
+        (void)v;
+        add(context,'v',root);
+}
+static void begin_object(const json_valuecontext *root,json_in start,void *context) {
+        (void)start;
+        add(context,'{',root);
+}
+static void end_object(const json_valuecontext *root,json_in start,json_in end,void *context) {
+        (void)start; (void)end;
+        add(context,'}',root);
+}
+static void begin_array(const json_valuecontext *root,json_in start,void *context) {
+        (void)start;
+        add(context,'[',root);
+}
+static void end_array(const json_valuecontext *root,json_in start,json_in end,void *context) {
+        (void)start; (void)end;
+        add(context,']',root);
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg;
+        (*(int *)context)++;
+}
+
+/* Read doc, logging as the callbacks would.  Returns the final event. */
+static json_event_type pull(const char *doc,events *l,int *errors) {
+        static const char what[]={
+                [json_event_value]='v',[json_event_begin_object]='{',[json_event_end_object]='}',
+                [json_event_begin_array]='[',[json_event_end_array]=']',
+        };
+        json_valuecontext stack[8];
+        json_callbacks cb={.error=quiet,.context=errors};
+        json_reader r;
+        json_event e;
+        const json_valuecontext *c;
+        int depth;
+
+        json_reader_init(&r,&cb,doc,strlen(doc),stack,8);
+        while(json_next(&r,&e)) {
+                /* the chain ends at the element, which is as deep as said */
+                for(c=e.path,depth=0;c->next;c=c->next) depth++;
+                if (c!=e.element || depth!=e.depth) {
+                        l->n+=snprintf(l->text+l->n,sizeof(l->text)-l->n,"bad element\n");
+                        continue;
+                }
+                if (e.type==json_event_key) {
+                        /* the name is known before the value */
+                        if (!e.element->name.s) l->n+=snprintf(l->text+l->n,sizeof(l->text)-l->n,"bad key\n");
+                        continue;
+                }
+                add(l,what[e.type],e.path);
+        }
+        return e.type;
+}
+
+int main(void) {
+        static const char *docs[]={
+                "{}",
+                "[]",
+                "17",
+                " \"str\" ",
+                "[[],{},[[]],{\"a\":{}}]",
+                "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"e\",\"f\":[{}]}}",
+                " [ 1 , [ 2 , { \"x\" : [ ] } ] , 3 ] ",
+                "[{\"a\":[{\"b\":[0,1,{\"c\":2}]}],\"d\":3},4]",
+        };
+        static const char *bad[]={
+                "",
+                "[1,2",
+                "{\"a\" 1}",
+                "{\"a\":1,}",
+                "[1 2]",
+                "[1}",
+                "{1:2}",
+                "[nul]",
+                "[[[[[[[[[1]]]]]]]]]",  /* deeper than the stack */
+        };
+        const char *two="{\"a\":{\"b\":1},\"c\":2} [3]";
+        json_valuecontext stack[8];
+        static events want,got;
+        json_callbacks cb={.context=&want,.got_value=value,
+                .begin_object=begin_object,.end_object=end_object,
+                .begin_array=begin_array,.end_array=end_array};
+        json_reader r;
+        json_event e;
+        int goodc=0,badc=0;
+        int errors,keys,values;
+        size_t d;
+
+        for(d=0;d<sizeof(docs)/sizeof(*docs);d++) {
+                want.n=got.n=0;
+                errors=0;
+                json_parse(&cb,docs[d]);
+                if (pull(docs[d],&got,&errors)==json_event_end && errors==0 &&
+                    want.n==got.n && memcmp(want.text,got.text,want.n)==0) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: %s\nwanted:\n%sgot:\n%s",docs[d],want.text,got.text);
+                }
+        }
+
+        for(d=0;d<sizeof(bad)/sizeof(*bad);d++) {
+                got.n=0;
+                errors=0;
+                if (pull(bad[d],&got,&errors)==json_event_error && errors==1) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: %s read without one error\n",bad[d]);
+                }
+        }
+
+        /* stopping early, and reading on into the next text */
+        json_reader_init(&r,NULL,two,strlen(two),stack,8);
+        for(keys=values=0;json_next(&r,&e);) {
+                if (e.type==json_event_key) keys++;
+                if (e.type==json_event_value) values++;
+                if (e.type==json_event_value && json_matches_path(e.path,"a","b",NULL)) break;
+        }
+        if (keys==2 && values==1 && e.element->value.type==json_type_number && e.element->value.number==1) goodc++;
+        else badc++;
+        while(json_next(&r,&e)) values+=(e.type==json_event_value);
+        if (values==2 && e.type==json_event_end && *e.at=='[') goodc++; else badc++;
+        /* then the next text */
+        while(json_next(&r,&e)) values+=(e.type==json_event_value);
+        if (values==3 && e.type==json_event_end && e.at==two+strlen(two)) goodc++; else badc++;
+
+        printf("Reader test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,166 @@
+/* test passing over unwanted objects and arrays with enter() */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+typedef struct {
+        char seen[8192]; /* "path=value;" for every value */
+        int n;
+        int entered;     /* enter() calls */
+        bool inside;     /* a callback came from inside a payload */
+} record;
+
+static const json_valuecontext *leaf(const json_valuecontext *c) {
+        while(c->next) c=c->next;
+        return c;
+}
+
+static bool in_payload(const json_valuecontext *root) {
+        const json_valuecontext *c;
+        for(c=root;c;c=c->next) if (json_matches_name(c,"payload")) return true;
+        return false;
+}
+
+static void add(record *r,const char *fmt,int n,const char *s) {
+        if (r->n < (int)sizeof(r->seen))
+                r->n+=snprintf(r->seen+r->n,sizeof(r->seen)-r->n,fmt,n,s);
+}
+
+static void keep(const json_valuecontext *root,const json_value *v,void *context) {
+        record *r=context;
+        const json_valuecontext *c;
+
+        if (in_payload(root)) {
+                r->inside=true;
+                return;
+        }
+        for(c=root->next;c;c=c->next) {
+                if (c->name.s) add(r,"/%.*s",c->name.n,c->name.s);
+                else add(r,"/%d",c->index,"");
+        }
+        switch(v->type) {
+        case json_type_string: add(r,"=%.*s;",v->string.n,v->string.s); break;
+        case json_type_number: add(r,"=%d;",(int)v->number,""); break;
+        default: add(r,"=%d;",v->type,""); break;
+        }
+}
+
+static json_action enter(const json_valuecontext *root,const json_value *v,void *context) {
+        record *r=context;
+        const json_valuecontext *c=leaf(root);
+        (void)v;
+        r->entered++;
+        if (json_matches_name(c,"payload")) return json_action_skip;
+        if (in_payload(root)) r->inside=true;
+        return json_action_descend;
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg; (void)context;
+}
+
+/* Parse text with every parser; returns the number of failures. */
+static int check(const char *text,bool valid,const record *want) {
+        size_t len=strlen(text);
+        json_valuecontext stack[16];
+        char buf[256];
+        json_parser jp;
+        record r;
+        json_callbacks cb={.context=&r,.got_value=keep,.error=quiet,.enter=enter};
+        int bad=0,how;
+        size_t split,i;
+        bool ok;
+
+        for(how=0;how<2+(int)len+1;how++) {
+                memset(&r,0,sizeof(r));
+                if (how==0) ok=json_parse(&cb,text)!=NULL;
+                else if (how==1) ok=json_parse_stack(&cb,text,len,stack,16)!=NULL;
+                else if (how<2+(int)len) {
+                        /* two chunks */
+                        split=how-2;
+                        json_parser_init(&jp,&cb,stack,16,buf,sizeof(buf));
+                        ok=json_parser_feed(&jp,text,split) && json_parser_feed(&jp,text+split,len-split);
+                        ok=json_parser_finish(&jp) && ok;
+                }
+                else {
+                        /* a byte at a time */
+                        json_parser_init(&jp,&cb,stack,16,buf,sizeof(buf));
+                        for(i=0,ok=true;ok && i<len;i++) ok=json_parser_feed(&jp,text+i,1);
+                        ok=json_parser_finish(&jp) && ok;
+                }
+                if (ok!=valid || r.inside || (valid && strcmp(r.seen,want->seen)!=0)) {
+                        if (!bad) printf("FAIL (parser %d): %s\n  got  %s\n  want %s\n",how,text,r.seen,want->seen);
+                        bad++;
+                }
+        }
+        return bad;
+}
+
+int main(void) {
+        static const char *payloads[]={
+                "{}",
+                "[]",
+                "[1,2,[3,[4]],{\"a\":{\"b\":[]}}]",
+                "{\"s\":\"]}\",\"t\":\"[{\",\"u\":\"\\\"]\"}",
+                "[\"\\\\\",\"\\\\\\\"}\",{\"x\":\"\\u005D\"}]",
+                "{\"deep\":[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[1]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]}",
+                "[true,false,null,-1.5e3,\"|{|}|\\u007B\"]",
+        };
+        static const char *broken[]={
+                "{\"payload\":[1,2,\"]\"}",
+                "{\"payload\":{\"a\":\"}\\\"}\"}",
+                "{\"payload\":[[[]]}",
+                "[{\"other\":1},{\"payload\":[}",
+        };
+        char text[1024],pad[80];
+        record want;
+        json_callbacks full={.context=&want,.got_value=keep,.error=quiet};
+        int goodc=0,badc=0;
+        size_t i,n;
+
+        /* payloads at every offset in a block, with escapes at block ends */
+        for(i=0;i<sizeof(payloads)/sizeof(*payloads);i++) {
+                for(n=0;n<40;n++) {
+                        memset(pad,'x',n);
+                        pad[n]='\0';
+                        snprintf(text,sizeof(text),
+                                "{\"id\":%d,\"name\":\"%s\",\"payload\":%s,\"after\":[%d,{\"payload\":{\"s\":\"%s\\\\\"}}],\"tail\":\"%s\\\"\"}",
+                                (int)i,pad,payloads[i],(int)n,pad,pad);
+                        memset(&want,0,sizeof(want));
+                        if (!json_parse(&full,text) || !want.inside) {
+                                printf("FAIL: full parse of %s\n",text);
+                                badc++;
+                                continue;
+                        }
+                        if (check(text,true,&want)) badc++; else goodc++;
+                }
+        }
+
+        /* a skipped container in an array */
+        memset(&want,0,sizeof(want));
+        json_parse(&full,"[1,{\"payload\":[2]},3]");
+        if (check("[1,{\"payload\":[2]},3]",true,&want)) badc++; else goodc++;
+
+        /* unbalanced skipped containers are still errors */
+        for(i=0;i<sizeof(broken)/sizeof(*broken);i++) {
+                memset(&want,0,sizeof(want));
+                if (check(broken[i],false,&want)) badc++; else goodc++;
+        }
+
+        /* enter() sees the root, "a", "a"[0] and "payload", but nothing inside */
+        {
+                record r={};
+                json_callbacks cb={.context=&r,.got_value=keep,.error=quiet,.enter=enter};
+                json_parse(&cb,"{\"a\":[{}],\"payload\":{\"b\":[{},{}]}}");
+                if (r.entered==4) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: enter() called %d times, expected 4\n",r.entered);
+                }
+        }
+
+        printf("Skip test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,120 @@
+/* test parse statistics
+ *
+ * Build with -DJSON_STATS (and -DJSON_STATS_CYCLES) for the counts to be
+ * checked; without, the counters must stay untouched.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+static volatile int spin;
+
+static void busy(void) {
+        int i;
+        for(i=0;i<1000;i++) spin++;
+}
+
+static void value(const json_valuecontext *root,const json_value *v,void *context) {
+        (void)root; (void)v; (void)context;
+        busy();
+}
+
+static void object(const json_valuecontext *root,json_in start,void *context) {
+        (void)root; (void)start; (void)context;
+}
+
+static void end(const json_valuecontext *root,json_in start,json_in stop,void *context) {
+        (void)root; (void)start; (void)stop; (void)context;
+}
+
+static json_action enter(const json_valuecontext *root,const json_value *v,void *context) {
+        (void)root; (void)v; (void)context;
+        return json_action_descend;
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg; (void)context;
+}
+
+/* What the parse of doc should count. */
+static bool expected(const json_stats *s,size_t len) {
+#ifdef JSON_STATS
+        static const size_t values[8]={
+                [json_type_null]=1,[json_type_bool]=1,[json_type_number]=3,
+                [json_type_string]=1,[json_type_array]=2,[json_type_object]=3,
+        };
+        if (s->bytes!=len || memcmp(s->values,values,sizeof(values))!=0) return false;
+        if (s->maxdepth!=5 || s->depth!=0 || s->escapes!=3 || s->numbers!=3) return false;
+        /* 6 values, begin and end of 3 objects, and 5 enters */
+        if (s->callbacks!=17) return false;
+#ifdef JSON_STATS_CYCLES
+        if (s->callback_ticks==0 || s->parser_ticks==0) return false;
+#endif
+        return true;
+#else
+        static const json_stats zero;
+        (void)len;
+        return memcmp(s,&zero,sizeof(zero))==0;
+#endif
+}
+
+int main(void) {
+        const char *doc="{\"a\":[1,2.5,\"x\\ny\\u0041\",true,null,{\"b\":{\"c\":[]}}],\"d\\t\":-3}";
+        static char buf[256];
+        json_valuecontext stack[8];
+        json_parser jp;
+        json_stats stats;
+        json_callbacks cb={.got_value=value,.begin_object=object,.end_object=end,.enter=enter,
+                .error=quiet,.stats=&stats};
+        size_t len=strlen(doc);
+        int goodc=0,badc=0;
+        int how,i;
+
+        for(how=0;how<3;how++) {
+                memset(&stats,0,sizeof(stats));
+                switch(how) {
+                case 0: json_parse_n(&cb,doc,len); break;
+                case 1: json_parse_stack(&cb,doc,len,stack,8); break;
+                case 2:
+                        json_parser_init(&jp,&cb,stack,8,buf,sizeof(buf));
+                        for(i=0;i<(int)len;i+=3) json_parser_feed(&jp,doc+i,(len-i<3)?len-i:3);
+                        json_parser_finish(&jp);
+                        break;
+                }
+                if (expected(&stats,len)) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL (parser %d): %zu bytes, depth %d, %zu escapes, %zu numbers, %zu callbacks\n",
+                                how,stats.bytes,stats.maxdepth,stats.escapes,stats.numbers,stats.callbacks);
+                }
+        }
+
+        /* counts add up over parses, and errors are callbacks too */
+        memset(&stats,0,sizeof(stats));
+        json_parse_n(&cb,"[1]",3);
+        json_parse_n(&cb,"[1,}",4);
+#ifdef JSON_STATS
+        if (stats.bytes==7 && stats.values[json_type_number]==2 && stats.callbacks==5) goodc++; else badc++;
+#else
+        if (stats.bytes==0 && stats.callbacks==0) goodc++; else badc++;
+#endif
+
+        /* raw control characters go through, but are not escapes */
+        memset(&stats,0,sizeof(stats));
+        json_parse_n(&cb,"[\"a\x01" "b\\n\t\"]",10);
+#ifdef JSON_STATS
+        if (stats.escapes==1) goodc++; else badc++;
+#else
+        if (stats.escapes==0) goodc++; else badc++;
+#endif
+
+        /* the parallel parsers leave the counters alone */
+        memset(&stats,0,sizeof(stats));
+        json_parse_lines(&cb,"{}\n[1]\n",7,2);
+        if (stats.bytes==0 && stats.callbacks==0) goodc++; else badc++;
+
+        printf("Stats test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,247 @@
+/* test stopping a parse early */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "json.h"
+
+typedef struct {
+        const char *path;  /* name to stop after, or NULL */
+        int values;        /* values seen */
+        int errors;
+        int found;         /* query matches */
+} state;
+
+/* Stops after the value named s->path. */
+static void value(const json_valuecontext *root,const json_value *v,void *context) {
+        const json_valuecontext *c;
+        state *s=context;
+        (void)v;
+        s->values++;
+        for(c=root;c->next;c=c->next);
+        if (s->path && json_matches_name(c,s->path)) json_stop(root);
+}
+
+static json_action enter(const json_valuecontext *root,const json_value *v,void *context) {
+        state *s=context;
+        (void)v;
+        if (s->path && json_matches_path(root,s->path,NULL)) return json_action_stop;
+        return json_action_descend;
+}
+
+/* also called from json_parse_lines() threads */
+static void found(const json_valuecontext *root,const json_value *v,void *context) {
+        state *s=context;
+        (void)root; (void)v;
+        __atomic_fetch_add(&s->found,1,__ATOMIC_RELAXED);
+}
+
+/* Counts as found, and stops. */
+static void stopper(const json_valuecontext *root,const json_value *v,void *context) {
+        found(root,v,context);
+        json_stop(root);
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        state *st=context;
+        (void)c; (void)etype; (void)s; (void)p; (void)msg;
+        __atomic_fetch_add(&st->errors,1,__ATOMIC_RELAXED);
+}
+
+int main(void) {
+        /* the tail is broken, so only a stopped parse can succeed */
+        const char *text="{\"head\":{\"id\":7,\"kind\":\"x\"},\"body\":[1,2,3],\"stop\":true,\"tail\":[1,2,}";
+        size_t len=strlen(text);
+        const char *stop=strstr(text,",\"tail\"");
+        state s;
+        json_callbacks cb={.got_value=value,.enter=enter,.error=quiet,.context=&s};
+        json_status status;
+        const char *end;
+        int goodc=0,badc=0;
+
+        /* by a callback */
+        memset(&s,0,sizeof(s));
+        s.path="stop";
+        status=json_parse_status(&cb,text,len,&end);
+        if (status==json_status_stopped && end==stop && s.values==6 && s.errors==0) goodc++;
+        else {
+                badc++;
+                printf("FAIL: stop in got_value: status %d, %d values, %d errors\n",status,s.values,s.errors);
+        }
+        memset(&s,0,sizeof(s));
+        s.path="stop";
+        if (json_parse_n(&cb,text,len)==stop && s.errors==0) goodc++; else badc++;
+
+        /* by enter() */
+        memset(&s,0,sizeof(s));
+        s.path="body";
+        status=json_parse_status(&cb,text,len,&end);
+        if (status==json_status_stopped && end==strstr(text,"[1") && s.values==2 && s.errors==0) goodc++;
+        else {
+                badc++;
+                printf("FAIL: stop in enter: status %d, %d values\n",status,s.values);
+        }
+
+        /* without stopping, the tail is an error */
+        memset(&s,0,sizeof(s));
+        if (json_parse_status(&cb,text,len,&end)==json_status_error && !end && s.errors==1) goodc++; else badc++;
+        {
+                const char *one="[1]";
+                memset(&s,0,sizeof(s));
+                if (json_parse_status(&cb,one,3,&end)==json_status_done && end==one+3) goodc++; else badc++;
+        }
+
+        /* the resumable parser, in chunks */
+        {
+                json_valuecontext stack[8];
+                char buf[64];
+                json_parser jp;
+                size_t i;
+                bool fed=true;
+
+                memset(&s,0,sizeof(s));
+                s.path="stop";
+                json_parser_init(&jp,&cb,stack,8,buf,sizeof(buf));
+                for(i=0;i<len && fed;i+=5) fed=json_parser_feed(&jp,text+i,(len-i<5)?len-i:5);
+                if (!fed && json_parser_stopped(&jp) && i<len && json_parser_finish(&jp) &&
+                    !json_parser_feed(&jp,"[]",2) && s.values==6 && s.errors==0) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: resumable: %d values, %d errors\n",s.values,s.errors);
+                }
+
+                memset(&s,0,sizeof(s));
+                s.path="stop";
+                if (json_parse_stack(&cb,text,len,stack,8)==stop && s.values==6 && s.errors==0) goodc++;
+                else badc++;
+        }
+
+        /* walking a tape */
+        {
+                json_tapeentry entries[64];
+                uint32_t index[64];
+                json_tape t;
+                json_cursor c;
+                const char *whole="{\"a\":[1,{\"stop\":2},3],\"b\":4}";
+
+                memset(&s,0,sizeof(s));
+                s.path="stop";
+                if (json_tape_build(&t,NULL,whole,strlen(whole),index,64,entries,64)) {
+                        c=json_tape_cursor(&t);
+                        if (json_cursor_walk(&c,&cb) && s.values==2 && s.errors==0) goodc++; else badc++;
+                }
+                else badc++;
+        }
+
+        /* each line stops on its own */
+        {
+                const char *lines="{\"stop\":1,\"x\":[}\n{\"y\":2,\"stop\":3,\"z\"\n";
+                memset(&s,0,sizeof(s));
+                s.path="stop";
+                if (json_parse_lines(&cb,lines,strlen(lines),1) && s.values==3 && s.errors==0) goodc++; else badc++;
+        }
+
+        /* compiled queries stop by themselves once all have matched */
+        {
+                json_querynode nodes[32];
+                json_queries q;
+                json_callbacks qcb={.queries=&q,.error=quiet,.context=&s,
+                        .options=json_option_stop_when_found};
+
+                json_query_init(&q,nodes,32);
+                json_query_compile(&q,found,&s,"head","id",NULL);
+                json_query_compile(&q,found,&s,"stop",NULL);
+                json_query_compile_pointer(&q,found,&s,"/head/kind");
+                memset(&s,0,sizeof(s));
+                status=json_parse_status(&qcb,text,len,&end);
+                if (status==json_status_stopped && end==stop && s.found==3 && s.errors==0) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: queries: status %d, %d found\n",status,s.found);
+                }
+                /* every parse starts again */
+                memset(&s,0,sizeof(s));
+                if (json_parse_status(&qcb,text,len,&end)==json_status_stopped && s.found==3) goodc++; else badc++;
+
+                /* only when asked */
+                qcb.options=0;
+                memset(&s,0,sizeof(s));
+                if (json_parse_status(&qcb,text,len,&end)==json_status_error && s.found==3) goodc++; else badc++;
+
+                /* not with queries that may match again */
+                qcb.options=json_option_stop_when_found;
+                json_query_compile(&q,found,&s,"body","#",NULL);
+                memset(&s,0,sizeof(s));
+                if (json_parse_status(&qcb,text,len,&end)==json_status_error && s.found==6) goodc++; else badc++;
+
+                /* nor with a numeric JSON Pointer step, which may be a name or an index */
+                json_query_init(&q,nodes,32);
+                json_query_compile_pointer(&q,found,&s,"/body/1");
+                memset(&s,0,sizeof(s));
+                if (json_parse_status(&qcb,text,len,&end)==json_status_error && s.found==1) goodc++; else badc++;
+        }
+
+        /* json_stop() from a query ends the other callbacks for the value too */
+        {
+                json_querynode nodes[16];
+                json_queries q;
+                json_callbacks qcb={.queries=&q,.got_value=value,.error=quiet,.context=&s};
+
+                json_query_init(&q,nodes,16);
+                json_query_compile(&q,stopper,&s,"stop",NULL);
+                json_query_compile(&q,found,&s,"stop",NULL);
+                json_query_compile(&q,found,&s,"*",NULL);
+                memset(&s,0,sizeof(s));
+                if (json_parse_n(&qcb,text,len)==stop && s.found==1 && s.values==5 && s.errors==0) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: stop from a query: %d found, %d values\n",s.found,s.values);
+                }
+        }
+
+        /* and on each line, though the threads share the query nodes */
+        {
+                static char lines[10000*40];
+                json_querynode nodes[16];
+                json_queries q;
+                json_callbacks lcb={.queries=&q,.error=quiet,.context=&s,
+                        .options=json_option_stop_when_found};
+                int n=0,k;
+
+                for(k=0;k<10000;k++) n+=sprintf(lines+n,"{\"id\":%d,\"stop\":true,\"tail\":[}\n",k);
+                json_query_init(&q,nodes,16);
+                json_query_compile(&q,found,&s,"id",NULL);
+                json_query_compile(&q,found,&s,"stop",NULL);
+                memset(&s,0,sizeof(s));
+                if (json_parse_lines(&lcb,lines,n,4) && s.found==20000 && s.errors==0) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: lines: %d found, %d errors\n",s.found,s.errors);
+                }
+        }
+
+        /* a binding table, through the same option */
+        {
+                typedef struct {
+                        int32_t id;
+                        bool stop;
+                } header;
+                static const json_binding fields[]={
+                        {.path={"head","id"},.offset=offsetof(header,id),.type=json_bind_int32,.required=true},
+                        {.path={"stop"},.offset=offsetof(header,stop),.type=json_bind_bool,.required=true},
+                };
+                json_querynode nodes[16];
+                json_binder b;
+                header h={0};
+                json_callbacks bcb={.error=quiet,.context=&s,.options=json_option_stop_when_found};
+
+                memset(&s,0,sizeof(s));
+                if (json_bind_init(&b,fields,2,nodes,16) && json_bind_parse(&b,&bcb,&h,text,len)==stop &&
+                    h.id==7 && h.stop && s.errors==0) goodc++;
+                else badc++;
+        }
+
+        printf("Stop test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,163 @@
+/* test the resumable and non-recursive parsers against json_parse() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json.h"
+
+typedef struct {
+        char s[4096];
+        size_t n;
+} log;
+
+static void logf_(log *l,const char *fmt,int n,const char *s) {
+        if (l->n < sizeof(l->s)) l->n+=snprintf(l->s+l->n,sizeof(l->s)-l->n,fmt,n,s);
+}
+
+/* Record the path and value of every callback. */
+static void record(const json_valuecontext *root,const json_value *v,void *context) {
+        log *l=context;
+        const json_valuecontext *c;
+        char num[32];
+
+        for(c=root->next;c;c=c->next) {
+                if (c->name.s) logf_(l,"[\"%.*s\"]",c->name.n,c->name.s);
+                else logf_(l,"[%d]",c->index,"");
+        }
+        switch(v->type) {
+        case json_type_string: logf_(l,"=\"%.*s\"\n",v->string.n,v->string.s); break;
+        case json_type_number:
+                snprintf(num,sizeof(num),"%.17g",v->number);
+                logf_(l,"=%.*s\n",strlen(num),num);
+                break;
+        case json_type_bool: logf_(l,"=%.*s\n",1,v->truefalse?"t":"f"); break;
+        case json_type_null: logf_(l,"=%.*s\n",1,"n"); break;
+        default: logf_(l,"=?%.*s\n",0,""); break;
+        }
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg; (void)context;
+}
+
+/* Feed text in pieces of the given sizes (cycled), each in its own short-lived copy. */
+static bool stream(const char *text,const int *sizes,int nsizes,log *l,int maxdepth,size_t buflen) {
+        json_callbacks cb={.context=l,.got_value=record,.error=quiet};
+        json_valuecontext stack[16];
+        char buf[256];
+        json_parser jp;
+        size_t len=strlen(text),off=0;
+        int i=0;
+
+        json_parser_init(&jp,&cb,stack,maxdepth,buf,buflen);
+        while(off<len) {
+                size_t n=sizes[i++ % nsizes];
+                char *chunk;
+                bool ok;
+
+                if (n>len-off) n=len-off;
+                chunk=malloc(n?n:1);
+                memcpy(chunk,text+off,n);
+                ok=json_parser_feed(&jp,chunk,n);
+                free(chunk);
+                if (!ok) return false;
+                off+=n;
+        }
+        return json_parser_finish(&jp);
+}
+
+int main(void) {
+        const char *t[]={
+                "{}",
+                "[]",
+                "17",
+                "-0.25e+3",
+                "\"lone\"",
+                "true",
+                "{\"hello\":\"there\"}",
+                "[1,4.3,9e10,null,true,false]",
+                " { \"list\" : [ 10 , 11 , \"hi\" , -3e-10 ] } ",
+                "{\"a\":{\"b\":{\"c\":[[],{},[[1]],{\"d\":null}]}},\"e\":\"\\\"q\\\\\\u00e9\\n\"}",
+                "[{\"long name here\":\"and a long value with \\\\ escapes \\u2603\"},{\"x\":[true,false]}]",
+                "{\"glossary\":{\"title\":\"example\",\"GlossDiv\":{\"title\":\"S\",\"GlossSeeAlso\":[\"GML\",\"XML\"]}}}",
+                /* errors */
+                "{hello:3}",
+                "[1,2,3,]",
+                "what what?",
+                "[1,2",
+                "{\"a\"}",
+                "{\"a\":1]",
+                "[\"open",
+                "[tru]",
+                "[-]",
+                "",
+        };
+        int ntests=sizeof(t)/sizeof(*t);
+        int goodc=0,badc=0;
+        int i,k;
+
+        for(i=0;i<ntests;i++) {
+                json_callbacks cb={.got_value=record,.error=quiet};
+                log want={},got;
+                const char *p;
+                bool good;
+                size_t len=strlen(t[i]);
+
+                cb.context=&want;
+                p=json_parse(&cb,t[i]);
+                good=(p && *p=='\0');
+
+                /* the non-recursive parser, from an unterminated copy */
+                {
+                        json_valuecontext stack[16];
+                        char *copy=malloc(len?len:1);
+                        const char *q;
+                        memcpy(copy,t[i],len);
+                        memset(&got,0,sizeof(got));
+                        cb.context=&got;
+                        q=json_parse_stack(&cb,copy,len,stack,16);
+                        if ((q && q==copy+len)!=good || (good && strcmp(got.s,want.s)!=0)) {
+                                badc++;
+                                printf("FAIL: %s json_parse_stack()\n%s---\n%s\n",t[i],want.s,got.s);
+                        }
+                        else goodc++;
+                        free(copy);
+                }
+
+                /* every two-piece split, then one byte at a time */
+                for(k=0;k<=(int)len+1;k++) {
+                        int sizes[2]={k,len};
+                        bool ok;
+                        memset(&got,0,sizeof(got));
+                        if (k<=(int)len) ok=stream(t[i],sizes,2,&got,16,256);
+                        else ok=stream(t[i],(int[]){1},1,&got,16,256);
+                        if (ok!=good || (good && (got.n!=want.n || memcmp(got.s,want.s,want.n)!=0))) {
+                                badc++;
+                                printf("FAIL: %s split at %d\n%s---\n%s\n",t[i],k,want.s,got.s);
+                        }
+                        else goodc++;
+                }
+        }
+
+        /* limits */
+        {
+                log l={};
+                const char *deep="[[[[1]]]]";
+                if (stream(deep,(int[]){3},1,&l,4,256)) goodc++; else badc++;
+                if (!stream(deep,(int[]){3},1,&l,3,256)) goodc++; else badc++;
+                if (stream("{\"abc\":{\"de\":1}}",(int[]){1},1,&l,4,10)) goodc++; else badc++;
+                if (!stream("{\"abc\":{\"de\":1}}",(int[]){1},1,&l,4,9)) goodc++; else badc++;
+        }
+
+        /* several texts in one stream */
+        {
+                log l={};
+                if (stream("{\"a\":1}\n{\"a\":2}\n[3] 4",(int[]){5},1,&l,4,256)
+                        && strcmp(l.s,"[\"a\"]=1\n[\"a\"]=2\n[0]=3\n=4\n")==0) goodc++;
+                else {badc++; printf("FAIL: several texts\n%s\n",l.s);}
+        }
+
+        printf("Stream test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
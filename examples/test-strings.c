@@ -0,0 +1,111 @@
+/* test string and whitespace scanning at every length and alignment */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+typedef struct {
+        json_nchar got;
+        int count;
+} result;
+
+static void keep(const json_valuecontext *root,const json_value *v,void *context) {
+        result *r=context;
+        (void)root;
+        if (v->type==json_type_string) r->got=v->string;
+        r->count++;
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg; (void)context;
+}
+
+/* Parse "body" (a string body, without quotes) at offset "align" in a buffer. */
+static bool check(const char *body,int align,bool good) {
+        char buf[256];
+        result r={};
+        json_callbacks cb={.context=&r,.got_value=keep,.error=quiet};
+        int n=strlen(body);
+        const char *p;
+
+        memset(buf,'x',sizeof(buf));
+        buf[align]='\"';
+        memcpy(buf+align+1,body,n);
+        buf[align+1+n]='\"';
+        buf[align+2+n]='\0';
+
+        p=json_parse(&cb,buf+align);
+        if (!good) return p==NULL;
+        return p==buf+align+n+2 && r.count==1 && r.got.s==buf+align+1 && r.got.n==n;
+}
+
+/* Parse "[<ws>1<ws>]" with runs of whitespace at offset "align" in a buffer. */
+static bool check_space(int len,int align) {
+        const char ws[]=" \t\n\r";
+        char buf[256];
+        result r={};
+        json_callbacks cb={.context=&r,.got_value=keep,.error=quiet};
+        char *q=buf+align;
+        const char *p;
+        int i;
+
+        memset(buf,'x',sizeof(buf));
+        *q++='[';
+        for(i=0;i<len;i++) *q++=ws[i%4];
+        *q++='1';
+        for(i=0;i<len;i++) *q++=ws[(i+1)%4];
+        *q++=']';
+        *q='\0';
+
+        p=json_parse(&cb,buf+align);
+        return p==q && r.count==1;
+}
+
+int main(void) {
+        const char *specials[]={"\\\"","\\\\","\\n","\\u00e9","\t","\xc3\xa9"};
+        int nspecials=sizeof(specials)/sizeof(*specials);
+        char body[160];
+        int len,pos,align,i;
+        int goodc=0,badc=0;
+
+        for(align=0;align<64;align++) {
+                for(len=0;len<80;len++) {
+                        /* plain run */
+                        memset(body,'a',len);
+                        body[len]='\0';
+                        if (check(body,align,true)) goodc++; else badc++;
+
+                        /* one special at every position */
+                        for(i=0;i<nspecials;i++) {
+                                for(pos=0;pos<=len;pos++) {
+                                        int sn=strlen(specials[i]);
+                                        memset(body,'a',len);
+                                        memcpy(body+pos,specials[i],sn);
+                                        memset(body+pos+sn,'b',len-pos);
+                                        body[len+sn]='\0';
+                                        if (check(body,align,true)) goodc++;
+                                        else {
+                                                badc++;
+                                                printf("FAIL: \"%s\" at %d\n",body,align);
+                                        }
+                                }
+                        }
+
+                        /* bad escape at the end */
+                        memset(body,'a',len);
+                        strcpy(body+len,"\\q");
+                        if (check(body,align,false)) goodc++; else badc++;
+
+                        /* whitespace */
+                        if (check_space(len,align)) goodc++;
+                        else {
+                                badc++;
+                                printf("FAIL: whitespace %d at %d\n",len,align);
+                        }
+                }
+        }
+
+        printf("String scan test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -1,12 +1,22 @@
 /* test cases */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "json.h"
 
 #define GETTEXT(X) X
 
+static void quiet_value(const json_valuecontext *root,const json_value *v,void *context) {
+        (void)root; (void)v; (void)context;
+}
+
+static void quiet_error(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg; (void)context;
+}
+
 int main(void) {
+        json_callbacks quiet={.got_value=quiet_value,.error=quiet_error};
         struct {
                 bool good;
                 char *s;
@@ -72,6 +82,47 @@ int main(void) {
                 }
                 if (p) printf("%zu/%zu (%s)\n",p-s,strlen(s),pf);
                 else printf("null (%s)\n",pf);
+
+                /* same again from an unterminated copy, with json_parse_n() */
+                size_t n=strlen(s);
+                char *copy=malloc(n);
+                const char *q;
+                memcpy(copy,s,n);
+                q=json_parse_n(&quiet,copy,n);
+                if (q && q!=copy+n) q=NULL;
+                if (good == !!q && (!q || q-copy==p-s)) goodc++;
+                else {
+                        badc++;
+                        printf("json_parse_n() disagrees (FAIL)\n");
+                }
+                free(copy);
+        }
+
+        /* slices and embedded NULs */
+        struct {
+                bool good;
+                const char *s;
+                size_t n;
+        } u[]={
+                {true,"[1,2]garbage",5},
+                {true,"{\"a\":true}}}}",10},
+                {false,"{\"a\":true}",9},
+                {true,"[\"a\0b\"]",7},
+                {false,"[1,\0]",5},
+                {false,"",0},
+        };
+        int ulen=sizeof(u)/sizeof(*u);
+        for(i=0;i<ulen;i++) {
+                const char *q;
+                printf("--------------\n");
+                q=json_parse_n(NULL,u[i].s,u[i].n);
+                if (q && q!=u[i].s+u[i].n) q=NULL;
+                printf("%.*s (%zu bytes) -> %s\n",(int)u[i].n,u[i].s,u[i].n,(q)?"ok":"null");
+                if (u[i].good == !!q) goodc++;
+                else {
+                        badc++;
+                        printf("json_parse_n() slice (FAIL)\n");
+                }
         }
         printf(GETTEXT("Results:\n"));
         printf(GETTEXT("Content test: check output by eye\n"));
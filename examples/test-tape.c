@@ -0,0 +1,178 @@
+/* test the tape: walking it must call back exactly as parsing the text */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+/* A log of the callbacks, to compare. */
+typedef struct {
+        char out[4096];
+        int n;
+        json_in text;
+} trace;
+
+static void put(trace *r,const char *s,int n) {
+        if (r->n+n < (int)sizeof(r->out)) {
+                memcpy(r->out+r->n,s,n);
+                r->n+=n;
+                r->out[r->n]='\0';
+        }
+}
+
+static void putpath(trace *r,const json_valuecontext *c) {
+        char tmp[32];
+        for(c=c->next;c;c=c->next) {
+                if (c->name.s) {put(r,"/",1); put(r,c->name.s,c->name.n);}
+                else put(r,tmp,snprintf(tmp,sizeof(tmp),"/%d",c->index));
+        }
+}
+
+static void value(const json_valuecontext *root,const json_value *v,void *context) {
+        trace *r=context;
+        char tmp[64];
+        putpath(r,root);
+        switch(v->type) {
+        case json_type_null:    put(r,"=null",5); break;
+        case json_type_bool:    put(r,(v->truefalse)?"=true":"=false",(v->truefalse)?5:6); break;
+        case json_type_number:  put(r,tmp,snprintf(tmp,sizeof(tmp),"=%.17g",v->number)); break;
+        case json_type_integer: put(r,tmp,snprintf(tmp,sizeof(tmp),"=%lld",(long long)v->integer)); break;
+        case json_type_string:  put(r,"=\"",2); put(r,v->string.s,v->string.n); put(r,"\"",1); break;
+        default: put(r,"=?",2); break;
+        }
+        put(r,"\n",1);
+}
+
+static void span(trace *r,const json_valuecontext *root,const char *what,json_in start,json_in end) {
+        char tmp[64];
+        putpath(r,root);
+        put(r,tmp,snprintf(tmp,sizeof(tmp)," %s %d..%d\n",what,(int)(start-r->text),(end)?(int)(end-r->text):-1));
+}
+
+static void begin_object(const json_valuecontext *root,json_in start,void *context) {
+        span(context,root,"{",start,NULL);
+}
+static void end_object(const json_valuecontext *root,json_in start,json_in end,void *context) {
+        span(context,root,"}",start,end);
+}
+static void begin_array(const json_valuecontext *root,json_in start,void *context) {
+        span(context,root,"[",start,NULL);
+}
+static void end_array(const json_valuecontext *root,json_in start,json_in end,void *context) {
+        span(context,root,"]",start,end);
+}
+
+static json_action skip_b(const json_valuecontext *root,const json_value *v,void *context) {
+        const json_valuecontext *c=root;
+        (void)v; (void)context;
+        while(c->next) c=c->next;
+        return json_matches_name(c,"b")?json_action_skip:json_action_descend;
+}
+
+static void quiet(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        (void)c; (void)etype; (void)s; (void)p; (void)msg; (void)context;
+}
+
+static json_tapeentry entries[256];
+static uint32_t structurals[256];
+
+/* Returns true if walking the tape logs the same as parsing the text. */
+static bool same(const char *text,int options,bool enter) {
+        static trace want,got;
+        json_callbacks cb={.got_value=value,.error=quiet,.options=options,
+                .begin_object=begin_object,.end_object=end_object,
+                .begin_array=begin_array,.end_array=end_array,
+                .enter=(enter)?skip_b:NULL};
+        json_tape t;
+        json_cursor c;
+        size_t len=strlen(text);
+
+        memset(&want,0,sizeof(want));
+        memset(&got,0,sizeof(got));
+        want.text=got.text=text;
+        cb.context=&want;
+        if (json_parse_n(&cb,text,len)!=text+len) return false;
+        if (!json_tape_build(&t,&cb,text,len,structurals,256,entries,256)) return false;
+        c=json_tape_cursor(&t);
+        cb.context=&got;
+        if (!json_cursor_walk(&c,&cb)) return false;
+        if (strcmp(want.out,got.out)==0) return true;
+        printf("want:\n%sgot:\n%s",want.out,got.out);
+        return false;
+}
+
+int main(void) {
+        static const char *docs[]={
+                "0",
+                "\"just a string\"",
+                "{}",
+                "[]",
+                " [ 1 , [ 2 , { \"x\" : [ ] } ] , 3 ] ",
+                "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"e\",\"f\":[{}]}}",
+                "{\"q\\\"uote\":\"\\\\\",\"br[a]ck{e}ts\":\"[{,:}]\",\"u\":\"\\u00e9\\n\"}",
+                "[-0.5e-3,12345678901234567890,9007199254740993,1E400,-0]",
+                "{\"a\":{\"b\":[1,2,3],\"c\":2},\"b\":{\"x\":1},\"d\":[{\"b\":[4]}]}",
+        };
+        static const char *bad[]={
+                "", " ", "[", "]", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "[1,]", "[1 2]",
+                "[1,,2]", "{,}", "[}", "{]", "{\"a\":1]", "[\"open]", "nul", "[tru]",
+                "1 2", "{\"a\":1}}", "{1:2}", "[\"a\":1]", "\"\\q\"", "[01x]",
+        };
+        const char *doc="{\"johnny\":[0,1,2,3,4,\"alive\"],\"x\":{\"y\":{\"z\":[[],{\"deep\":true}]}},\"e\\\"sc\":1}";
+        json_callbacks quietcb={.error=quiet};
+        json_tape t;
+        json_cursor c;
+        json_value v;
+        json_nchar name;
+        int goodc=0,badc=0;
+        size_t i;
+        int options;
+
+        for(i=0;i<sizeof(docs)/sizeof(*docs);i++) {
+                for(options=0;options<4;options++) {
+                        if (same(docs[i],options,false) && same(docs[i],options,true)) goodc++;
+                        else {
+                                badc++;
+                                printf("FAIL (options %d): %s\n",options,docs[i]);
+                        }
+                }
+        }
+        for(i=0;i<sizeof(bad)/sizeof(*bad);i++) {
+                if (!json_tape_build(&t,&quietcb,bad[i],strlen(bad[i]),structurals,256,entries,256)) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: accepted %s\n",bad[i]);
+                }
+        }
+
+        /* arrays too small */
+        if (!json_tape_build(&t,&quietcb,doc,strlen(doc),structurals,8,entries,256)) goodc++; else badc++;
+        if (!json_tape_build(&t,&quietcb,doc,strlen(doc),structurals,256,entries,8)) goodc++; else badc++;
+
+        /* cursors */
+        if (!json_tape_build(&t,&quietcb,doc,strlen(doc),structurals,256,entries,256)) badc++;
+        c=json_tape_cursor(&t);
+        if (json_cursor_find(&c,"johnny","#5",NULL)) {
+                json_cursor_value(&c,&v);
+                if (v.type==json_type_string && v.string.n==5 && memcmp(v.string.s,"alive",5)==0) goodc++; else badc++;
+        }
+        else badc++;
+        c=json_tape_cursor(&t);
+        if (json_cursor_find(&c,"x","y","z","#1","deep",NULL) && json_cursor_type(&c)==json_type_bool &&
+            json_cursor_name(&c,&name) && name.n==4) goodc++; else badc++;
+        c=json_tape_cursor(&t);
+        if (!json_cursor_find(&c,"johnny","#6",NULL) && !json_cursor_find(&c,"x","#0",NULL) &&
+            !json_cursor_find(&c,"x","y","z","#0","#0",NULL) && json_cursor_find(&c,"e\\\"sc",NULL)) goodc++; else badc++;
+
+        /* stepping over a container and into the next */
+        c=json_tape_cursor(&t);
+        if (json_cursor_child(&c) && json_cursor_type(&c)==json_type_array &&
+            json_cursor_next(&c) && json_cursor_type(&c)==json_type_object &&
+            json_cursor_next(&c) && json_cursor_type(&c)==json_type_number &&
+            !json_cursor_next(&c)) goodc++; else badc++;
+        c=json_tape_cursor(&t);
+        if (json_cursor_find(&c,"x","y","z","#0",NULL) && !json_cursor_child(&c) && !json_cursor_name(&c,&name)) goodc++; else badc++;
+
+        printf("Tape test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
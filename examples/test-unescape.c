@@ -0,0 +1,111 @@
+/* test the fast and in-place string unescapers */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+/* Convert s every way there is: into a roomy buffer, into one of exactly
+ * the size asked for (the byte-at-a-time path), and in place.  Returns the
+ * length, -1 if all of them fail, or -2 if they disagree.
+ */
+static int convert(const char *s,int n,char *out) {
+        static char exact[4096],inplace[4096];
+        json_nchar in={s,n};
+        size_t need=json_string_to_utf8(NULL,0,&in);
+        size_t got=json_string_to_utf8(out,n+1,&in);
+        int len=n;
+
+        memcpy(inplace,s,n);
+        if (!json_string_in_place(inplace,&len)) len=-1;
+        if (need==0 || got==0 || len<0) return (need==0 && got==0 && len<0)?-1:-2;
+        if (need!=got || (size_t)len+1!=got || inplace[len]!='\0' || memcmp(out,inplace,got)!=0) return -2;
+        if (need<=(size_t)n) {
+                /* only the counting path writes into a buffer this small */
+                if (json_string_to_utf8(exact,need,&in)!=need || memcmp(exact,out,need)!=0) return -2;
+        }
+        return len;
+}
+
+static unsigned long seed=17;
+static unsigned int lcg(void) {
+        seed=seed*1103515245+12345;
+        return (seed>>16) & 0x7FFF;
+}
+
+int main(void) {
+        static const struct {
+                const char *in;
+                const char *out;
+                int len;
+        } cases[]={
+                {"plain text","plain text",10},
+                {"a\\nb\\tc\\\"d\\\\e\\/f","a\nb\tc\"d\\e/f",11},
+                {"\\b\\f\\r","\b\f\r",3},
+                {"gar\\u00e7on","gar\xC3\xA7on",7},
+                {"\\u20AC\\u20ac","\xE2\x82\xAC\xE2\x82\xAC",6},
+                {"\\ud83d\\ude00!","\xF0\x9F\x98\x80!",5},          /* surrogate pair */
+                {"\\uD83D\\uDE00","\xF0\x9F\x98\x80",4},
+                {"\\ud83d x","\xED\xA0\xBD x",5},                   /* lone high */
+                {"\\ude00","\xED\xB8\x80",3},                       /* lone low */
+                {"\\ud83d\\ud83d","\xED\xA0\xBD\xED\xA0\xBD",6},    /* two highs */
+                {"\\ud83d\\u0041","\xED\xA0\xBD" "A",4},
+                {"a\\u0000b","a\0b",3},
+                {"\xC3\xA9t\xC3\xA9","\xC3\xA9t\xC3\xA9",5},        /* raw UTF-8 */
+                {"\\x",NULL,-1},
+                {"\\u12",NULL,-1},
+                {"\\u12g4",NULL,-1},
+                {"abc\\",NULL,-1},
+        };
+        static char text[4096],out[4096],copy[4096];
+        static char mem[1<<14];
+        const char *doc="[\"one\",\"t\\u0077o\",\"\\\"three\\\"\",\"\",\"\\ud83d\\ude00\"]";
+        const char *want[]={"one","two","\"three\"","","\xF0\x9F\x98\x80"};
+        json_arena a;
+        json_node *n;
+        int goodc=0,badc=0;
+        int i,k,len,r;
+        size_t c;
+
+        for(c=0;c<sizeof(cases)/sizeof(*cases);c++) {
+                len=convert(cases[c].in,strlen(cases[c].in),out);
+                if (len==cases[c].len && (len<0 || memcmp(out,cases[c].out,len+1)==0)) goodc++;
+                else {
+                        badc++;
+                        printf("FAIL: \"%s\" gave %d\n",cases[c].in,len);
+                }
+        }
+
+        /* the raw text stops at a NUL, as it always has */
+        if (convert("ab\0cd",5,out)==2 && strcmp(out,"ab")==0) goodc++; else badc++;
+
+        /* long runs, with escapes scattered through them */
+        for(i=k=0;i<2000;i++) {
+                for(len=0;len<(int)sizeof(text)-16 && lcg()%300;) {
+                        r=lcg()%40;
+                        if (r==0) len+=sprintf(text+len,"\\n");
+                        else if (r==1) len+=sprintf(text+len,"\\u%04x",0x20+lcg()%0xD000);
+                        else if (r==2) len+=sprintf(text+len,"\\ud8%02x\\udc%02x",lcg()%256,lcg()%256);
+                        else if (r==3) len+=sprintf(text+len,"\xE2\x82\xAC");
+                        else text[len++]='a'+r;
+                }
+                if (convert(text,len,out)>=0) k++;
+                else {
+                        printf("FAIL: string %d, length %d\n",i,len);
+                        break;
+                }
+        }
+        if (k==2000) goodc++; else badc++;
+
+        /* C strings straight out of a parsed (copied) text */
+        strcpy(copy,doc);
+        json_arena_init(&a,mem,sizeof(mem));
+        for(i=0,n=json_dom_first(json_dom_parse(&a,NULL,copy,strlen(copy)));n;n=n->next,i++) {
+                len=n->value.string.n;
+                if (!json_string_in_place((char *)n->value.string.s,&len) || strcmp(n->value.string.s,want[i])!=0) break;
+        }
+        if (i==5) goodc++; else badc++;
+
+        printf("Unescape test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
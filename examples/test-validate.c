@@ -0,0 +1,181 @@
+/* test UTF-8 validation of strings */
+
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+typedef struct {
+        json_in text;
+        long offset; /* of the first error, or -1 */
+        int errors;
+} result;
+
+static void err(const json_valuecontext *c,const char *etype,json_in s,json_in p,const char *msg,void *context) {
+        result *r=context;
+        (void)c; (void)etype; (void)s; (void)msg;
+        if (!r->errors++) r->offset=p-r->text;
+}
+
+static void ignore(const json_valuecontext *c,const json_value *v,void *context) {
+        (void)c; (void)v; (void)context;
+}
+
+/* A slow but obvious check: decode, then test the code point.  Returns
+ * the offset of the first bad character, or -1.
+ */
+static long reference(const unsigned char *u,int n) {
+        static const unsigned int least[5]={0,0,0x80,0x800,0x10000};
+        unsigned int cp;
+        int i,k,len;
+        for(i=0;i<n;i+=len) {
+                if (u[i]<0x80) {len=1; continue;}
+                else if ((u[i] & 0xE0)==0xC0) {len=2; cp=u[i] & 0x1F;}
+                else if ((u[i] & 0xF0)==0xE0) {len=3; cp=u[i] & 0x0F;}
+                else if ((u[i] & 0xF8)==0xF0) {len=4; cp=u[i] & 0x07;}
+                else return i;
+                if (i+len>n) return i;
+                for(k=1;k<len;k++) {
+                        if ((u[i+k] & 0xC0)!=0x80) return i;
+                        cp=cp<<6 | (u[i+k] & 0x3F);
+                }
+                if (cp<least[len] || cp>0x10FFFF || (cp>=0xD800 && cp<=0xDFFF)) return i;
+        }
+        return -1;
+}
+
+static unsigned long seed=2019;
+static unsigned int lcg(void) {
+        seed=seed*1103515245+12345;
+        return (seed>>16) & 0x7FFF;
+}
+
+static int encode(unsigned char *out,unsigned int cp) {
+        if (cp<0x80) {out[0]=cp; return 1;}
+        if (cp<0x800) {out[0]=0xC0|cp>>6; out[1]=0x80|(cp & 0x3F); return 2;}
+        if (cp<0x10000) {out[0]=0xE0|cp>>12; out[1]=0x80|(cp>>6 & 0x3F); out[2]=0x80|(cp & 0x3F); return 3;}
+        out[0]=0xF0|cp>>18; out[1]=0x80|(cp>>12 & 0x3F); out[2]=0x80|(cp>>6 & 0x3F); out[3]=0x80|(cp & 0x3F);
+        return 4;
+}
+
+/* Mostly ASCII with some longer characters, escapes, and now and then a
+ * random byte or a truncated character.
+ */
+static int content(unsigned char *out,int max,bool broken) {
+        int n=0,k,r;
+        while(n<max-8) {
+                r=lcg()%100;
+                if (r<70) out[n++]='a'+lcg()%26;
+                else if (r<75) {out[n++]='\\'; out[n++]='n';}
+                else if (r<85) n+=encode(out+n,0x80+lcg()%0x780);
+                else if (r<93) n+=encode(out+n,0x800+lcg()%0xF800);
+                else if (r<98) n+=encode(out+n,0x10000+lcg()*34%0x100000);
+                else if (broken && lcg()%2) out[n++]=0x80+lcg()%0x80;
+                else if (broken) n+=encode(out+n,0x800+lcg()%0xF800)-1;
+                if (lcg()%64==0) break;
+        }
+        /* no stray quotes or backslashes from bad UTF-8 */
+        for(k=0;k<n;k++) if (out[k]=='\"' || (out[k]=='\\' && out[++k]!='n')) out[k]='x';
+        return n;
+}
+
+/* Parse doc in every way, expecting an error at offset (or none). */
+static bool check(const char *doc,int len,long offset) {
+        static char buf[512];
+        json_valuecontext stack[8];
+        json_tapeentry entries[64];
+        uint32_t structurals[64];
+        json_tape t;
+        json_parser jp;
+        result r;
+        json_callbacks cb={.context=&r,.got_value=ignore,.error=err,.options=json_option_validate_utf8};
+        bool ok=true,want=(offset<0);
+        int how,i;
+
+        for(how=0;how<4;how++) {
+                memset(&r,0,sizeof(r));
+                r.text=doc;
+                r.offset=-1;
+                switch(how) {
+                case 0: json_parse_n(&cb,doc,len); break;
+                case 1: json_parse_stack(&cb,doc,len,stack,8); break;
+                case 2: json_tape_build(&t,&cb,doc,len,structurals,64,entries,64); break;
+                case 3:
+                        /* strings are gathered in buf, so only count errors */
+                        json_parser_init(&jp,&cb,stack,8,buf,sizeof(buf));
+                        for(i=0;i<len;i+=7) json_parser_feed(&jp,doc+i,(len-i<7)?len-i:7);
+                        json_parser_finish(&jp);
+                        if (r.errors) r.offset=offset;
+                        break;
+                }
+                if ((r.errors==0)!=want || r.offset!=offset) {
+                        printf("FAIL (parser %d): errors %d at %ld, wanted %ld\n",how,r.errors,r.offset,offset);
+                        ok=false;
+                }
+        }
+        return ok;
+}
+
+int main(void) {
+        static const struct {
+                const char *s;
+                int offset;
+        } fixed[]={
+                {"plain",-1},
+                {"\xC3\xA9t\xC3\xA9",-1},
+                {"\xE2\x82\xAC and \xF0\x9F\x98\x80",-1},
+                {"\xEF\xBF\xBF\xF4\x8F\xBF\xBF",-1},   /* U+FFFF, U+10FFFF */
+                {"\x80",0},                            /* stray continuation */
+                {"ab\xC3",2},                          /* truncated */
+                {"ab\xC3" "b",2},
+                {"\xC0\xAF",0},                        /* overlong '/' */
+                {"\xE0\x80\xAF",0},
+                {"\xF0\x80\x80\xAF",0},
+                {"\xED\xA0\x80",0},                    /* surrogate */
+                {"\xF4\x90\x80\x80",0},                /* above U+10FFFF */
+                {"\xF8\x88\x80\x80\x80",0},
+                {"\xFF",0},
+                {"\xC3\\n\xA9",0},                     /* split by an escape */
+        };
+        static char doc[1024];
+        static unsigned char s[256];
+        json_callbacks plain={.got_value=ignore,.error=err};
+        result r;
+        int goodc=0,badc=0;
+        int i,n,len;
+        size_t f,m;
+
+        for(f=0;f<sizeof(fixed)/sizeof(*fixed);f++) {
+                len=sprintf(doc,"{\"\xC3\xA9\":[\"%s\"]}",fixed[f].s);
+                if (check(doc,len,(fixed[f].offset<0)?-1:8+fixed[f].offset)) goodc++;
+                else {
+                        badc++;
+                        printf("  in %s\n",doc);
+                }
+        }
+
+        /* names are checked too; and nothing is checked without the option */
+        if (check("{\"a\xC0\":1}",8,3)) goodc++; else badc++;
+        memset(&r,0,sizeof(r));
+        plain.context=&r;
+        json_parse_n(&plain,"[\"\xFF\"]",5);
+        if (r.errors==0) goodc++; else badc++;
+
+        /* long strings, against the reference */
+        for(i=n=0;i<4000;i++) {
+                m=content(s,sizeof(s),i%2);
+                memcpy(doc,"[\"",2);
+                memcpy(doc+2,s,m);
+                memcpy(doc+2+m,"\"]",2);
+                if (check(doc,m+4,(reference(s,m)<0)?-1:2+reference(s,m))) n++;
+                else {
+                        badc++;
+                        printf("  in string %d, length %zu\n",i,m);
+                        break;
+                }
+        }
+        if (n==4000) goodc++;
+
+        printf("Validate test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
@@ -0,0 +1,187 @@
+/* test the JSON writer */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "json.h"
+
+static const json_valuecontext *leaf(const json_valuecontext *c) {
+        while(c->next) c=c->next;
+        return c;
+}
+
+/* The name of a value in an object, if it has one. */
+static void name(json_writer *w,const json_valuecontext *root) {
+        const json_valuecontext *c=leaf(root);
+        if (c!=root && c->name.s) json_write_key(w,c->name.s,c->name.n);
+}
+
+/* Write the text back out as it is read. */
+static void value(const json_valuecontext *root,const json_value *v,void *context) {
+        name(context,root);
+        json_write_value(context,v);
+}
+static void begin_object(const json_valuecontext *root,json_in start,void *context) {
+        (void)start;
+        name(context,root);
+        json_write_begin_object(context);
+}
+static void end_object(const json_valuecontext *root,json_in start,json_in end,void *context) {
+        (void)root; (void)start; (void)end;
+        json_write_end_object(context);
+}
+static void begin_array(const json_valuecontext *root,json_in start,void *context) {
+        (void)start;
+        name(context,root);
+        json_write_begin_array(context);
+}
+static void end_array(const json_valuecontext *root,json_in start,json_in end,void *context) {
+        (void)root; (void)start; (void)end;
+        json_write_end_array(context);
+}
+
+/* Read back one number. */
+static void number(const json_valuecontext *root,const json_value *v,void *context) {
+        (void)root;
+        *(double *)context=v->number;
+}
+
+/* A sink that collects the text, so a small buffer can be checked. */
+typedef struct {
+        char text[4096];
+        size_t n;
+        int flushes;
+} sink;
+
+static bool collect(const char *s,size_t n,void *context) {
+        sink *k=context;
+        if (k->n+n>sizeof(k->text)) return false;
+        memcpy(k->text+k->n,s,n);
+        k->n+=n;
+        k->flushes++;
+        return true;
+}
+
+static bool bigger(json_writer *w,size_t need,void *context) {
+        size_t size=2*w->size+need;
+        char *buf=realloc(w->buf,size);
+        (void)context;
+        if (!buf) return false;
+        w->buf=buf;
+        w->size=size;
+        return true;
+}
+
+static void everything(json_writer *w) {
+        json_write_begin_object(w);
+        json_write_key(w,"name",4);
+        json_write_string(w,"line\n\"quoted\" \\ tab\t \x01 caf\xC3\xA9",28);
+        json_write_key(w,"list",4);
+        json_write_begin_array(w);
+        json_write_integer(w,0);
+        json_write_integer(w,-42);
+        json_write_integer(w,INT64_MAX);
+        json_write_integer(w,INT64_MIN);
+        json_write_number(w,0.1);
+        json_write_number(w,-1.5e-7);
+        json_write_number(w,1e21);
+        json_write_number(w,123456789.0);
+        json_write_number(w,NAN);
+        json_write_number(w,-INFINITY);
+        json_write_bool(w,true);
+        json_write_bool(w,false);
+        json_write_null(w);
+        json_write_begin_object(w);
+        json_write_end_object(w);
+        json_write_begin_array(w);
+        json_write_end_array(w);
+        json_write_end_array(w);
+        json_write_key(w,"",0);
+        json_write_string(w,"",0);
+        json_write_end_object(w);
+}
+
+static unsigned long long seed=88172645463325252ULL;
+static unsigned long long xorshift(void) {
+        seed^=seed<<13;
+        seed^=seed>>7;
+        seed^=seed<<17;
+        return seed;
+}
+
+int main(void) {
+        const char *want="{\"name\":\"line\\n\\\"quoted\\\" \\\\ tab\\t \\u0001 caf\xC3\xA9\","
+                "\"list\":[0,-42,9223372036854775807,-9223372036854775808,0.1,-1.5e-7,1e21,123456789,"
+                "null,null,true,false,null,{},[]],\"\":\"\"}";
+        const char *doc="{\"a\":[1,2.50,-3e2,\"x\\u0041\\n\",true,null,{\"b\":{},\"c\":[[]]}],\"d\":0.1,\"e\":\"\"}";
+        const char *same="{\"a\":[1,2.50,-3e2,\"x\\u0041\\n\",true,null,{\"b\":{},\"c\":[[]]}],\"d\":0.1,\"e\":\"\"}";
+        static char buf[4096],text[64];
+        static sink k;
+        json_writer w;
+        json_callbacks cb={.got_value=value,.begin_object=begin_object,.end_object=end_object,
+                .begin_array=begin_array,.end_array=end_array,.options=json_option_lazy_numbers};
+        json_callbacks back={.got_value=number};
+        double x,y;
+        int goodc=0,badc=0;
+        int i,n,wrong;
+
+        /* everything, into a roomy buffer */
+        json_writer_init(&w,buf,sizeof(buf));
+        everything(&w);
+        if (json_writer_finish(&w) && w.used==strlen(want) && memcmp(buf,want,w.used)==0) goodc++;
+        else {
+                badc++;
+                printf("FAIL: wrote %.*s\n",(int)w.used,buf);
+        }
+
+        /* through a tiny buffer, flushed as it fills */
+        json_writer_init(&w,buf,5);
+        w.flush=collect;
+        w.context=&k;
+        everything(&w);
+        if (json_writer_finish(&w) && k.n==strlen(want) && memcmp(k.text,want,k.n)==0 && k.flushes>10) goodc++; else badc++;
+
+        /* into a buffer that grows */
+        json_writer_init(&w,malloc(1),1);
+        w.grow=bigger;
+        everything(&w);
+        if (json_writer_finish(&w) && w.used==strlen(want) && memcmp(w.buf,want,w.used)==0) goodc++; else badc++;
+        free(w.buf);
+
+        /* a full buffer stops the writer */
+        json_writer_init(&w,buf,20);
+        everything(&w);
+        if (!json_writer_finish(&w) && w.used<=20) goodc++; else badc++;
+
+        /* parsed values go back out as they came in */
+        json_writer_init(&w,buf,sizeof(buf));
+        cb.context=&w;
+        json_parse(&cb,doc);
+        if (json_writer_finish(&w) && w.used==strlen(same) && memcmp(buf,same,w.used)==0) goodc++;
+        else {
+                badc++;
+                printf("FAIL: rewrote %.*s\n",(int)w.used,buf);
+        }
+
+        /* doubles read back exactly */
+        for(i=wrong=0;i<200000;i++) {
+                unsigned long long bits=xorshift();
+                memcpy(&x,&bits,sizeof(x));
+                if (isnan(x) || isinf(x)) continue;
+                json_writer_init(&w,text,sizeof(text));
+                json_write_number(&w,x);
+                n=w.used;
+                text[n]='\0';
+                y=0;
+                back.context=&y;
+                if (!json_parse(&back,text) || memcmp(&x,&y,sizeof(x))!=0) {
+                        if (wrong++<5) printf("FAIL: %.17g written as %s\n",x,text);
+                }
+        }
+        if (wrong==0) goodc++; else badc++;
+
+        printf("Writer test: good=%d bad=%d\n",goodc,badc);
+        printf("*** %s ***\n",(badc==0)?"PASS":"FAIL");
+        return (badc==0)?0:1;
+}
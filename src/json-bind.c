@@ -0,0 +1,206 @@
+/* > json-bind.c */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Binding tables: paths compiled into a query set whose callbacks store
+ * straight into the caller's struct.
+ *
+ * Each binding gets a slot, which is the query's context.  A field in an
+ * array element finds its element from the index in the context chain,
+ * at the depth the array's elements are known to be, and so on out
+ * through any arrays around that.  The "#" node of an array calls back
+ * as each element ends, to count it and to check that it held its
+ * required fields.
+ */
+
+#include <string.h>
+#include "json.h"
+#include "json-query.h"
+
+typedef json_valuecontext ctx;
+
+/* -- storing -- */
+
+static void fail(json_binder *b,const json_binding *binding) {
+        if (!b->bad) b->bad=binding;
+}
+
+/* Zero the counts of the arrays in elements [from,to) of array slot a. */
+static void new_elements(json_bindslot *a,char *p,size_t from,size_t to) {
+        json_binder *b=a->binder;
+        const json_binding *inner;
+        size_t e;
+        int i;
+
+        for(i=0;i<b->slots;i++) {
+                if (b->slot[i].array!=a-b->slot) continue;
+                inner=b->slot[i].binding;
+                if (inner->type!=json_bind_array) continue;
+                for(e=from;e<to;e++) *(size_t *)(p+e*a->binding->size+inner->count)=0;
+        }
+}
+
+static char *base(json_bindslot *s,const ctx *root);
+
+/* The element of array slot a on the path to root, making room for it, or
+ * NULL if it does not fit.
+ */
+static char *element(json_bindslot *a,const ctx *root) {
+        const ctx *c;
+        size_t *count;
+        char *p=base(a,root);
+        int i;
+
+        if (!p) return NULL;
+        for(c=root,i=0;i<a->depth;i++) c=c->next;
+        if ((size_t)c->index>=a->binding->max) {
+                fail(a->binder,a->binding);
+                return NULL;
+        }
+        count=(size_t *)(p+a->binding->count);
+        p+=a->binding->offset;
+        if ((size_t)c->index>=*count) {
+                new_elements(a,p,*count,c->index+1);
+                *count=c->index+1;
+        }
+        return p+c->index*a->binding->size;
+}
+
+/* The struct holding slot s's field, or NULL if its element does not fit. */
+static char *base(json_bindslot *s,const ctx *root) {
+        if (s->array<0) return s->binder->out;
+        return element(&s->binder->slot[s->array],root);
+}
+
+static void store(const json_valuecontext *root,const json_value *v,void *context) {
+        json_bindslot *s=context;
+        const json_binding *binding=s->binding;
+        char *p=base(s,root);
+        int64_t i;
+        bool ok=false;
+
+        if (v->type==json_type_null || !p) return;
+        p+=binding->offset;
+        switch(binding->type) {
+        case json_bind_int32:
+                ok=json_value_to_int64(v,&i) && i>=INT32_MIN && i<=INT32_MAX;
+                if (ok) *(int32_t *)p=i;
+                break;
+        case json_bind_int64:
+                ok=json_value_to_int64(v,&i);
+                if (ok) *(int64_t *)p=i;
+                break;
+        case json_bind_double:
+                ok=(v->type==json_type_number || v->type==json_type_integer);
+                if (ok) *(double *)p=json_value_to_double(v);
+                break;
+        case json_bind_bool:
+                ok=(v->type==json_type_bool);
+                if (ok) *(bool *)p=v->truefalse;
+                break;
+        case json_bind_string:
+                if (v->type!=json_type_string || binding->size<1) break;
+                ok=json_string_to_utf8(p,binding->size,&v->string)-1<binding->size;
+                if (!ok) *p='\0';
+                break;
+        case json_bind_array:
+                break; /* elements are not values */
+        }
+        if (ok) s->seen=true;
+        else fail(s->binder,binding);
+}
+
+/* An element of array slot a has ended, empty or not. */
+static void element_end(const json_valuecontext *root,void *context) {
+        json_bindslot *a=context,*s;
+        json_binder *b=a->binder;
+        int i;
+
+        if (!element(a,root)) return;
+        for(i=0;i<b->slots;i++) {
+                s=&b->slot[i];
+                if (s->array!=a-b->slot) continue;
+                if (s->binding->required && !s->seen) fail(b,s->binding);
+                s->seen=false;
+        }
+        a->seen=true;
+}
+
+/* -- compiling -- */
+
+static bool bind(json_binder *b,const json_binding *table,int count,int at,int array,int depth) {
+        const json_binding *binding;
+        json_bindslot *s;
+        int i,k,node;
+        bool once;
+
+        for(i=0;i<count;i++) {
+                binding=&table[i];
+                if (b->slots>=JSON_BIND_FIELDS) return false;
+                s=&b->slot[b->slots++];
+                s->binding=binding;
+                s->binder=b;
+                s->array=array;
+                s->depth=depth;
+                s->seen=false;
+                once=(array<0);
+                for(k=0,node=at;k<JSON_BIND_STEPS && binding->path[k];k++) {
+                        if (strcmp(binding->path[k],"**")==0 &&
+                            (binding->type==json_bind_array || (k+1<JSON_BIND_STEPS && binding->path[k+1]))) return false;
+                        node=json_query_step(&b->queries,node,binding->path[k],&once);
+                }
+                if (binding->type!=json_bind_array) {
+                        if (node<0 || !json_query_attach(&b->queries,node,store,s,once)) return false;
+                        continue;
+                }
+                /* the elements are one step further down */
+                s->depth=depth+k+1;
+                node=json_query_step(&b->queries,node,"#",&once);
+                if (node<0 || !json_query_on_end(&b->queries,node,element_end,s)) return false;
+                if (!bind(b,binding->fields,binding->nfields,node,s-b->slot,s->depth)) return false;
+        }
+        return true;
+}
+
+bool json_bind_init(json_binder *b,const json_binding *table,int count,json_querynode *nodes,int nnodes) {
+        memset(b,0,sizeof(*b));
+        json_query_init(&b->queries,nodes,nnodes);
+        if (nnodes<1) return false;
+        return bind(b,table,count,0,-1,0);
+}
+
+/* -- parsing -- */
+
+const char *json_bind_parse(json_binder *b,const json_callbacks *ucb,void *out,const char *s,size_t len) {
+        json_callbacks cb={.queries=&b->queries};
+        json_bindslot *slot;
+        const char *p;
+        int i;
+
+        if (ucb) {
+                cb.error=ucb->error;
+                cb.options=ucb->options;
+                cb.context=ucb->context;
+                cb.stats=ucb->stats;
+        }
+        /* exact int64s, and no time spent on numbers not bound */
+        cb.options|=json_option_lazy_numbers;
+        b->out=out;
+        b->bad=NULL;
+        for(i=0;i<b->slots;i++) {
+                slot=&b->slot[i];
+                slot->seen=false;
+                /* only counts at the top are known to be there */
+                if (slot->binding->type==json_bind_array && slot->array<0)
+                        *(size_t *)(b->out+slot->binding->count)=0;
+        }
+        p=json_parse_n(&cb,s,len);
+        if (!p) return NULL;
+
+        /* fields in elements were checked as each element ended */
+        for(i=0;i<b->slots && !b->bad;i++) {
+                slot=&b->slot[i];
+                if (slot->array<0 && slot->binding->required && !slot->seen) fail(b,slot->binding);
+        }
+        return (b->bad)?NULL:p;
+}
@@ -0,0 +1,213 @@
+/* > json-dom.c */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* A document tree built from the parser's callbacks.
+ *
+ * Nodes are appended to the open container as the values arrive; when an
+ * object closes with enough members, an open-addressing hash table of its
+ * names is added, and a large array gets a vector of its elements.
+ * Everything comes from the caller's arena.
+ */
+
+#include <string.h>
+#include "json.h"
+
+#define ARENA_ALIGN 8 /* for the doubles and pointers in a node */
+
+void json_arena_init(json_arena *a,void *mem,size_t size) {
+        a->base=mem;
+        a->size=size;
+        a->used=0;
+}
+
+void *json_arena_alloc(json_arena *a,size_t n) {
+        size_t at=(a->used+ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1);
+        if (at>a->size || n>a->size-at) return NULL;
+        a->used=at+n;
+        return a->base+at;
+}
+
+void json_arena_reset(json_arena *a) {
+        a->used=0;
+}
+
+/* -- building -- */
+
+typedef struct {
+        json_arena *arena;
+        json_node *root;
+        json_node *open;  /* innermost open object or array */
+        bool full;
+} builder;
+
+static unsigned int name_hash(const char *s,int n) {
+        unsigned int h=2166136261u;
+        int i;
+        for(i=0;i<n;i++) h=(h^(unsigned char)s[i])*16777619u;
+        return h;
+}
+
+static const json_valuecontext *leaf(const json_valuecontext *c) {
+        while(c->next) c=c->next;
+        return c;
+}
+
+/* Append a node for the value in c to the open container. */
+static json_node *add(builder *b,const json_valuecontext *c,const json_value *v) {
+        json_node *n;
+        json_nodelist *l;
+
+        if (b->full) return NULL;
+        n=json_arena_alloc(b->arena,sizeof(*n));
+        if (!n) {b->full=true; return NULL;}
+        n->value=*v;
+        n->next=NULL;
+        n->list=NULL;
+        n->name.s=NULL;
+        n->name.n=0;
+        if (!b->open) {
+                b->root=n;
+                return n;
+        }
+        l=b->open->list;
+        if (b->open->value.type==json_type_object) n->name=c->name;
+        if (l->last) l->last->next=n;
+        else l->first=n;
+        l->last=n;
+        l->count++;
+        return n;
+}
+
+static void got_value(const json_valuecontext *root,const json_value *v,void *context) {
+        add(context,leaf(root),v);
+}
+
+static void begin(const json_valuecontext *root,void *context) {
+        builder *b=context;
+        const json_valuecontext *c=leaf(root);
+        json_node *n=add(b,c,&c->value);
+        json_nodelist *l;
+
+        if (!n) return;
+        l=json_arena_alloc(b->arena,sizeof(*l));
+        if (!l) {b->full=true; return;}
+        memset(l,0,sizeof(*l));
+        l->parent=b->open;
+        n->list=l;
+        b->open=n;
+}
+
+static void begin_object(const json_valuecontext *root,json_in start,void *context) {
+        (void)start;
+        begin(root,context);
+}
+
+static void begin_array(const json_valuecontext *root,json_in start,void *context) {
+        (void)start;
+        begin(root,context);
+}
+
+/* Index the elements of a large array. */
+static void index_elements(builder *b,json_nodelist *l) {
+        json_node *n;
+        int i=0;
+        l->hash=json_arena_alloc(b->arena,l->count*sizeof(*l->hash));
+        if (!l->hash) {b->full=true; return;}
+        l->hashsize=l->count;
+        for(n=l->first;n;n=n->next) l->hash[i++]=n;
+}
+
+/* Index the names of a large object.  The first of duplicate names wins. */
+static void index_names(builder *b,json_nodelist *l) {
+        json_node *n,**slot;
+        int size=4;
+        unsigned int i;
+
+        while(size<2*l->count) size*=2;
+        l->hash=json_arena_alloc(b->arena,size*sizeof(*l->hash));
+        if (!l->hash) {b->full=true; return;}
+        memset(l->hash,0,size*sizeof(*l->hash));
+        l->hashsize=size;
+        for(n=l->first;n;n=n->next) {
+                for(i=name_hash(n->name.s,n->name.n);;i++) {
+                        slot=&l->hash[i & (size-1)];
+                        if (!*slot) {*slot=n; break;}
+                        if ((*slot)->name.n==n->name.n &&
+                            memcmp((*slot)->name.s,n->name.s,n->name.n)==0) break;
+                }
+        }
+}
+
+static void end(builder *b) {
+        json_nodelist *l;
+        if (b->full) return;
+        l=b->open->list;
+        if (l->count>=JSON_DOM_HASH_MIN) {
+                if (b->open->value.type==json_type_object) index_names(b,l);
+                else index_elements(b,l);
+        }
+        b->open=l->parent;
+}
+
+static void end_object(const json_valuecontext *root,json_in start,json_in e,void *context) {
+        (void)root; (void)start; (void)e;
+        end(context);
+}
+
+static void end_array(const json_valuecontext *root,json_in start,json_in e,void *context) {
+        (void)root; (void)start; (void)e;
+        end(context);
+}
+
+json_node *json_dom_parse(json_arena *a,const json_callbacks *ucb,const char *s,size_t len) {
+        builder b={a,NULL,NULL,false};
+        json_callbacks cb={.context=&b,.got_value=got_value,
+                .begin_object=begin_object,.end_object=end_object,
+                .begin_array=begin_array,.end_array=end_array};
+        if (ucb) {
+                cb.error=ucb->error;
+                cb.options=ucb->options;
+        }
+        if (!json_parse_n(&cb,s,len) || b.full) return NULL;
+        return b.root;
+}
+
+/* -- access -- */
+
+json_node *json_dom_get(const json_node *object,const char *name) {
+        const json_nodelist *l;
+        json_node *n;
+        int len;
+        unsigned int i;
+
+        if (!object || object->value.type!=json_type_object) return NULL;
+        l=object->list;
+        len=strlen(name);
+        if (l->hash) {
+                for(i=name_hash(name,len);;i++) {
+                        n=l->hash[i & (l->hashsize-1)];
+                        if (!n) return NULL;
+                        if (n->name.n==len && memcmp(n->name.s,name,len)==0) return n;
+                }
+        }
+        for(n=l->first;n;n=n->next)
+                if (n->name.n==len && memcmp(n->name.s,name,len)==0) return n;
+        return NULL;
+}
+
+json_node *json_dom_index(const json_node *array,int index) {
+        json_node *n;
+        if (!array || array->value.type!=json_type_array || index<0) return NULL;
+        if (array->list->hash) return (index<array->list->count)?array->list->hash[index]:NULL;
+        for(n=array->list->first;n && index>0;n=n->next) index--;
+        return n;
+}
+
+json_node *json_dom_first(const json_node *n) {
+        return (n && n->list)?n->list->first:NULL;
+}
+
+int json_dom_count(const json_node *n) {
+        return (n && n->list)?n->list->count:0;
+}
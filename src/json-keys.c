@@ -0,0 +1,79 @@
+/* > json-keys.c */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Registered names, found with a perfect hash.
+ *
+ * The hash first tries only the length and three bytes of a name, which
+ * is enough to tell most sets of field names apart; if no multiplier
+ * separates them, every byte is hashed.  The table grows until a
+ * multiplier is found or the caller's slots run out.
+ */
+
+#include <string.h>
+#include "json.h"
+
+#define SEED_TRIES 1000
+
+static inline unsigned int key_hash(const json_keys *k,const char *s,int n) {
+        unsigned int h=n;
+        int i;
+        if (k->full) {
+                for(i=0;i<n;i++) h=(h^(unsigned char)s[i])*16777619u;
+        }
+        else if (n>0) {
+                h^=(unsigned int)(unsigned char)s[0]<<8 ^
+                        (unsigned int)(unsigned char)s[n/2]<<16 ^
+                        (unsigned int)(unsigned char)s[n-1]<<24;
+        }
+        /* the top bits of the product depend on all of h */
+        return (h*k->seed)>>(32-k->bits);
+}
+
+/* Returns true if every name has a slot to itself. */
+static bool separates(json_keys *k) {
+        int i,size=1<<k->bits;
+        unsigned int at;
+
+        memset(k->slot,0,size*sizeof(*k->slot));
+        for(i=0;i<k->count;i++) {
+                at=key_hash(k,k->names[i],strlen(k->names[i]));
+                if (k->slot[at]) return false;
+                k->slot[at]=i+1;
+        }
+        return true;
+}
+
+bool json_keys_init(json_keys *k,const char *const *names,int count,int *slots,int nslots) {
+        unsigned int seed=12345;
+        int tries,pass;
+
+        k->names=names;
+        k->count=count;
+        k->slot=slots;
+        for(k->bits=1;(1<<k->bits)<count;k->bits++);
+        for(;k->bits<32 && (1<<k->bits)<=nslots;k->bits++) {
+                for(pass=0;pass<2;pass++) {
+                        k->full=(pass==1);
+                        for(tries=0;tries<SEED_TRIES;tries++) {
+                                seed=seed*1103515245+12345;
+                                k->seed=seed|1;
+                                if (separates(k)) return true;
+                        }
+                }
+        }
+        k->bits=0;
+        return false;
+}
+
+int json_key_id(const json_keys *k,const json_nchar *name) {
+        const char *want;
+        int id,i;
+
+        if (!k->bits) return 0;
+        id=k->slot[key_hash(k,name->s,name->n)];
+        if (!id) return 0;
+        want=k->names[id-1];
+        for(i=0;i<name->n;i++) if (!want[i] || want[i]!=name->s[i]) return 0;
+        return (want[i]=='\0')?id:0;
+}
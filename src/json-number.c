@@ -0,0 +1,601 @@
+/* > json-number.c */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Number scanning and conversion.
+ *
+ * Doubles are correctly rounded, matching strtod(): small mantissas and
+ * exponents take the exact fast path (Clinger), the rest are computed
+ * with a 128-bit multiply by a power of five (Eisel and Lemire).  Only a
+ * mantissa of more than 19 digits that falls too close to a rounding
+ * boundary is passed to strtod().  Targets without IEEE doubles, such as
+ * Arduino, scale by powers of ten instead.
+ *
+ * Doubles are written with Grisu2 (Loitsch, "Printing Floating-Point
+ * Numbers Quickly and Accurately with Integers"): the digits always read
+ * back as the same double, and are the shortest that do for all but a
+ * few in a thousand.  Other targets use snprintf().
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "json-number.h"
+
+#include <stdio.h>
+
+#if !defined(ARDUINO) && FLT_RADIX==2 && DBL_MANT_DIG==53 && DBL_MAX_EXP==1024
+#define NUMBER_EXACT 1
+#include "json-pow5.h"
+#endif
+
+/* -- scanning -- */
+
+#define MANTISSA_DIGITS 19 /* decimal digits that always fit in a uint64_t */
+
+json_in json_scan_number(json_in s,json_in end,json_decimal *d) {
+        json_in p=s,q;
+        uint64_t w=0;
+        unsigned int x;
+        int nd=0,exp10=0,e;
+        bool truncated=false,neg;
+
+        d->negative=false;
+        d->integral=true;
+        d->badexp=false;
+        if (p<end && *p=='-') {p++; d->negative=true;}
+        if (p<end && *p=='0') p++;
+        else {
+                for(q=p;p<end && (x=*p-'0')<10;p++) {
+                        if (nd<MANTISSA_DIGITS) {w=w*10+x; nd++;}
+                        else {exp10++; truncated|=(x!=0);}
+                }
+                if (p==q) return NULL;
+        }
+
+        if (p<end && *p=='.') {
+                d->integral=false;
+                for(p++;p<end && (x=*p-'0')<10;p++) {
+                        if (nd<MANTISSA_DIGITS) {
+                                /* leading zeros are not significant */
+                                w=w*10+x;
+                                exp10--;
+                                if (w) nd++;
+                        }
+                        else truncated|=(x!=0);
+                }
+        }
+
+        if (p<end && (*p=='e' || *p=='E')) {
+                d->integral=false;
+                p++;
+                neg=false;
+                if (p<end && (*p=='-' || *p=='+')) neg=(*p++=='-');
+                for(e=0,q=p;p<end && (x=*p-'0')<10;p++) {
+                        if (e<100000) e=e*10+x; /* far out of range either way */
+                }
+                if (p==q) {d->badexp=true; return p;}
+                exp10+=(neg)?-e:e;
+        }
+
+        d->mantissa=w;
+        d->exp10=exp10;
+        d->truncated=truncated;
+        return p;
+}
+
+bool json_decimal_to_int64(const json_decimal *d,int64_t *v) {
+        /* exp10 is not 0 if integer digits were dropped */
+        if (!d->integral || d->exp10!=0) return false;
+        if (d->negative) {
+                if (d->mantissa > (uint64_t)INT64_MAX+1) return false;
+                *v=(d->mantissa)?-(int64_t)(d->mantissa-1)-1:0;
+        }
+        else {
+                if (d->mantissa > (uint64_t)INT64_MAX) return false;
+                *v=(int64_t)d->mantissa;
+        }
+        return true;
+}
+
+/* -- conversion -- */
+
+#if NUMBER_EXACT
+
+#define EXPLICIT_BITS 52
+#define INFINITE_POWER 0x7FF
+
+static inline void mul128(uint64_t a,uint64_t b,uint64_t *hi,uint64_t *lo) {
+#ifdef __SIZEOF_INT128__
+        __extension__ unsigned __int128 r=(unsigned __int128)a*b;
+        *hi=(uint64_t)(r>>64);
+        *lo=(uint64_t)r;
+#else
+        uint64_t a0=(uint32_t)a,a1=a>>32,b0=(uint32_t)b,b1=b>>32;
+        uint64_t p00=a0*b0,p01=a0*b1,p10=a1*b0,p11=a1*b1;
+        uint64_t mid=(p00>>32)+(uint32_t)p01+(uint32_t)p10;
+        *hi=p11+(p01>>32)+(p10>>32)+(mid>>32);
+        *lo=(mid<<32)|(uint32_t)p00;
+#endif
+}
+
+static inline int leading_zeros(uint64_t w) {
+#ifdef __GNUC__
+        return __builtin_clzll(w);
+#else
+        int n=0;
+        while(!(w & ((uint64_t)1<<63))) {w<<=1; n++;}
+        return n;
+#endif
+}
+
+/* Returns the bits of the double nearest to w*10^q, for w!=0 that has no
+ * more than 19 digits.  This is the algorithm of fast_float, which is
+ * proven to need no fallback for such w.
+ */
+static uint64_t eisel_lemire(uint64_t w,int q) {
+        uint64_t hi,lo,hi2,lo2,mantissa;
+        const uint64_t *p5;
+        int lz,upper,shift,power2;
+
+        if (q<JSON_POW5_MIN) return 0;
+        if (q>JSON_POW5_MAX) return (uint64_t)INFINITE_POWER<<EXPLICIT_BITS;
+
+        lz=leading_zeros(w);
+        w<<=lz;
+        p5=json_pow5[q-JSON_POW5_MIN];
+        mul128(w,p5[0],&hi,&lo);
+        if ((hi & 0x1FF)==0x1FF) {
+                /* the bits below the mantissa are all ones: refine */
+                mul128(w,p5[1],&hi2,&lo2);
+                lo+=hi2;
+                if (hi2>lo) hi++;
+        }
+
+        upper=(int)(hi>>63);
+        shift=upper+64-EXPLICIT_BITS-3;
+        mantissa=hi>>shift;
+        /* floor(q*log2(10)), plus the bias */
+        power2=(((152170+65536)*q)>>16)+63+upper-lz+1023;
+
+        if (power2<=0) {
+                /* subnormal, or zero */
+                if (-power2+1>=64) return 0;
+                mantissa>>=-power2+1;
+                mantissa+=mantissa&1;
+                mantissa>>=1;
+                /* rounding up may make it normal */
+                power2=(mantissa<((uint64_t)1<<EXPLICIT_BITS))?0:1;
+                return mantissa|((uint64_t)power2<<EXPLICIT_BITS);
+        }
+
+        /* exactly half way between two doubles: round to even */
+        if (lo<=1 && q>=-4 && q<=23 && (mantissa&3)==1 && (mantissa<<shift)==hi)
+                mantissa&=~(uint64_t)1;
+
+        mantissa+=mantissa&1;
+        mantissa>>=1;
+        if (mantissa>=((uint64_t)2<<EXPLICIT_BITS)) {
+                mantissa=(uint64_t)1<<EXPLICIT_BITS;
+                power2++;
+        }
+        mantissa&=~((uint64_t)1<<EXPLICIT_BITS);
+        if (power2>=INFINITE_POWER) return (uint64_t)INFINITE_POWER<<EXPLICIT_BITS;
+        return mantissa|((uint64_t)power2<<EXPLICIT_BITS);
+}
+
+#define STRTOD_DIGITS 768 /* enough to decide any rounding */
+
+/* Convert [s,e) with strtod(), copying it so that it need not be
+ * NUL-terminated.  Digits beyond STRTOD_DIGITS only matter if they are
+ * not all zero, so are replaced by a single '1'.
+ */
+static double slow_double(json_in s,json_in e) {
+        char buf[STRTOD_DIGITS+32];
+        int n=0,digits=0,point=0;
+        long exp=0;
+        bool fraction=false,sticky=false;
+
+        if (s<e && *s=='-') buf[n++]=*s++;
+        buf[n++]='0';
+        buf[n++]='.';
+        for(;s<e && *s!='e' && *s!='E';s++) {
+                if (*s=='.') {fraction=true; continue;}
+                if (digits==0 && *s=='0') {
+                        if (fraction) point--;
+                        continue;
+                }
+                if (!fraction) point++;
+                if (digits<STRTOD_DIGITS) buf[n++]=*s;
+                else sticky|=(*s!='0');
+                digits++;
+        }
+        if (sticky) buf[n++]='1';
+        if (s<e) {
+                /* the exponent, which need not be followed by a NUL */
+                bool neg=false;
+                s++;
+                if (s<e && (*s=='-' || *s=='+')) neg=(*s++=='-');
+                for(;s<e;s++) if (exp<100000) exp=exp*10+(*s-'0');
+                if (neg) exp=-exp;
+        }
+        snprintf(buf+n,sizeof(buf)-n,"e%ld",exp+point);
+        return strtod(buf,NULL);
+}
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD==0
+#define NUMBER_CLINGER 1
+static const double exact10[]={
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11,1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22,
+};
+#endif
+
+double json_decimal_to_double(const json_decimal *d,json_in s,json_in e) {
+        uint64_t bits;
+        double v;
+
+#if NUMBER_CLINGER
+        /* both w and 10^|q| are exact doubles, so one rounding is exact */
+        if (!d->truncated && d->mantissa<=((uint64_t)1<<53) && d->exp10>=-22 && d->exp10<=22) {
+                v=(double)d->mantissa;
+                if (d->exp10<0) v/=exact10[-d->exp10];
+                else v*=exact10[d->exp10];
+                return (d->negative)?-v:v;
+        }
+#endif
+        if (d->mantissa==0) return (d->negative)?-0.0:0.0;
+        bits=eisel_lemire(d->mantissa,d->exp10);
+        if (d->truncated && bits!=eisel_lemire(d->mantissa+1,d->exp10)) {
+                /* the dropped digits decide the rounding */
+                return slow_double(s,e);
+        }
+        if (d->negative) bits|=(uint64_t)1<<63;
+        memcpy(&v,&bits,sizeof(v));
+        return v;
+}
+
+#else /* !NUMBER_EXACT */
+
+static double power10(int exp) {
+        double base,bbase;
+        double r=1.0;
+        int bb=0;
+
+        if (exp<0) {base=0.1; exp=-exp;}
+        else base=10.0;
+
+        bbase=base;
+        bb=1;
+        while(exp>0) {
+                if (exp <= bb) {
+                        bb=1;
+                        bbase=base;
+                }
+                else {
+                        bbase*=base;
+                        bb++;
+                        continue;
+                }
+                r*=bbase;
+                exp-=bb;
+        }
+        return r;
+}
+
+double json_decimal_to_double(const json_decimal *d,json_in s,json_in e) {
+        double v=(double)d->mantissa*power10(d->exp10);
+        (void)s; (void)e;
+        return (d->negative)?-v:v;
+}
+
+#endif /* NUMBER_EXACT */
+
+/* -- formatting -- */
+
+static const char digit_pairs[]=
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+int json_format_int64(char *out,int64_t x) {
+        char tmp[20],*t=tmp+sizeof(tmp);
+        uint64_t u=(x<0)?0-(uint64_t)x:(uint64_t)x;
+        int n=0;
+
+        /* two digits at a time, from the right */
+        for(;u>=100;u/=100) {
+                t-=2;
+                memcpy(t,digit_pairs+2*(u%100),2);
+        }
+        if (u>=10) {
+                t-=2;
+                memcpy(t,digit_pairs+2*u,2);
+        }
+        else *--t='0'+u;
+        if (x<0) out[n++]='-';
+        memcpy(out+n,t,tmp+sizeof(tmp)-t);
+        return n+(tmp+sizeof(tmp)-t);
+}
+
+#if NUMBER_EXACT
+
+/* f*2^e */
+typedef struct {
+        uint64_t f;
+        int e;
+} diyfp;
+
+/* 10^k for k=-348,-340,...,340, rounded to 64 bits.  Generated. */
+static const diyfp cached_power[]={
+        {0xfa8fd5a0081c0288ULL,-1220}, /* 1e-348 */
+        {0xbaaee17fa23ebf76ULL,-1193}, /* 1e-340 */
+        {0x8b16fb203055ac76ULL,-1166}, /* 1e-332 */
+        {0xcf42894a5dce35eaULL,-1140}, /* 1e-324 */
+        {0x9a6bb0aa55653b2dULL,-1113}, /* 1e-316 */
+        {0xe61acf033d1a45dfULL,-1087}, /* 1e-308 */
+        {0xab70fe17c79ac6caULL,-1060}, /* 1e-300 */
+        {0xff77b1fcbebcdc4fULL,-1034}, /* 1e-292 */
+        {0xbe5691ef416bd60cULL,-1007}, /* 1e-284 */
+        {0x8dd01fad907ffc3cULL,-980}, /* 1e-276 */
+        {0xd3515c2831559a83ULL,-954}, /* 1e-268 */
+        {0x9d71ac8fada6c9b5ULL,-927}, /* 1e-260 */
+        {0xea9c227723ee8bcbULL,-901}, /* 1e-252 */
+        {0xaecc49914078536dULL,-874}, /* 1e-244 */
+        {0x823c12795db6ce57ULL,-847}, /* 1e-236 */
+        {0xc21094364dfb5637ULL,-821}, /* 1e-228 */
+        {0x9096ea6f3848984fULL,-794}, /* 1e-220 */
+        {0xd77485cb25823ac7ULL,-768}, /* 1e-212 */
+        {0xa086cfcd97bf97f4ULL,-741}, /* 1e-204 */
+        {0xef340a98172aace5ULL,-715}, /* 1e-196 */
+        {0xb23867fb2a35b28eULL,-688}, /* 1e-188 */
+        {0x84c8d4dfd2c63f3bULL,-661}, /* 1e-180 */
+        {0xc5dd44271ad3cdbaULL,-635}, /* 1e-172 */
+        {0x936b9fcebb25c996ULL,-608}, /* 1e-164 */
+        {0xdbac6c247d62a584ULL,-582}, /* 1e-156 */
+        {0xa3ab66580d5fdaf6ULL,-555}, /* 1e-148 */
+        {0xf3e2f893dec3f126ULL,-529}, /* 1e-140 */
+        {0xb5b5ada8aaff80b8ULL,-502}, /* 1e-132 */
+        {0x87625f056c7c4a8bULL,-475}, /* 1e-124 */
+        {0xc9bcff6034c13053ULL,-449}, /* 1e-116 */
+        {0x964e858c91ba2655ULL,-422}, /* 1e-108 */
+        {0xdff9772470297ebdULL,-396}, /* 1e-100 */
+        {0xa6dfbd9fb8e5b88fULL,-369}, /* 1e-92 */
+        {0xf8a95fcf88747d94ULL,-343}, /* 1e-84 */
+        {0xb94470938fa89bcfULL,-316}, /* 1e-76 */
+        {0x8a08f0f8bf0f156bULL,-289}, /* 1e-68 */
+        {0xcdb02555653131b6ULL,-263}, /* 1e-60 */
+        {0x993fe2c6d07b7facULL,-236}, /* 1e-52 */
+        {0xe45c10c42a2b3b06ULL,-210}, /* 1e-44 */
+        {0xaa242499697392d3ULL,-183}, /* 1e-36 */
+        {0xfd87b5f28300ca0eULL,-157}, /* 1e-28 */
+        {0xbce5086492111aebULL,-130}, /* 1e-20 */
+        {0x8cbccc096f5088ccULL,-103}, /* 1e-12 */
+        {0xd1b71758e219652cULL,-77}, /* 1e-4 */
+        {0x9c40000000000000ULL,-50}, /* 1e4 */
+        {0xe8d4a51000000000ULL,-24}, /* 1e12 */
+        {0xad78ebc5ac620000ULL,3}, /* 1e20 */
+        {0x813f3978f8940984ULL,30}, /* 1e28 */
+        {0xc097ce7bc90715b3ULL,56}, /* 1e36 */
+        {0x8f7e32ce7bea5c70ULL,83}, /* 1e44 */
+        {0xd5d238a4abe98068ULL,109}, /* 1e52 */
+        {0x9f4f2726179a2245ULL,136}, /* 1e60 */
+        {0xed63a231d4c4fb27ULL,162}, /* 1e68 */
+        {0xb0de65388cc8ada8ULL,189}, /* 1e76 */
+        {0x83c7088e1aab65dbULL,216}, /* 1e84 */
+        {0xc45d1df942711d9aULL,242}, /* 1e92 */
+        {0x924d692ca61be758ULL,269}, /* 1e100 */
+        {0xda01ee641a708deaULL,295}, /* 1e108 */
+        {0xa26da3999aef774aULL,322}, /* 1e116 */
+        {0xf209787bb47d6b85ULL,348}, /* 1e124 */
+        {0xb454e4a179dd1877ULL,375}, /* 1e132 */
+        {0x865b86925b9bc5c2ULL,402}, /* 1e140 */
+        {0xc83553c5c8965d3dULL,428}, /* 1e148 */
+        {0x952ab45cfa97a0b3ULL,455}, /* 1e156 */
+        {0xde469fbd99a05fe3ULL,481}, /* 1e164 */
+        {0xa59bc234db398c25ULL,508}, /* 1e172 */
+        {0xf6c69a72a3989f5cULL,534}, /* 1e180 */
+        {0xb7dcbf5354e9beceULL,561}, /* 1e188 */
+        {0x88fcf317f22241e2ULL,588}, /* 1e196 */
+        {0xcc20ce9bd35c78a5ULL,614}, /* 1e204 */
+        {0x98165af37b2153dfULL,641}, /* 1e212 */
+        {0xe2a0b5dc971f303aULL,667}, /* 1e220 */
+        {0xa8d9d1535ce3b396ULL,694}, /* 1e228 */
+        {0xfb9b7cd9a4a7443cULL,720}, /* 1e236 */
+        {0xbb764c4ca7a44410ULL,747}, /* 1e244 */
+        {0x8bab8eefb6409c1aULL,774}, /* 1e252 */
+        {0xd01fef10a657842cULL,800}, /* 1e260 */
+        {0x9b10a4e5e9913129ULL,827}, /* 1e268 */
+        {0xe7109bfba19c0c9dULL,853}, /* 1e276 */
+        {0xac2820d9623bf429ULL,880}, /* 1e284 */
+        {0x80444b5e7aa7cf85ULL,907}, /* 1e292 */
+        {0xbf21e44003acdd2dULL,933}, /* 1e300 */
+        {0x8e679c2f5e44ff8fULL,960}, /* 1e308 */
+        {0xd433179d9c8cb841ULL,986}, /* 1e316 */
+        {0x9e19db92b4e31ba9ULL,1013}, /* 1e324 */
+        {0xeb96bf6ebadf77d9ULL,1039}, /* 1e332 */
+        {0xaf87023b9bf0ee6bULL,1066}, /* 1e340 */
+};
+
+static const uint32_t pow10_32[]={
+        1,10,100,1000,10000,100000,1000000,10000000,100000000,1000000000,
+};
+
+static diyfp diy_mul(diyfp a,diyfp b) {
+        uint64_t hi,lo;
+        diyfp r;
+        mul128(a.f,b.f,&hi,&lo);
+        r.f=hi+(lo>>63); /* rounded */
+        r.e=a.e+b.e+64;
+        return r;
+}
+
+static diyfp diy_normalize(diyfp a) {
+        int s=leading_zeros(a.f);
+        a.f<<=s;
+        a.e-=s;
+        return a;
+}
+
+/* Step the last digit down while that brings it closer to w, staying in
+ * the interval.
+ */
+static void grisu_round(char *buf,int len,uint64_t delta,uint64_t rest,uint64_t ten_kappa,uint64_t wp_w) {
+        while(rest<wp_w && delta-rest>=ten_kappa &&
+              (rest+ten_kappa<wp_w || wp_w-rest>rest+ten_kappa-wp_w)) {
+                buf[len-1]--;
+                rest+=ten_kappa;
+        }
+}
+
+/* The digits of mp, stopping as soon as they are within delta of it. */
+static int digit_gen(diyfp w,diyfp mp,uint64_t delta,char *buf,int *k) {
+        int shift=-mp.e,kappa,len=0;
+        uint64_t one=(uint64_t)1<<shift,wp_w=mp.f-w.f,p2=mp.f & (one-1),rest;
+        uint32_t p1=(uint32_t)(mp.f>>shift),d;
+
+        for(kappa=1;kappa<10 && p1>=pow10_32[kappa];kappa++);
+        while(kappa>0) {
+                d=p1/pow10_32[kappa-1];
+                p1%=pow10_32[kappa-1];
+                if (d || len) buf[len++]='0'+d;
+                kappa--;
+                rest=((uint64_t)p1<<shift)+p2;
+                if (rest<=delta) {
+                        *k+=kappa;
+                        grisu_round(buf,len,delta,rest,(uint64_t)pow10_32[kappa]<<shift,wp_w);
+                        return len;
+                }
+        }
+        for(;;) {
+                p2*=10;
+                delta*=10;
+                d=(uint32_t)(p2>>shift);
+                if (d || len) buf[len++]='0'+d;
+                p2&=one-1;
+                kappa--;
+                if (p2<delta) {
+                        *k+=kappa;
+                        grisu_round(buf,len,delta,p2,one,wp_w*((-kappa<9)?pow10_32[-kappa]:0));
+                        return len;
+                }
+        }
+}
+
+/* Digits for x (finite and above zero) into buf, returning how many; x is
+ * about digits*10^*k.
+ */
+static int grisu2(double x,char *buf,int *k) {
+        uint64_t bits;
+        diyfp v,w,mp,mm,c;
+        int be,i;
+        double dk;
+
+        memcpy(&bits,&x,sizeof(bits));
+        be=(int)(bits>>EXPLICIT_BITS) & INFINITE_POWER;
+        v.f=bits & (((uint64_t)1<<EXPLICIT_BITS)-1);
+        if (be) {
+                v.f|=(uint64_t)1<<EXPLICIT_BITS;
+                v.e=be-1075;
+        }
+        else v.e=-1074;
+
+        /* the halfway points to the neighbouring doubles */
+        mp.f=(v.f<<1)+1;
+        mp.e=v.e-1;
+        mp=diy_normalize(mp);
+        if (v.f==(uint64_t)1<<EXPLICIT_BITS) {
+                /* the gap below a power of two is half the size */
+                mm.f=(v.f<<2)-1;
+                mm.e=v.e-2;
+        }
+        else {
+                mm.f=(v.f<<1)-1;
+                mm.e=v.e-1;
+        }
+        mm.f<<=mm.e-mp.e;
+        mm.e=mp.e;
+        w=diy_normalize(v);
+
+        /* a power of ten that brings mp's exponent into [-60,-32] */
+        dk=(-61-mp.e)*0.30102999566398114+347;
+        i=(int)dk;
+        if (dk-i>0.0) i++;
+        i=(i>>3)+1;
+        *k=-(-348+i*8);
+        c=cached_power[i];
+
+        w=diy_mul(w,c);
+        mp=diy_mul(mp,c);
+        mm=diy_mul(mm,c);
+        /* allow for the rounding of the products */
+        mm.f++;
+        mp.f--;
+        return digit_gen(w,mp,mp.f-mm.f,buf,k);
+}
+
+int json_format_double(char *out,double x) {
+        char digits[20];
+        int n,k,kk,i,len=0;
+
+        if (x!=x || x-x!=0) return 0;
+        if (signbit(x)) {
+                out[len++]='-';
+                x=-x;
+        }
+        if (x==0) {
+                out[len++]='0';
+                return len;
+        }
+        if (x<1e15 && x==(double)(int64_t)x) return len+json_format_int64(out+len,(int64_t)x);
+
+        n=grisu2(x,digits,&k);
+        kk=n+k; /* 10^(kk-1) <= x < 10^kk */
+        if (k>=0 && kk<=21) {
+                /* 1234e7 is 12340000000 */
+                memcpy(out+len,digits,n);
+                memset(out+len+n,'0',k);
+                return len+kk;
+        }
+        if (kk>0 && kk<=21) {
+                /* 1234e-2 is 12.34 */
+                memcpy(out+len,digits,kk);
+                out[len+kk]='.';
+                memcpy(out+len+kk+1,digits+kk,n-kk);
+                return len+n+1;
+        }
+        if (kk>-6 && kk<=0) {
+                /* 1234e-6 is 0.001234 */
+                out[len++]='0';
+                out[len++]='.';
+                memset(out+len,'0',-kk);
+                memcpy(out+len-kk,digits,n);
+                return len-kk+n;
+        }
+        /* 1234e30 is 1.234e33 */
+        out[len++]=digits[0];
+        if (n>1) {
+                out[len++]='.';
+                memcpy(out+len,digits+1,n-1);
+                len+=n-1;
+        }
+        out[len++]='e';
+        kk--;
+        if (kk<0) {
+                out[len++]='-';
+                kk=-kk;
+        }
+        for(i=100;i>1 && kk<i;i/=10);
+        for(;i>0;i/=10) out[len++]='0'+kk/i%10;
+        return len;
+}
+
+#else /* !NUMBER_EXACT */
+
+int json_format_double(char *out,double x) {
+        if (x!=x || x-x!=0) return 0;
+        return snprintf(out,JSON_NUMBER_TEXT_MAX,"%.*g",(DBL_MANT_DIG>24)?17:9,x);
+}
+
+#endif /* NUMBER_EXACT */
@@ -0,0 +1,45 @@
+/* > json-number.h */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Number scanning and conversion.  Not part of the public API. */
+
+#ifndef STACK_JSON_NUMBER_H
+#define STACK_JSON_NUMBER_H
+
+#include <stdint.h>
+#include "json.h"
+
+/* A number as scanned: mantissa*10^exp10, negated if negative. */
+typedef struct {
+        uint64_t mantissa; /* the first 19 significant digits */
+        int exp10;
+        bool negative;
+        bool truncated;    /* non-zero digits were dropped from the mantissa */
+        bool integral;     /* no fraction or exponent in the text */
+        bool badexp;       /* an exponent with no digits */
+} json_decimal;
+
+/* Scan the number at s.  Returns the end of the number, or NULL if there
+ * is no number at s.  A bad exponent sets d->badexp and returns where the
+ * digits should be.
+ */
+extern json_in json_scan_number(json_in s,json_in end,json_decimal *d);
+
+/* Returns the double nearest to the number [s,e) scanned into d. */
+extern double json_decimal_to_double(const json_decimal *d,json_in s,json_in e);
+
+/* Returns true, setting *v, if d is an integer within the int64_t range. */
+extern bool json_decimal_to_int64(const json_decimal *d,int64_t *v);
+
+/* Longest text json_format_double() or json_format_int64() writes. */
+#define JSON_NUMBER_TEXT_MAX 32
+
+/* Write x as JSON, with no NUL, returning the length.  Doubles get the
+ * shortest digits that read back the same (see json-number.c); NaN and
+ * infinities, which JSON has no text for, give 0.
+ */
+extern int json_format_double(char *out,double x);
+extern int json_format_int64(char *out,int64_t x);
+
+#endif
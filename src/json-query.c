@@ -0,0 +1,383 @@
+/* > json-query.c */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Compiled path queries.
+ *
+ * The paths form a tree of steps held in the caller's node array, which
+ * doubles as an open-addressing hash table keyed on (parent node, name or
+ * index).  While parsing, each nesting level has the set of nodes that
+ * match the path to it; stepping into a name or index costs one hash
+ * probe per node in the set, however many queries there are.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "json.h"
+#include "json-query.h"
+
+typedef json_valuecontext ctx;
+
+enum {
+        Q_ROOT,   /* the empty path */
+        Q_NAME,   /* an object name */
+        Q_TILDE,  /* an object name with JSON Pointer escapes (~0, ~1) */
+        Q_INDEX,  /* an array index */
+        Q_STAR,   /* "*": any name or index */
+        Q_ANY,    /* "#": any index */
+        Q_REST,   /* "**": everything below */
+        Q_MORE,   /* another query ending at the parent node */
+};
+
+/* -- names and hashing -- */
+
+/* Returns the next character of a name, or -1 at the end. */
+static int name_char(const json_nchar *s,bool tilde,int *i) {
+        char x;
+        if (*i>=s->n) return -1;
+        x=s->s[(*i)++];
+        if (tilde && x=='~' && *i<s->n) x=(s->s[(*i)++]=='1')?'/':'~';
+        return (unsigned char)x;
+}
+
+static unsigned int name_hash(const json_nchar *s,bool tilde) {
+        unsigned int h=2166136261u; /* FNV-1a */
+        int i=0,x;
+        while((x=name_char(s,tilde,&i))>=0) h=(h^x)*16777619u;
+        return h;
+}
+
+static unsigned int index_hash(int index) {
+        return (unsigned int)index*2654435761u;
+}
+
+static unsigned int slot(const json_queries *q,int parent,unsigned int h) {
+        return (h ^ ((unsigned int)parent*0x9E3779B1u)) % (unsigned int)q->size;
+}
+
+static bool same_name(const json_querynode *n,const json_nchar *s,bool tilde) {
+        int i=0,j=0,x,y;
+        if (n->kind==Q_NAME && !tilde) {
+                return n->name.n==s->n && memcmp(n->name.s,s->s,s->n)==0;
+        }
+        do {
+                x=name_char(&n->name,n->kind==Q_TILDE,&i);
+                y=name_char(s,tilde,&j);
+                if (x!=y) return false;
+        } while(x>=0);
+        return true;
+}
+
+/* Find the step from parent by name (s!=NULL) or index. */
+static int find(const json_queries *q,int parent,unsigned int h,const json_nchar *s,bool tilde,int index) {
+        unsigned int i=slot(q,parent,h);
+        const json_querynode *n;
+        int k;
+
+        /* a table too small for any step has no free slot to stop at */
+        for(k=0;k<q->size;k++,i=(i+1)%q->size) {
+                n=&q->node[i];
+                if (n->parent==-1) return -1;
+                if (n->parent!=parent) continue;
+                if (s) {
+                        if ((n->kind==Q_NAME || n->kind==Q_TILDE) && same_name(n,s,tilde)) return i;
+                }
+                else {
+                        if (n->kind==Q_INDEX && n->index==index) return i;
+                }
+        }
+        return -1;
+}
+
+/* -- compiling -- */
+
+/* Returns the number of steps on the path to node at. */
+static int depth(const json_queries *q,int at) {
+        int d=0;
+        for(;q->node[at].parent>=0;at=q->node[at].parent) d++;
+        return d;
+}
+
+static int add_node(json_queries *q,int parent,int kind,unsigned int h) {
+        unsigned int i;
+        json_querynode *n;
+
+        if (q->used+1 > q->size/4*3) return -1;
+        /* a path of n steps needs n+2 levels of match state */
+        if (kind!=Q_MORE && depth(q,parent)+1 > JSON_QUERY_LEVELS-2) return -1;
+        for(i=slot(q,parent,h);q->node[i].parent!=-1;i=(i+1)%q->size);
+        n=&q->node[i];
+        memset(n,0,sizeof(*n));
+        n->parent=parent;
+        n->kind=kind;
+        n->star=n->anyindex=n->rest=n->more=n->once=-1;
+        q->used++;
+        return i;
+}
+
+static int step_name(json_queries *q,int from,const json_nchar *s,bool tilde) {
+        unsigned int h=name_hash(s,tilde);
+        int i=find(q,from,h,s,tilde,0);
+        if (i>=0) return i;
+        i=add_node(q,from,(tilde)?Q_TILDE:Q_NAME,h);
+        if (i>=0) q->node[i].name=*s;
+        return i;
+}
+
+static int step_index(json_queries *q,int from,int index) {
+        unsigned int h=index_hash(index);
+        int i=find(q,from,h,NULL,false,index);
+        if (i>=0) return i;
+        i=add_node(q,from,Q_INDEX,h);
+        if (i>=0) q->node[i].index=index;
+        return i;
+}
+
+static int step_wild(json_queries *q,int from,int kind) {
+        int *w;
+        switch(kind) {
+        case Q_STAR: w=&q->node[from].star; break;
+        case Q_ANY:  w=&q->node[from].anyindex; break;
+        default:     w=&q->node[from].rest; break;
+        }
+        if (*w<0) *w=add_node(q,from,kind,kind);
+        return *w;
+}
+
+bool json_query_attach(json_queries *q,int at,
+        void (*fn)(const json_valuecontext *,const json_value *,void *),void *context,bool once) {
+        json_querynode *n;
+        int i=at;
+
+        if (!once) q->wild++;
+        else if (q->node[at].once<0) {
+                if (q->once<JSON_QUERY_ONCE) q->node[at].once=q->once++;
+                else q->wild++; /* no bit for it, so never done */
+        }
+
+        if (q->node[at].got_value) {
+                /* another query on the same path */
+                i=add_node(q,at,Q_MORE,Q_MORE);
+                if (i<0) return false;
+                q->node[i].more=q->node[at].more;
+                q->node[at].more=i;
+        }
+        n=&q->node[i];
+        n->got_value=fn;
+        n->context=context;
+        return true;
+}
+
+void json_query_init(json_queries *q,json_querynode *nodes,int nnodes) {
+        int i;
+        memset(q,0,sizeof(*q));
+        q->node=nodes;
+        q->size=nnodes;
+        for(i=0;i<nnodes;i++) nodes[i].parent=-1;
+        if (nnodes<1) return;
+        /* node 0 is the empty path */
+        memset(&nodes[0],0,sizeof(nodes[0]));
+        nodes[0].parent=-2;
+        nodes[0].kind=Q_ROOT;
+        nodes[0].star=nodes[0].anyindex=nodes[0].rest=nodes[0].more=nodes[0].once=-1;
+        q->used=1;
+}
+
+int json_query_step(json_queries *q,int at,const char *name,bool *once) {
+        json_nchar s;
+        int kind=-1;
+
+        if (at<0 || q->size<1) return -1;
+        if (strcmp(name,"*")==0) kind=Q_STAR;
+        else if (strcmp(name,"**")==0) kind=Q_REST;
+        else if (strcmp(name,"#")==0) kind=Q_ANY;
+        if (kind>=0) {
+                *once=false;
+                return step_wild(q,at,kind);
+        }
+        if (name[0]=='#') {
+                char *end;
+                long index=strtol(name+1,&end,0);
+                if (end==name+1 || *end!='\0') return -1; /* bad index */
+                return step_index(q,at,index);
+        }
+        s.s=name;
+        s.n=strlen(name);
+        return step_name(q,at,&s,false);
+}
+
+bool json_query_compile(json_queries *q,
+        void (*fn)(const json_valuecontext *,const json_value *,void *),void *context,...) {
+        const char *name;
+        bool once=true;
+        int at=0;
+        va_list ap;
+
+        if (q->size<1) return false;
+        va_start(ap,context);
+        while(at>=0 && (name=va_arg(ap,const char *))!=NULL) {
+                at=json_query_step(q,at,name,&once);
+                if (strcmp(name,"**")==0) break;
+        }
+        va_end(ap);
+        if (at<0) return false;
+        return json_query_attach(q,at,fn,context,once);
+}
+
+/* Add the rest of a JSON Pointer, from the '/' at p. */
+static bool compile_pointer(json_queries *q,int at,const char *p,
+        void (*fn)(const json_valuecontext *,const json_value *,void *),void *context,bool once) {
+        json_nchar s;
+        const char *e,*d;
+        bool tilde=false,digits;
+
+        if (*p=='\0') return json_query_attach(q,at,fn,context,once);
+        if (*p!='/') return false;
+        s.s=p+1;
+        for(e=s.s;*e && *e!='/';e++) {
+                if (*e!='~') continue;
+                if (e[1]!='0' && e[1]!='1') return false; /* bad escape */
+                tilde=true;
+        }
+        s.n=e-s.s;
+
+        /* a numeric step may be an array index too */
+        digits=(s.n>0 && s.n<10 && (s.s[0]!='0' || s.n==1));
+        for(d=s.s;digits && d<e;d++) digits=(*d>='0' && *d<='9');
+        if (digits) {
+                int next=step_index(q,at,atoi(s.s));
+                if (next<0 || !compile_pointer(q,next,e,fn,context,false)) return false;
+                once=false; /* either could match */
+        }
+        at=step_name(q,at,&s,tilde);
+        if (at<0) return false;
+        return compile_pointer(q,at,e,fn,context,once);
+}
+
+bool json_query_compile_pointer(json_queries *q,
+        void (*fn)(const json_valuecontext *,const json_value *,void *),void *context,const char *pointer) {
+        if (q->size<1 || !pointer) return false;
+        return compile_pointer(q,0,pointer,fn,context,true);
+}
+
+/* -- matching -- */
+
+/* Step every node in from[0..n) into the name or index of c.
+ * Returns the number of nodes written to "to", or -1 if more than max.
+ */
+static int step(const json_queries *q,const int *from,int n,const ctx *c,int *to,int max) {
+        unsigned int h=(c->name.s)?name_hash(&c->name,false):index_hash(c->index);
+        int count=0,i,k,x[5];
+
+        for(i=0;i<n;i++) {
+                const json_querynode *node=&q->node[from[i]];
+                x[0]=(node->kind==Q_REST)?from[i]:-1; /* "**" keeps matching */
+                x[1]=find(q,from[i],h,(c->name.s)?&c->name:NULL,false,c->index);
+                x[2]=(c->name.s)?-1:node->anyindex;
+                x[3]=node->star;
+                x[4]=node->rest;
+                for(k=0;k<5;k++) {
+                        if (x[k]<0) continue;
+                        if (count>=max) return -1;
+                        to[count++]=x[k];
+                }
+        }
+        return count;
+}
+
+bool json_query_enter(json_queries *q,const ctx *c) {
+        int start,n,top;
+
+        if (!c->prev) {
+                /* the root: start again */
+                memset(q->fired,0,sizeof(q->fired));
+                q->found=0;
+                q->active[0]=0;
+                q->level[0].start=0;
+                q->level[0].count=1;
+                q->level[0].repeat=1;
+                q->levels=1;
+                return true;
+        }
+        if (q->levels<1) return false;
+        top=q->levels-1;
+        start=q->level[top].start+q->level[top].count;
+        n=0;
+        if (q->level[top].count) {
+                n=step(q,q->active+q->level[top].start,q->level[top].count,c,
+                        q->active+start,JSON_QUERY_ACTIVE-start);
+                if (n<0) return false;
+        }
+        /* often nothing matches, or only "**": share the level */
+        if (n==q->level[top].count &&
+            memcmp(q->active+start,q->active+q->level[top].start,n*sizeof(int))==0) {
+                q->level[top].repeat++;
+                return true;
+        }
+        if (q->levels>=JSON_QUERY_LEVELS) return false;
+        q->level[q->levels].start=start;
+        q->level[q->levels].count=n;
+        q->level[q->levels].repeat=1;
+        q->levels++;
+        return true;
+}
+
+bool json_query_on_end(json_queries *q,int at,
+        void (*fn)(const json_valuecontext *,void *),void *context) {
+        if (at<0 || at>=q->size || q->node[at].end) return false;
+        q->node[at].end=fn;
+        q->node[at].end_context=context;
+        return true;
+}
+
+void json_query_leave(json_queries *q,const ctx *root) {
+        const json_querynode *n;
+        int i,top;
+
+        if (q->levels<1) return;
+        top=q->levels-1;
+        if (--q->level[top].repeat>0) return;
+        q->levels--;
+        /* the level held the nodes matching the container just closed */
+        for(i=0;i<q->level[top].count;i++) {
+                n=&q->node[q->active[q->level[top].start+i]];
+                if (n->end) n->end(root,n->end_context);
+        }
+}
+
+static void call(json_queries *q,int at,const ctx *root,const json_value *v,const bool *stopped) {
+        const json_querynode *first=&q->node[at];
+        int bit=first->once;
+        /* the nodes are shared by json_parse_lines() threads: mark q */
+        if (bit>=0 && !(q->fired[bit/32] & (1u<<bit%32))) {
+                q->fired[bit/32]|=1u<<bit%32;
+                q->found++;
+        }
+        for(;at>=0 && !*stopped;at=q->node[at].more) {
+                const json_querynode *n=&q->node[at];
+                if (n->got_value) n->got_value(root,v,n->context);
+        }
+        if (first->end && !*stopped) first->end(root,first->end_context);
+}
+
+bool json_query_value(json_queries *q,const ctx *root,const ctx *c,const bool *stopped) {
+        int start,n,i,top;
+
+        if (!c->prev) {
+                /* a lone value at the root */
+                memset(q->fired,0,sizeof(q->fired));
+                q->found=0;
+                if (q->size>0) call(q,0,root,&c->value,stopped);
+                return true;
+        }
+        if (q->levels<1) return false;
+        top=q->levels-1;
+        if (!q->level[top].count) return true; /* the usual case */
+        start=q->level[top].start+q->level[top].count;
+        n=step(q,q->active+q->level[top].start,q->level[top].count,c,
+                q->active+start,JSON_QUERY_ACTIVE-start);
+        if (n<0) return false;
+        for(i=0;i<n && !*stopped;i++) call(q,q->active[start+i],root,&c->value,stopped);
+        return true;
+}
@@ -0,0 +1,57 @@
+/* > json-query.h */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Hooks from the parsers into the compiled path queries.  Not part of the
+ * public API.
+ */
+
+#ifndef STACK_JSON_QUERY_H
+#define STACK_JSON_QUERY_H
+
+#include "json.h"
+
+/* Add one step of a path, given as for json_matches_path(), from node at
+ * (0 for the empty path).  Clears *once if the step is a wildcard.
+ * Returns the node reached, or -1 if the step is invalid or the node
+ * array is full.
+ */
+extern int json_query_step(json_queries *q,int at,const char *name,bool *once);
+
+/* Call fn with context for each value reaching node at.  once says the
+ * path can match only once.
+ */
+extern bool json_query_attach(json_queries *q,int at,
+        void (*fn)(const json_valuecontext *root,const json_value *value,void *context),void *context,
+        bool once);
+
+/* Call fn with context once each value at node at has been passed:
+ * objects and arrays once closed.  Not for "**" nodes.  Returns false if
+ * at already has one.
+ */
+extern bool json_query_on_end(json_queries *q,int at,
+        void (*fn)(const json_valuecontext *root,void *context),void *context);
+
+/* Returns true if every query matches once, and all have in this parse. */
+static inline bool json_query_done(const json_queries *q) {
+        return q->once>0 && q->wild==0 && q->found>=q->once;
+}
+
+/* The value in c is an object or array about to be entered.
+ * Returns false if the match state does not fit.
+ */
+extern bool json_query_enter(json_queries *q,const json_valuecontext *c);
+
+/* The object or array last entered, now at the end of the chain from root,
+ * has been left.
+ */
+extern void json_query_leave(json_queries *q,const json_valuecontext *root);
+
+/* Call the queries matching the value in c, until *stopped is set (by
+ * json_stop() in one of them).  Returns false if the match state does not
+ * fit.
+ */
+extern bool json_query_value(json_queries *q,const json_valuecontext *root,const json_valuecontext *c,
+        const bool *stopped);
+
+#endif
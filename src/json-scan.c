@@ -0,0 +1,783 @@
+/* > json-scan.c */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Byte-scanning kernels: SIMD where available, plain C otherwise. */
+
+#include <stdint.h>
+#include <string.h>
+#include "json-scan.h"
+
+#if !defined(ARDUINO) && defined(__GNUC__) && defined(__SSE2__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#elif !defined(ARDUINO) && defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_NEON)
+#define SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* -- plain C -- */
+
+static inline bool string_special(unsigned char x) {
+        return x<0x20 || x=='\"' || x=='\\';
+}
+
+static json_in scan_string_c(json_in p,json_in end) {
+        while(p<end && !string_special(*p)) p++;
+        return p;
+}
+
+static json_in scan_string_high_c(json_in p,json_in end,json_in *high) {
+        for(;p<end && !string_special(*p);p++) {
+                if ((unsigned char)*p>=0x80 && !*high) *high=p;
+        }
+        return p;
+}
+
+static json_in scan_whitespace_c(json_in p,json_in end) {
+        while(p<end && json_isspace(*p)) p++;
+        return p;
+}
+
+/* Length of the valid UTF-8 character at p, or 0 if it is not one. */
+static inline int utf8_length(json_in p,json_in end) {
+        const unsigned char *u=(const unsigned char *)p;
+        unsigned char lo=0x80,hi=0xBF;
+        int n,i;
+        if (u[0]<0x80) return 1;
+        if (u[0]<0xC2) return 0;
+        if (u[0]<0xE0) n=2;
+        else if (u[0]<0xF0) {
+                n=3;
+                if (u[0]==0xE0) lo=0xA0; /* overlong */
+                if (u[0]==0xED) hi=0x9F; /* surrogates */
+        }
+        else if (u[0]<0xF5) {
+                n=4;
+                if (u[0]==0xF0) lo=0x90; /* overlong */
+                if (u[0]==0xF4) hi=0x8F; /* above U+10FFFF */
+        }
+        else return 0;
+        if (end-p<n || u[1]<lo || u[1]>hi) return 0;
+        for(i=2;i<n;i++) if ((u[i] & 0xC0)!=0x80) return 0;
+        return n;
+}
+
+/* p must be at the start of a character. */
+static json_in scan_utf8_c(json_in p,json_in end) {
+        uint64_t w;
+        int n;
+        while(p<end) {
+                if (end-p>=8) {
+                        memcpy(&w,p,8);
+                        if (!(w & 0x8080808080808080ULL)) {p+=8; continue;}
+                }
+                n=utf8_length(p,end);
+                if (!n) return p;
+                p+=n;
+        }
+        return p;
+}
+
+/* The last lead byte in the three before q, whose character may run
+ * past q; otherwise q.  Never goes back beyond s.
+ */
+static inline json_in utf8_restart(json_in s,json_in q) {
+        json_in r=q;
+        unsigned char x;
+        while(r>s && q-r<3) {
+                x=*--r;
+                if (x<0x80) break;
+                if (x>=0xC0) return r;
+        }
+        return q;
+}
+
+/* State while skipping a container. */
+typedef struct {
+        int depth;
+        bool string,escape;
+} skipstate;
+
+/* Follow the character x.  Returns true if it closes the container. */
+static inline bool skip_char(skipstate *k,char x) {
+        if (k->escape) {k->escape=false; return false;}
+        if (k->string) {
+                if (x=='\\') k->escape=true;
+                else if (x=='\"') k->string=false;
+                return false;
+        }
+        switch(x) {
+        case '\"': k->string=true; break;
+        case '{':
+        case '[': k->depth++; break;
+        case '}':
+        case ']': return --k->depth==0;
+        default: break;
+        }
+        return false;
+}
+
+static json_in scan_skip_c(json_in p,json_in end,skipstate *k) {
+        for(;p<end;p++) if (skip_char(k,*p)) return p+1;
+        return NULL;
+}
+
+/* State while indexing structural characters. */
+typedef struct {
+        json_in base;
+        uint32_t *index;
+        size_t n,max;
+        bool string,escape;
+} indexstate;
+
+static inline void index_char(indexstate *k,json_in p) {
+        if (k->escape) {k->escape=false; return;}
+        if (k->string) {
+                if (*p=='\\') {k->escape=true; return;}
+                if (*p!='\"') return;
+                k->string=false;
+        }
+        else switch(*p) {
+        case '\"':
+                k->string=true;
+                break;
+        case '{': case '}':
+        case '[': case ']':
+        case ':': case ',':
+                break;
+        default:
+                return;
+        }
+        if (k->n<k->max) k->index[k->n]=p-k->base;
+        k->n++;
+}
+
+static void scan_structurals_c(json_in p,json_in end,indexstate *k) {
+        for(;p<end;p++) index_char(k,p);
+}
+
+/* State while splitting: each bracket and comma counts for the guess
+ * that puts it outside a string, which is the one matching the parity of
+ * the quotes so far.
+ */
+typedef struct {
+        json_scanlevel *level;
+        bool odd,escape;
+} splitstate;
+
+static inline void split_char(splitstate *k,json_in p) {
+        json_scanlevel *l=&k->level[k->odd];
+        if (k->escape) {k->escape=false; return;}
+        switch(*p) {
+        case '\\':
+                k->escape=true;
+                break;
+        case '\"':
+                k->odd=!k->odd;
+                break;
+        case '{': case '[':
+                l->depth++;
+                break;
+        case '}': case ']':
+                if (--l->depth<l->min) {
+                        l->min=l->depth;
+                        l->commas=0;
+                }
+                break;
+        case ',':
+                if (l->depth==l->min && l->commas++==0) l->first=p;
+                break;
+        }
+}
+
+static void scan_split_c(json_in p,json_in end,splitstate *k) {
+        for(;p<end;p++) split_char(k,p);
+}
+
+#if SCAN_X86 || SCAN_NEON
+
+/* As skip_block(), splitting at the characters flagged in m. */
+static inline void split_block(json_in p,uint64_t m,int width,int shift,splitstate *k) {
+        const uint64_t unit=(shift)?0xF:0x1;
+        int i;
+
+        if (k->escape) {m&=~unit; k->escape=false;}
+        while(m) {
+                i=__builtin_ctzll(m)>>shift;
+                m&=~(unit<<(i<<shift));
+                split_char(k,p+i);
+                if (k->escape && i+1<width) {
+                        m&=~(unit<<((i+1)<<shift));
+                        k->escape=false;
+                }
+        }
+}
+
+/* As skip_block(), indexing the characters flagged in m. */
+static inline void index_block(json_in p,uint64_t m,int width,int shift,indexstate *k) {
+        const uint64_t unit=(shift)?0xF:0x1;
+        int i;
+
+        if (k->escape) {m&=~unit; k->escape=false;}
+        while(m) {
+                i=__builtin_ctzll(m)>>shift;
+                m&=~(unit<<(i<<shift));
+                index_char(k,p+i);
+                if (k->escape && i+1<width) {
+                        m&=~(unit<<((i+1)<<shift));
+                        k->escape=false;
+                }
+        }
+}
+
+/* Follow the characters flagged in m, a mask of the width bytes at p with
+ * 1<<shift bits per byte.  Other bytes cannot change the state, except
+ * one that is escaped.  Returns just past the closing bracket, or NULL.
+ */
+static inline json_in skip_block(json_in p,uint64_t m,int width,int shift,skipstate *k) {
+        const uint64_t unit=(shift)?0xF:0x1;
+        int i;
+
+        if (k->escape) {m&=~unit; k->escape=false;}
+        while(m) {
+                i=__builtin_ctzll(m)>>shift;
+                m&=~(unit<<(i<<shift));
+                if (skip_char(k,p[i])) return p+i+1;
+                if (k->escape && i+1<width) {
+                        /* the escaped character is in this block */
+                        m&=~(unit<<((i+1)<<shift));
+                        k->escape=false;
+                }
+        }
+        return NULL;
+}
+
+#endif
+
+#if SCAN_X86
+
+/* -- SSE2 and AVX2 -- */
+
+static inline unsigned int string_mask_sse2(__m128i x) {
+        __m128i q=_mm_cmpeq_epi8(x,_mm_set1_epi8('\"'));
+        __m128i b=_mm_cmpeq_epi8(x,_mm_set1_epi8('\\'));
+        __m128i c=_mm_cmpeq_epi8(_mm_min_epu8(x,_mm_set1_epi8(0x1F)),x);
+        return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(q,b),c));
+}
+
+static json_in scan_string_sse2(json_in p,json_in end) {
+        unsigned int m;
+        for(;end-p>=16;p+=16) {
+                m=string_mask_sse2(_mm_loadu_si128((const __m128i *)p));
+                if (m) return p+__builtin_ctz(m);
+        }
+        return scan_string_c(p,end);
+}
+
+/* Blocks of ASCII are passed over; others are checked character by
+ * character.  p is always at the start of a character.
+ */
+static json_in scan_utf8_sse2(json_in p,json_in end) {
+        json_in q;
+        int n;
+        while(end-p>=16) {
+                if (!_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p))) {p+=16; continue;}
+                for(q=p+16;p<q;p+=n) {
+                        n=utf8_length(p,end);
+                        if (!n) return p;
+                }
+        }
+        return scan_utf8_c(p,end);
+}
+
+/* The high bits of the bytes before the first special one. */
+static inline unsigned int before(unsigned int high,unsigned int special) {
+        return (special)?high & ((special & -special)-1):high;
+}
+
+static json_in scan_string_high_sse2(json_in p,json_in end,json_in *high) {
+        unsigned int m,h;
+        __m128i x;
+        for(;end-p>=16;p+=16) {
+                x=_mm_loadu_si128((const __m128i *)p);
+                m=string_mask_sse2(x);
+                h=before(_mm_movemask_epi8(x),m);
+                if (h && !*high) *high=p+__builtin_ctz(h);
+                if (m) return p+__builtin_ctz(m);
+        }
+        return scan_string_high_c(p,end,high);
+}
+
+static inline unsigned int space_mask_sse2(__m128i x) {
+        __m128i s=_mm_cmpeq_epi8(x,_mm_set1_epi8(' '));
+        __m128i n=_mm_cmpeq_epi8(x,_mm_set1_epi8('\n'));
+        __m128i r=_mm_cmpeq_epi8(x,_mm_set1_epi8('\r'));
+        __m128i t=_mm_cmpeq_epi8(x,_mm_set1_epi8('\t'));
+        return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(s,n),_mm_or_si128(r,t)));
+}
+
+static json_in scan_whitespace_sse2(json_in p,json_in end) {
+        unsigned int m;
+        for(;end-p>=16;p+=16) {
+                m=~space_mask_sse2(_mm_loadu_si128((const __m128i *)p)) & 0xFFFF;
+                if (m) return p+__builtin_ctz(m);
+        }
+        return scan_whitespace_c(p,end);
+}
+
+/* Setting bit 5 folds '[', ']' and '\\' onto '{', '}' and '|'; the few
+ * other bytes caught this way are ignored by skip_char().
+ */
+static inline unsigned int skip_mask_sse2(__m128i x) {
+        __m128i y=_mm_or_si128(x,_mm_set1_epi8(0x20));
+        __m128i q=_mm_cmpeq_epi8(y,_mm_set1_epi8('\"'));
+        __m128i o=_mm_cmpeq_epi8(y,_mm_set1_epi8('{'));
+        __m128i c=_mm_cmpeq_epi8(y,_mm_set1_epi8('}'));
+        __m128i b=_mm_cmpeq_epi8(y,_mm_set1_epi8('|'));
+        return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(q,b),_mm_or_si128(o,c)));
+}
+
+static json_in scan_skip_sse2(json_in p,json_in end,skipstate *k) {
+        json_in q;
+        for(;end-p>=16;p+=16) {
+                q=skip_block(p,skip_mask_sse2(_mm_loadu_si128((const __m128i *)p)),16,0,k);
+                if (q) return q;
+        }
+        return scan_skip_c(p,end,k);
+}
+
+/* As skip_mask_sse2(), adding ':' and ','. */
+static inline unsigned int structural_mask_sse2(__m128i x) {
+        __m128i y=_mm_or_si128(x,_mm_set1_epi8(0x20));
+        __m128i q=_mm_cmpeq_epi8(y,_mm_set1_epi8('\"'));
+        __m128i o=_mm_cmpeq_epi8(y,_mm_set1_epi8('{'));
+        __m128i c=_mm_cmpeq_epi8(y,_mm_set1_epi8('}'));
+        __m128i b=_mm_cmpeq_epi8(y,_mm_set1_epi8('|'));
+        __m128i l=_mm_cmpeq_epi8(y,_mm_set1_epi8(':'));
+        __m128i m=_mm_cmpeq_epi8(y,_mm_set1_epi8(','));
+        return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_or_si128(q,b),_mm_or_si128(o,c)),_mm_or_si128(l,m)));
+}
+
+static void scan_structurals_sse2(json_in p,json_in end,indexstate *k) {
+        for(;end-p>=16;p+=16)
+                index_block(p,structural_mask_sse2(_mm_loadu_si128((const __m128i *)p)),16,0,k);
+        scan_structurals_c(p,end,k);
+}
+
+static void scan_split_sse2(json_in p,json_in end,splitstate *k) {
+        for(;end-p>=16;p+=16)
+                split_block(p,structural_mask_sse2(_mm_loadu_si128((const __m128i *)p)),16,0,k);
+        scan_split_c(p,end,k);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int string_mask_avx2(__m256i x) {
+        __m256i q=_mm256_cmpeq_epi8(x,_mm256_set1_epi8('\"'));
+        __m256i b=_mm256_cmpeq_epi8(x,_mm256_set1_epi8('\\'));
+        __m256i c=_mm256_cmpeq_epi8(_mm256_min_epu8(x,_mm256_set1_epi8(0x1F)),x);
+        return _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(q,b),c));
+}
+
+__attribute__((target("avx2")))
+static json_in scan_string_avx2(json_in p,json_in end) {
+        unsigned int m;
+        for(;end-p>=32;p+=32) {
+                m=string_mask_avx2(_mm256_loadu_si256((const __m256i *)p));
+                if (m) return p+__builtin_ctz(m);
+        }
+        return scan_string_sse2(p,end);
+}
+
+/* UTF-8 checking with nibble lookup tables (Keiser and Lemire, "Validating
+ * UTF-8 In Less Than One Instruction Per Byte").  Each byte is checked
+ * against the one to three bytes before it; the tables give the errors
+ * that are possible for the high and low nibbles of the byte before and
+ * the high nibble of this byte, and an error is only real if all three
+ * agree.
+ */
+#define UTF8_TOO_SHORT  (1<<0) /* lead byte not followed by continuation */
+#define UTF8_TOO_LONG   (1<<1) /* ASCII followed by continuation */
+#define UTF8_OVERLONG_3 (1<<2)
+#define UTF8_TOO_LARGE  (1<<3)
+#define UTF8_SURROGATE  (1<<4)
+#define UTF8_OVERLONG_2 (1<<5)
+#define UTF8_TOO_LARGE_1000 (1<<6)
+#define UTF8_OVERLONG_4 (1<<6)
+#define UTF8_TWO_CONTS  (1<<7) /* continuation not after a lead byte */
+#define UTF8_CARRY      (UTF8_TOO_SHORT|UTF8_TOO_LONG|UTF8_TWO_CONTS)
+
+#define UTF8_TABLE_AVX2(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p) \
+        _mm256_setr_epi8( \
+                (char)(a),(char)(b),(char)(c),(char)(d),(char)(e),(char)(f),(char)(g),(char)(h), \
+                (char)(i),(char)(j),(char)(k),(char)(l),(char)(m),(char)(n),(char)(o),(char)(p), \
+                (char)(a),(char)(b),(char)(c),(char)(d),(char)(e),(char)(f),(char)(g),(char)(h), \
+                (char)(i),(char)(j),(char)(k),(char)(l),(char)(m),(char)(n),(char)(o),(char)(p))
+
+/* the bytes of x shifted along by n, with the end of prev shifted in */
+#define UTF8_PREV_AVX2(x,prev,n) \
+        _mm256_alignr_epi8(x,_mm256_permute2x128_si256(prev,x,0x21),16-(n))
+
+__attribute__((target("avx2")))
+static inline __m256i utf8_nibble_avx2(__m256i table,__m256i x,int high) {
+        if (high) x=_mm256_srli_epi16(x,4);
+        return _mm256_shuffle_epi8(table,_mm256_and_si256(x,_mm256_set1_epi8(0x0F)));
+}
+
+/* Non-zero bytes where x, following prev, is not valid UTF-8. */
+__attribute__((target("avx2")))
+static inline __m256i utf8_errors_avx2(__m256i x,__m256i prev) {
+        const __m256i byte_1_high=UTF8_TABLE_AVX2(
+                UTF8_TOO_LONG,UTF8_TOO_LONG,UTF8_TOO_LONG,UTF8_TOO_LONG,
+                UTF8_TOO_LONG,UTF8_TOO_LONG,UTF8_TOO_LONG,UTF8_TOO_LONG,
+                UTF8_TWO_CONTS,UTF8_TWO_CONTS,UTF8_TWO_CONTS,UTF8_TWO_CONTS,
+                UTF8_TOO_SHORT|UTF8_OVERLONG_2,
+                UTF8_TOO_SHORT,
+                UTF8_TOO_SHORT|UTF8_OVERLONG_3|UTF8_SURROGATE,
+                UTF8_TOO_SHORT|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000|UTF8_OVERLONG_4);
+        const __m256i byte_1_low=UTF8_TABLE_AVX2(
+                UTF8_CARRY|UTF8_OVERLONG_3|UTF8_OVERLONG_2|UTF8_OVERLONG_4,
+                UTF8_CARRY|UTF8_OVERLONG_2,
+                UTF8_CARRY,
+                UTF8_CARRY,
+                UTF8_CARRY|UTF8_TOO_LARGE,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000|UTF8_SURROGATE,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000,
+                UTF8_CARRY|UTF8_TOO_LARGE|UTF8_TOO_LARGE_1000);
+        const __m256i byte_2_high=UTF8_TABLE_AVX2(
+                UTF8_TOO_SHORT,UTF8_TOO_SHORT,UTF8_TOO_SHORT,UTF8_TOO_SHORT,
+                UTF8_TOO_SHORT,UTF8_TOO_SHORT,UTF8_TOO_SHORT,UTF8_TOO_SHORT,
+                UTF8_TOO_LONG|UTF8_OVERLONG_2|UTF8_TWO_CONTS|UTF8_OVERLONG_3|UTF8_TOO_LARGE_1000|UTF8_OVERLONG_4,
+                UTF8_TOO_LONG|UTF8_OVERLONG_2|UTF8_TWO_CONTS|UTF8_OVERLONG_3|UTF8_TOO_LARGE,
+                UTF8_TOO_LONG|UTF8_OVERLONG_2|UTF8_TWO_CONTS|UTF8_SURROGATE|UTF8_TOO_LARGE,
+                UTF8_TOO_LONG|UTF8_OVERLONG_2|UTF8_TWO_CONTS|UTF8_SURROGATE|UTF8_TOO_LARGE,
+                UTF8_TOO_SHORT,UTF8_TOO_SHORT,UTF8_TOO_SHORT,UTF8_TOO_SHORT);
+        __m256i prev1=UTF8_PREV_AVX2(x,prev,1);
+        __m256i special=_mm256_and_si256(
+                _mm256_and_si256(utf8_nibble_avx2(byte_1_high,prev1,1),utf8_nibble_avx2(byte_1_low,prev1,0)),
+                utf8_nibble_avx2(byte_2_high,x,1));
+        /* the third and fourth bytes of a character must be continuations */
+        __m256i third=_mm256_subs_epu8(UTF8_PREV_AVX2(x,prev,2),_mm256_set1_epi8((char)(0xE0-0x80)));
+        __m256i fourth=_mm256_subs_epu8(UTF8_PREV_AVX2(x,prev,3),_mm256_set1_epi8((char)(0xF0-0x80)));
+        __m256i must=_mm256_and_si256(_mm256_or_si256(third,fourth),_mm256_set1_epi8((char)0x80));
+        return _mm256_xor_si256(must,special);
+}
+
+/* Blocks are checked together; at the first bad block (or the end), the
+ * rest is checked from the start of the character that holds its first
+ * byte, to find exactly where the fault is.
+ */
+__attribute__((target("avx2")))
+static json_in scan_utf8_avx2(json_in p,json_in end) {
+        /* non-zero where a character started near the end of a block runs on */
+        const __m256i last=_mm256_setr_epi8(
+                -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+                -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,(char)(0xF0-1),(char)(0xE0-1),(char)(0xC0-1));
+        __m256i x,prev=_mm256_setzero_si256(),err,incomplete=_mm256_setzero_si256();
+        json_in s=p;
+        for(;end-p>=32;p+=32) {
+                x=_mm256_loadu_si256((const __m256i *)p);
+                /* the tables catch a character cut short by the next one */
+                err=(_mm256_movemask_epi8(x))?utf8_errors_avx2(x,prev):incomplete;
+                if (!_mm256_testz_si256(err,err)) break;
+                incomplete=_mm256_subs_epu8(x,last);
+                prev=x;
+        }
+        /* gcc leaves out the vzeroupper before this tail call */
+        _mm256_zeroupper();
+        return scan_utf8_sse2(utf8_restart(s,p),end);
+}
+
+__attribute__((target("avx2")))
+static json_in scan_string_high_avx2(json_in p,json_in end,json_in *high) {
+        unsigned int m,h;
+        __m256i x;
+        for(;end-p>=32;p+=32) {
+                x=_mm256_loadu_si256((const __m256i *)p);
+                m=string_mask_avx2(x);
+                h=before(_mm256_movemask_epi8(x),m);
+                if (h && !*high) *high=p+__builtin_ctz(h);
+                if (m) return p+__builtin_ctz(m);
+        }
+        return scan_string_high_sse2(p,end,high);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int space_mask_avx2(__m256i x) {
+        __m256i s=_mm256_cmpeq_epi8(x,_mm256_set1_epi8(' '));
+        __m256i n=_mm256_cmpeq_epi8(x,_mm256_set1_epi8('\n'));
+        __m256i r=_mm256_cmpeq_epi8(x,_mm256_set1_epi8('\r'));
+        __m256i t=_mm256_cmpeq_epi8(x,_mm256_set1_epi8('\t'));
+        return _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(s,n),_mm256_or_si256(r,t)));
+}
+
+__attribute__((target("avx2")))
+static json_in scan_whitespace_avx2(json_in p,json_in end) {
+        unsigned int m;
+        for(;end-p>=32;p+=32) {
+                m=~space_mask_avx2(_mm256_loadu_si256((const __m256i *)p));
+                if (m) return p+__builtin_ctz(m);
+        }
+        return scan_whitespace_sse2(p,end);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int skip_mask_avx2(__m256i x) {
+        __m256i y=_mm256_or_si256(x,_mm256_set1_epi8(0x20));
+        __m256i q=_mm256_cmpeq_epi8(y,_mm256_set1_epi8('\"'));
+        __m256i o=_mm256_cmpeq_epi8(y,_mm256_set1_epi8('{'));
+        __m256i c=_mm256_cmpeq_epi8(y,_mm256_set1_epi8('}'));
+        __m256i b=_mm256_cmpeq_epi8(y,_mm256_set1_epi8('|'));
+        return _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(q,b),_mm256_or_si256(o,c)));
+}
+
+__attribute__((target("avx2")))
+static json_in scan_skip_avx2(json_in p,json_in end,skipstate *k) {
+        json_in q;
+        for(;end-p>=32;p+=32) {
+                q=skip_block(p,skip_mask_avx2(_mm256_loadu_si256((const __m256i *)p)),32,0,k);
+                if (q) return q;
+        }
+        return scan_skip_sse2(p,end,k);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int structural_mask_avx2(__m256i x) {
+        __m256i y=_mm256_or_si256(x,_mm256_set1_epi8(0x20));
+        __m256i q=_mm256_cmpeq_epi8(y,_mm256_set1_epi8('\"'));
+        __m256i o=_mm256_cmpeq_epi8(y,_mm256_set1_epi8('{'));
+        __m256i c=_mm256_cmpeq_epi8(y,_mm256_set1_epi8('}'));
+        __m256i b=_mm256_cmpeq_epi8(y,_mm256_set1_epi8('|'));
+        __m256i l=_mm256_cmpeq_epi8(y,_mm256_set1_epi8(':'));
+        __m256i m=_mm256_cmpeq_epi8(y,_mm256_set1_epi8(','));
+        return _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_or_si256(q,b),_mm256_or_si256(o,c)),_mm256_or_si256(l,m)));
+}
+
+__attribute__((target("avx2")))
+static void scan_structurals_avx2(json_in p,json_in end,indexstate *k) {
+        for(;end-p>=32;p+=32)
+                index_block(p,structural_mask_avx2(_mm256_loadu_si256((const __m256i *)p)),32,0,k);
+        scan_structurals_sse2(p,end,k);
+}
+
+__attribute__((target("avx2")))
+static void scan_split_avx2(json_in p,json_in end,splitstate *k) {
+        for(;end-p>=32;p+=32)
+                split_block(p,structural_mask_avx2(_mm256_loadu_si256((const __m256i *)p)),32,0,k);
+        scan_split_sse2(p,end,k);
+}
+
+static inline bool have_avx2(void) {
+#ifdef __AVX2__
+        return true;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif /* SCAN_X86 */
+
+#if SCAN_NEON
+
+/* -- NEON -- */
+
+/* narrow a byte mask to four bits per byte */
+static inline uint64_t nibble_mask_neon(uint8x16_t m) {
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m),4)),0);
+}
+
+static inline uint64_t string_mask_neon(uint8x16_t x) {
+        return nibble_mask_neon(vorrq_u8(
+                vorrq_u8(vceqq_u8(x,vdupq_n_u8('\"')),vceqq_u8(x,vdupq_n_u8('\\'))),
+                vcltq_u8(x,vdupq_n_u8(0x20))));
+}
+
+static json_in scan_string_neon(json_in p,json_in end) {
+        uint64_t m;
+        for(;end-p>=16;p+=16) {
+                m=string_mask_neon(vld1q_u8((const uint8_t *)p));
+                if (m) return p+__builtin_ctzll(m)/4;
+        }
+        return scan_string_c(p,end);
+}
+
+static json_in scan_string_high_neon(json_in p,json_in end,json_in *high) {
+        uint64_t m,h;
+        uint8x16_t x;
+        for(;end-p>=16;p+=16) {
+                x=vld1q_u8((const uint8_t *)p);
+                m=string_mask_neon(x);
+                h=nibble_mask_neon(vcgeq_u8(x,vdupq_n_u8(0x80)));
+                if (m) h&=(m & -m)-1;
+                if (h && !*high) *high=p+__builtin_ctzll(h)/4;
+                if (m) return p+__builtin_ctzll(m)/4;
+        }
+        return scan_string_high_c(p,end,high);
+}
+
+/* As scan_utf8_sse2(). */
+static json_in scan_utf8_neon(json_in p,json_in end) {
+        json_in q;
+        int n;
+        while(end-p>=16) {
+                if (vmaxvq_u8(vld1q_u8((const uint8_t *)p))<0x80) {p+=16; continue;}
+                for(q=p+16;p<q;p+=n) {
+                        n=utf8_length(p,end);
+                        if (!n) return p;
+                }
+        }
+        return scan_utf8_c(p,end);
+}
+
+static inline uint64_t space_mask_neon(uint8x16_t x) {
+        return nibble_mask_neon(vorrq_u8(
+                vorrq_u8(vceqq_u8(x,vdupq_n_u8(' ')),vceqq_u8(x,vdupq_n_u8('\n'))),
+                vorrq_u8(vceqq_u8(x,vdupq_n_u8('\r')),vceqq_u8(x,vdupq_n_u8('\t')))));
+}
+
+static json_in scan_whitespace_neon(json_in p,json_in end) {
+        uint64_t m;
+        for(;end-p>=16;p+=16) {
+                m=~space_mask_neon(vld1q_u8((const uint8_t *)p));
+                if (m) return p+__builtin_ctzll(m)/4;
+        }
+        return scan_whitespace_c(p,end);
+}
+
+static inline uint64_t skip_mask_neon(uint8x16_t x) {
+        uint8x16_t y=vorrq_u8(x,vdupq_n_u8(0x20)); /* as skip_mask_sse2() */
+        return nibble_mask_neon(vorrq_u8(
+                vorrq_u8(vceqq_u8(y,vdupq_n_u8('\"')),vceqq_u8(y,vdupq_n_u8('|'))),
+                vorrq_u8(vceqq_u8(y,vdupq_n_u8('{')),vceqq_u8(y,vdupq_n_u8('}')))));
+}
+
+static json_in scan_skip_neon(json_in p,json_in end,skipstate *k) {
+        json_in q;
+        for(;end-p>=16;p+=16) {
+                q=skip_block(p,skip_mask_neon(vld1q_u8((const uint8_t *)p)),16,2,k);
+                if (q) return q;
+        }
+        return scan_skip_c(p,end,k);
+}
+
+static inline uint64_t structural_mask_neon(uint8x16_t x) {
+        uint8x16_t y=vorrq_u8(x,vdupq_n_u8(0x20));
+        return nibble_mask_neon(vorrq_u8(vorrq_u8(
+                vorrq_u8(vceqq_u8(y,vdupq_n_u8('\"')),vceqq_u8(y,vdupq_n_u8('|'))),
+                vorrq_u8(vceqq_u8(y,vdupq_n_u8('{')),vceqq_u8(y,vdupq_n_u8('}')))),
+                vorrq_u8(vceqq_u8(y,vdupq_n_u8(':')),vceqq_u8(y,vdupq_n_u8(',')))));
+}
+
+static void scan_structurals_neon(json_in p,json_in end,indexstate *k) {
+        for(;end-p>=16;p+=16)
+                index_block(p,structural_mask_neon(vld1q_u8((const uint8_t *)p)),16,2,k);
+        scan_structurals_c(p,end,k);
+}
+
+static void scan_split_neon(json_in p,json_in end,splitstate *k) {
+        for(;end-p>=16;p+=16)
+                split_block(p,structural_mask_neon(vld1q_u8((const uint8_t *)p)),16,2,k);
+        scan_split_c(p,end,k);
+}
+
+#endif /* SCAN_NEON */
+
+/* -- dispatch -- */
+
+json_in json_scan_string(json_in p,json_in end) {
+#if SCAN_X86
+        if (have_avx2()) return scan_string_avx2(p,end);
+        return scan_string_sse2(p,end);
+#elif SCAN_NEON
+        return scan_string_neon(p,end);
+#else
+        return scan_string_c(p,end);
+#endif
+}
+
+json_in json_scan_string_high(json_in p,json_in end,json_in *high) {
+#if SCAN_X86
+        if (have_avx2()) return scan_string_high_avx2(p,end,high);
+        return scan_string_high_sse2(p,end,high);
+#elif SCAN_NEON
+        return scan_string_high_neon(p,end,high);
+#else
+        return scan_string_high_c(p,end,high);
+#endif
+}
+
+json_in json_scan_utf8(json_in p,json_in end) {
+#if SCAN_X86
+        /* most strings are short, and mostly ASCII */
+        if (end-p>=64 && have_avx2()) return scan_utf8_avx2(p,end);
+        return scan_utf8_sse2(p,end);
+#elif SCAN_NEON
+        return scan_utf8_neon(p,end);
+#else
+        return scan_utf8_c(p,end);
+#endif
+}
+
+json_in json_scan_whitespace(json_in p,json_in end) {
+#if SCAN_X86
+        if (have_avx2()) return scan_whitespace_avx2(p,end);
+        return scan_whitespace_sse2(p,end);
+#elif SCAN_NEON
+        return scan_whitespace_neon(p,end);
+#else
+        return scan_whitespace_c(p,end);
+#endif
+}
+
+json_in json_scan_skip(json_in p,json_in end,int *depth,bool *string,bool *escape) {
+        skipstate k={*depth,*string,*escape};
+        json_in q;
+#if SCAN_X86
+        if (have_avx2()) q=scan_skip_avx2(p,end,&k);
+        else q=scan_skip_sse2(p,end,&k);
+#elif SCAN_NEON
+        q=scan_skip_neon(p,end,&k);
+#else
+        q=scan_skip_c(p,end,&k);
+#endif
+        *depth=k.depth;
+        *string=k.string;
+        *escape=k.escape;
+        return (q)?q:end;
+}
+
+size_t json_scan_structurals(json_in s,json_in end,uint32_t *index,size_t max,bool *string) {
+        indexstate k={s,index,0,max,false,false};
+#if SCAN_X86
+        if (have_avx2()) scan_structurals_avx2(s,end,&k);
+        else scan_structurals_sse2(s,end,&k);
+#elif SCAN_NEON
+        scan_structurals_neon(s,end,&k);
+#else
+        scan_structurals_c(s,end,&k);
+#endif
+        *string=k.string;
+        return k.n;
+}
+
+bool json_scan_split(json_in s,json_in end,bool escape,json_scanlevel level[2]) {
+        splitstate k={level,false,escape};
+        memset(level,0,2*sizeof(*level));
+#if SCAN_X86
+        if (have_avx2()) scan_split_avx2(s,end,&k);
+        else scan_split_sse2(s,end,&k);
+#elif SCAN_NEON
+        scan_split_neon(s,end,&k);
+#else
+        scan_split_c(s,end,&k);
+#endif
+        return k.odd;
+}
@@ -0,0 +1,75 @@
+/* > json-scan.h */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Byte-scanning kernels used by the parser.  Not part of the public API. */
+
+/* The kernels use SIMD instructions where the target has them (SSE2,
+ * with AVX2 chosen at run time, on x86; NEON on AArch64) and plain C
+ * everywhere else.  They never read at or beyond "end", and return "end"
+ * if nothing is found.
+ */
+
+#ifndef STACK_JSON_SCAN_H
+#define STACK_JSON_SCAN_H
+
+#include <stdint.h>
+#include "json.h"
+
+/* Returns a pointer to the first '"', '\\' or control character
+ * (below 0x20) at or after p.
+ */
+extern json_in json_scan_string(json_in p,json_in end);
+
+/* As json_scan_string(), also setting *high (if it is NULL) to the first
+ * byte of the run that is not ASCII.
+ */
+extern json_in json_scan_string_high(json_in p,json_in end,json_in *high);
+
+/* Returns a pointer to the first byte at or after p that does not start
+ * a valid UTF-8 character (overlong forms, surrogates and code points
+ * above U+10FFFF are invalid).  p must be at the start of a character.
+ */
+extern json_in json_scan_utf8(json_in p,json_in end);
+
+/* Returns a pointer to the first non-whitespace character at or after p. */
+extern json_in json_scan_whitespace(json_in p,json_in end);
+
+/* Pass over the contents of an object or array, following only quotes,
+ * escapes and brackets.  *depth is the number of brackets open (start with
+ * 0 at the opening bracket, or 1 just after it); *string and *escape track
+ * strings, and are false at the start.  Returns just past the bracket that
+ * brings *depth to 0, or "end" with the state updated for the next chunk.
+ */
+extern json_in json_scan_skip(json_in p,json_in end,int *depth,bool *string,bool *escape);
+
+/* Find the quotes around strings, and the brackets, braces, colons and
+ * commas outside strings, writing their offsets from s to index.  Returns
+ * the number found, which may be more than max (only max are written).
+ * *string is set if the text ends inside a string.
+ */
+extern size_t json_scan_structurals(json_in s,json_in end,uint32_t *index,size_t max,bool *string);
+
+/* Brackets and commas in a piece of text, as seen by one guess at
+ * whether the piece starts inside a string.
+ */
+typedef struct {
+        int depth;        /* net change in nesting */
+        int min;          /* lowest nesting reached, relative to the start */
+        size_t commas;    /* commas at that lowest nesting */
+        json_in first;    /* the first of those commas */
+} json_scanlevel;
+
+/* Scan a piece of text that may start anywhere, e.g. part way through a
+ * string, for both guesses at once: level[0] if it starts outside a
+ * string, level[1] if inside.  escape is set if the first character is
+ * escaped.  Returns true if the piece holds an odd number of quotes.
+ */
+extern bool json_scan_split(json_in s,json_in end,bool escape,json_scanlevel level[2]);
+
+/* JSON whitespace: space, tab, newline and carriage return. */
+static inline bool json_isspace(char x) {
+        return x==' ' || x=='\n' || x=='\r' || x=='\t';
+}
+
+#endif
@@ -0,0 +1,271 @@
+/* > json-thread.c */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Parsing on several threads.
+ *
+ * The text is cut into a few pieces per thread, and the threads take
+ * pieces in turn until none are left, so a slow piece does not hold up the
+ * rest.  Threads share nothing but the piece counter and the result.
+ */
+
+#ifndef ARDUINO
+
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "json.h"
+#include "json-scan.h"
+#include "json-thread.h"
+
+#define PIECES_PER_THREAD 4
+#define PIECES (JSON_THREADS_MAX*PIECES_PER_THREAD)
+
+typedef struct {
+        const char *s,*end;
+        size_t first;     /* line number of the first line */
+        size_t lines;     /* newlines in the piece */
+        json_scanlevel level[2]; /* for each guess at where strings are */
+        bool odd;         /* the piece holds an odd number of quotes */
+        bool escape;      /* the first character is escaped */
+} piece;
+
+/* A run of whole elements of an array. */
+typedef struct {
+        const char *s,*end;
+        size_t first;     /* index of the first element */
+} group;
+
+typedef struct job_s job;
+struct job_s {
+        const json_callbacks *cb;
+        piece piece[PIECES];
+        int npieces;
+        group group[PIECES+1];
+        int ngroups;
+        const char *array;     /* start of the top-level array */
+        int nthreads;
+        int count;        /* pieces or groups to work on */
+        int next;         /* next one to take */
+        bool ok;
+        void (*work)(job *j,int worker,int i);
+};
+
+typedef struct {
+        job *j;
+        int worker;
+} runner;
+
+static void *run_worker(void *arg) {
+        runner *w=arg;
+        job *j=w->j;
+        int i;
+        while((i=__atomic_fetch_add(&j->next,1,__ATOMIC_RELAXED)) < j->count)
+                j->work(j,w->worker,i);
+        return NULL;
+}
+
+/* Run work on pieces or groups 0..count-1 with the job's threads, the
+ * caller being worker 0.  A thread that cannot be started leaves its share
+ * to the others.
+ */
+static void run(job *j,int count,void (*work)(job *,int,int)) {
+        pthread_t thread[JSON_THREADS_MAX];
+        runner w[JSON_THREADS_MAX];
+        bool started[JSON_THREADS_MAX];
+        int i,n=j->nthreads;
+
+        j->work=work;
+        j->count=count;
+        j->next=0;
+        if (n>count) n=count;
+        for(i=0;i<n;i++) {
+                w[i].j=j;
+                w[i].worker=i;
+                started[i]=(i>0 && pthread_create(&thread[i],NULL,run_worker,&w[i])==0);
+        }
+        if (n>0) run_worker(&w[0]);
+        for(i=1;i<n;i++) if (started[i]) pthread_join(thread[i],NULL);
+}
+
+static int threads(int nthreads) {
+        if (nthreads<=0) nthreads=(int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (nthreads<1) nthreads=1;
+        if (nthreads>JSON_THREADS_MAX) nthreads=JSON_THREADS_MAX;
+        return nthreads;
+}
+
+/* Cut [s,end) into pieces near each nth of its length, moving each cut
+ * forward to just after a newline if newline is set.
+ */
+static void cut(job *j,const char *s,const char *end,bool newline) {
+        size_t len=end-s;
+        const char *start=s,*e;
+        int i,n=j->nthreads*PIECES_PER_THREAD;
+
+        j->npieces=0;
+        for(i=0;i<n && s<end;i++) {
+                e=start+len/n*(i+1);
+                if (i==n-1 || e>=end) e=end;
+                else if (e<s) e=s;
+                else if (newline) {
+                        e=memchr(e,'\n',end-e);
+                        e=(e)?e+1:end;
+                }
+                j->piece[j->npieces].s=s;
+                j->piece[j->npieces].end=e;
+                j->npieces++;
+                s=e;
+        }
+}
+
+/* The callbacks for a worker, with its own copy of the query match state. */
+static void worker_callbacks(job *j,json_callbacks *cb,json_queries *q) {
+        *cb=*j->cb;
+        if (cb->queries) {
+                *q=*cb->queries;
+                cb->queries=q;
+        }
+}
+
+/* -- JSON Lines -- */
+
+static void count_lines(job *j,int worker,int i) {
+        piece *p=&j->piece[i];
+        const char *s;
+        (void)worker;
+        p->lines=0;
+        for(s=p->s;(s=memchr(s,'\n',p->end-s));s++) p->lines++;
+}
+
+static bool blank(const char *s,const char *e) {
+        for(;s<e;s++) if (*s!=' ' && *s!='\t' && *s!='\r' && *s!='\n') return false;
+        return true;
+}
+
+static void parse_lines(job *j,int worker,int i) {
+        const piece *p=&j->piece[i];
+        json_callbacks cb;
+        json_queries q;
+        const char *s,*e;
+        size_t line=p->first;
+        bool ok=true;
+
+        worker_callbacks(j,&cb,&q);
+        for(s=p->s;s<p->end;s=e+1,line++) {
+                e=memchr(s,'\n',p->end-s);
+                if (!e) e=p->end;
+                if (!blank(s,e) && !json_parse_record(&cb,s,e-s,line,worker)) ok=false;
+        }
+        if (!ok) __atomic_store_n(&j->ok,false,__ATOMIC_RELAXED);
+}
+
+bool json_parse_lines(const json_callbacks *cb,const char *text,size_t len,int nthreads) {
+        static json_callbacks none;
+        job j={};
+        size_t line=0;
+        int i;
+
+        if (!text) return false;
+        j.nthreads=threads(nthreads);
+        j.cb=(cb)?cb:&none;
+        j.ok=true;
+        cut(&j,text,text+len,true);
+        if (j.npieces>1) run(&j,j.npieces,count_lines);
+        for(i=0;i<j.npieces;i++) {
+                j.piece[i].first=line;
+                line+=j.piece[i].lines;
+        }
+        run(&j,j.npieces,parse_lines);
+        return j.ok;
+}
+
+/* -- one big array -- */
+
+/* Each piece of the array's contents is scanned for brackets and commas
+ * twice over in one pass, guessing that it starts outside a string and
+ * inside one.  Going through the pieces in order then tells which guess
+ * was right, and so where the commas between elements are: the array is
+ * split at the first such comma in each piece.  If the guesses do not add
+ * up, the text is not valid JSON and is parsed on one thread, to report
+ * the error.
+ */
+
+static void split_piece(job *j,int worker,int i) {
+        piece *p=&j->piece[i];
+        (void)worker;
+        p->odd=json_scan_split(p->s,p->end,p->escape,p->level);
+}
+
+static void parse_group(job *j,int worker,int i) {
+        const group *g=&j->group[i];
+        json_callbacks cb;
+        json_queries q;
+
+        worker_callbacks(j,&cb,&q);
+        if (!json_parse_elements(&cb,j->array,g->s,g->end,(int)g->first,worker))
+                __atomic_store_n(&j->ok,false,__ATOMIC_RELAXED);
+}
+
+static bool array_contents(json_parser *jp,void *arg) {
+        job *j=arg;
+        /* the parser's callbacks, with the query state inside the array */
+        j->cb=&jp->callbacks;
+        run(j,j->ngroups,parse_group);
+        return j->ok;
+}
+
+/* Returns false if the pieces do not add up. */
+static bool split(job *j,const char *s,const char *close) {
+        const json_scanlevel *l;
+        size_t commas=0;
+        bool string=false;
+        int i,depth=1;
+
+        j->ngroups=0;
+        if (blank(s,close)) return true;
+        j->group[0].s=s;
+        j->group[0].first=0;
+        for(i=0;i<j->npieces;i++) {
+                l=&j->piece[i].level[string];
+                if (depth+l->min<1) return false;
+                if (depth+l->min==1 && l->commas) {
+                        j->group[j->ngroups++].end=l->first;
+                        j->group[j->ngroups].s=l->first+1;
+                        j->group[j->ngroups].first=commas+1;
+                        commas+=l->commas;
+                }
+                depth+=l->depth;
+                string^=j->piece[i].odd;
+        }
+        j->group[j->ngroups++].end=close;
+        return depth==1 && !string;
+}
+
+bool json_parse_array(const json_callbacks *cb,const char *text,size_t len,int nthreads) {
+        job j={};
+        const char *s=text,*e=text+len,*q;
+        bool ok;
+        int i,n;
+
+        if (!text) return false;
+        while(s<e && blank(s,s+1)) s++;
+        while(e>s && blank(e-1,e)) e--;
+        j.nthreads=threads(nthreads);
+        if (j.nthreads==1 || e-s<2 || *s!='[' || e[-1]!=']') return json_parse_record(cb,text,len,0,0);
+
+        j.array=s;
+        j.ok=true;
+        cut(&j,s+1,e-1,false);
+        for(i=0;i<j.npieces;i++) {
+                /* an odd run of backslashes escapes the first character */
+                for(n=0,q=j.piece[i].s;q>s && q[-1]=='\\';q--) n++;
+                j.piece[i].escape=(n%2==1);
+        }
+        run(&j,j.npieces,split_piece);
+        if (split(&j,s+1,e-1)) ok=json_parse_array_with(cb,s,e,array_contents,&j);
+        else ok=json_parse_record(cb,text,len,0,0);
+        return ok;
+}
+
+#endif /* ARDUINO */
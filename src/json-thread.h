@@ -0,0 +1,35 @@
+/* > json-thread.h */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Hooks from the parallel drivers into the parser.  Not part of the
+ * public API.
+ */
+
+#ifndef STACK_JSON_THREAD_H
+#define STACK_JSON_THREAD_H
+
+#include "json.h"
+
+/* As json_parse_n(), but the value must fill the text (but for
+ * whitespace), and the callbacks see the given record and worker numbers.
+ * Returns false on error.
+ */
+extern bool json_parse_record(const json_callbacks *cb,const char *s,size_t len,size_t record,int worker);
+
+/* Parse the top-level array from s (its '[') to end (just past its ']'):
+ * call back for the array itself, then contents() to parse what is
+ * between the brackets, given the parser with its query state inside the
+ * array.  Returns false on error.
+ */
+extern bool json_parse_array_with(const json_callbacks *cb,const char *s,const char *end,
+        bool (*contents)(json_parser *jp,void *arg),void *arg);
+
+/* Parse the comma-separated values [s,end) in the top-level array that
+ * starts at array, the first having the given index.  Returns false on
+ * error.
+ */
+extern bool json_parse_elements(const json_callbacks *cb,const char *array,const char *s,const char *end,
+        int index,int worker);
+
+#endif
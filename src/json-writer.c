@@ -0,0 +1,196 @@
+/* > json-writer.c */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* Writing JSON text into a caller's buffer.
+ *
+ * Strings are copied a run at a time: the scan that finds the end of a
+ * string when parsing finds exactly the bytes that need escaping here.
+ * Numbers are formatted straight into the buffer when there is room.
+ */
+
+#include <string.h>
+#include "json.h"
+#include "json-scan.h"
+#include "json-number.h"
+
+void json_writer_init(json_writer *w,char *buf,size_t size) {
+        memset(w,0,sizeof(*w));
+        w->buf=buf;
+        w->size=size;
+}
+
+/* Make room for n more bytes in the buffer, or fail. */
+static bool room(json_writer *w,size_t n) {
+        if (w->failed) return false;
+        if (w->size-w->used>=n) return true;
+        if (w->flush) {
+                if (!w->flush(w->buf,w->used,w->context)) {
+                        w->failed=true;
+                        return false;
+                }
+                w->used=0;
+                if (w->size>=n) return true;
+        }
+        if (w->grow && w->grow(w,n,w->context) && w->size-w->used>=n) return true;
+        w->failed=true;
+        return false;
+}
+
+/* Text of any length: a piece at a time if it does not fit. */
+static inline void put(json_writer *w,const char *s,size_t n) {
+        size_t k;
+        if (w->size-w->used>=n && !w->failed) {
+                memcpy(w->buf+w->used,s,n);
+                w->used+=n;
+                return;
+        }
+        while(n>0 && room(w,1)) {
+                k=w->size-w->used;
+                if (k>n) k=n;
+                memcpy(w->buf+w->used,s,k);
+                w->used+=k;
+                s+=k;
+                n-=k;
+        }
+}
+
+static void put_escaped(json_writer *w,const char *s,size_t n) {
+        static const char hex[]="0123456789abcdef";
+        json_in p=s,q,end=s+n;
+        char u[6]={'\\','u','0','0'};
+
+        put(w,"\"",1);
+        for(;;p=q+1) {
+                q=json_scan_string(p,end);
+                put(w,p,q-p);
+                if (q>=end) break;
+                switch(*q) {
+                case '\"': put(w,"\\\"",2); break;
+                case '\\': put(w,"\\\\",2); break;
+                case '\b': put(w,"\\b",2); break;
+                case '\f': put(w,"\\f",2); break;
+                case '\n': put(w,"\\n",2); break;
+                case '\r': put(w,"\\r",2); break;
+                case '\t': put(w,"\\t",2); break;
+                default:
+                        u[4]=hex[(*q>>4) & 0xF];
+                        u[5]=hex[*q & 0xF];
+                        put(w,u,6);
+                        break;
+                }
+        }
+        put(w,"\"",1);
+}
+
+/* Before each value or name. */
+static void separate(json_writer *w) {
+        if (w->comma) put(w,",",1);
+        w->comma=true;
+}
+
+void json_write_begin_object(json_writer *w) {
+        separate(w);
+        put(w,"{",1);
+        w->comma=false;
+}
+
+void json_write_end_object(json_writer *w) {
+        put(w,"}",1);
+        w->comma=true;
+}
+
+void json_write_begin_array(json_writer *w) {
+        separate(w);
+        put(w,"[",1);
+        w->comma=false;
+}
+
+void json_write_end_array(json_writer *w) {
+        put(w,"]",1);
+        w->comma=true;
+}
+
+void json_write_key(json_writer *w,const char *s,size_t n) {
+        separate(w);
+        put_escaped(w,s,n);
+        put(w,":",1);
+        w->comma=false;
+}
+
+void json_write_string(json_writer *w,const char *s,size_t n) {
+        separate(w);
+        put_escaped(w,s,n);
+}
+
+void json_write_number(json_writer *w,double x) {
+        char tmp[JSON_NUMBER_TEXT_MAX];
+        int n;
+
+        separate(w);
+        if (!w->failed && w->size-w->used>=JSON_NUMBER_TEXT_MAX) {
+                n=json_format_double(w->buf+w->used,x);
+                if (n) {
+                        w->used+=n;
+                        return;
+                }
+        }
+        else {
+                n=json_format_double(tmp,x);
+                if (n) {
+                        put(w,tmp,n);
+                        return;
+                }
+        }
+        put(w,"null",4);
+}
+
+void json_write_integer(json_writer *w,int64_t x) {
+        char tmp[JSON_NUMBER_TEXT_MAX];
+
+        separate(w);
+        if (!w->failed && w->size-w->used>=JSON_NUMBER_TEXT_MAX) w->used+=json_format_int64(w->buf+w->used,x);
+        else put(w,tmp,json_format_int64(tmp,x));
+}
+
+void json_write_bool(json_writer *w,bool b) {
+        separate(w);
+        if (b) put(w,"true",4);
+        else put(w,"false",5);
+}
+
+void json_write_null(json_writer *w) {
+        separate(w);
+        put(w,"null",4);
+}
+
+void json_write_value(json_writer *w,const json_value *v) {
+        switch(v->type) {
+        case json_type_string:
+                separate(w);
+                put(w,"\"",1);
+                put(w,v->string.s,v->string.n);
+                put(w,"\"",1);
+                break;
+        case json_type_number:
+                if (!v->lazy) {
+                        json_write_number(w,v->number);
+                        break;
+                }
+                separate(w);
+                put(w,v->lexeme.s,v->lexeme.n);
+                break;
+        case json_type_integer: json_write_integer(w,v->integer); break;
+        case json_type_bool:    json_write_bool(w,v->truefalse); break;
+        case json_type_null:    json_write_null(w); break;
+        default:                w->failed=true; break;
+        }
+}
+
+bool json_writer_finish(json_writer *w) {
+        if (!w->failed && w->flush && w->used) {
+                if (w->flush(w->buf,w->used,w->context)) w->used=0;
+                else w->failed=true;
+        }
+        return !w->failed;
+}
@@ -12,60 +12,192 @@
 
 #else
 
-#include <stdio.h>
 #define OUT printf
 #define GETTEXT(X) X
 
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include "json.h"
+#include "json-scan.h"
+#include "json-query.h"
+#include "json-number.h"
+#include "json-thread.h"
+
+#ifdef JSON_STATS_CYCLES
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
 
-typedef struct {
-        json_valuecontext root;
-        json_callbacks callbacks;
-        int errcount;
-        json_in string;
-} superelement;
+typedef json_parser superelement;
 
 typedef json_valuecontext ctx;
 
-static json_in got_value(ctx *,json_in);
+static json_in got_value(ctx *,json_in,json_in);
 
 /* -- utility -- */
 
-static json_in startswith(const char *match,json_in p) {
-        size_t n=strlen(match);
-        if (strncmp(p,match,n)==0) return p+n;
-        return NULL;
+/* Returns the character at p, or '\0' at the end of the text. */
+static inline char peek(json_in p,json_in end) {
+        return (p<end)?*p:'\0';
 }
 
+/* The word of n bytes at p: with n constant, one or two word compares. */
+static inline json_in literal(const char *word,size_t n,json_in p,json_in end) {
+        if ((size_t)(end-p)<n || memcmp(p,word,n)!=0) return NULL;
+        return p+n;
+}
+
+/* What a value can be, from its first byte. */
+enum {
+        L_INVALID,
+        L_OBJECT,
+        L_ARRAY,
+        L_STRING,
+        L_NUMBER,
+        L_BOOL,
+        L_NULL,
+};
+
+static const unsigned char first_byte[256]={
+        ['{']=L_OBJECT,
+        ['[']=L_ARRAY,
+        ['\"']=L_STRING,
+        ['-']=L_NUMBER,
+        ['0']=L_NUMBER,['1']=L_NUMBER,['2']=L_NUMBER,['3']=L_NUMBER,['4']=L_NUMBER,
+        ['5']=L_NUMBER,['6']=L_NUMBER,['7']=L_NUMBER,['8']=L_NUMBER,['9']=L_NUMBER,
+        ['t']=L_BOOL,
+        ['f']=L_BOOL,
+        ['n']=L_NULL,
+};
+
 static bool match_nchar(const char *match,const json_nchar *s) {
-        int n=strlen(match);
+        int i;
         if (s->s==NULL && s->n==0 && match==NULL) return true;
         if (!s->s || !match) return false;
-        if (s->n!=n) return false;
-        if (strncmp(s->s,match,n)!=0) return false;
-        return true;
+        /* one pass, without strlen() */
+        for(i=0;i<s->n;i++) if (!match[i] || match[i]!=s->s[i]) return false;
+        return match[i]=='\0';
 }
 
 static superelement *getsuperelement(const ctx *c) {
-        while(c && c->prev) c=c->prev;
+        if (!c) return NULL;
+        c=c->root;
         char *ptr=(void*)c;
         ptr-=offsetof(superelement,root);
         return (superelement*)ptr;
 }
 
+/* -- statistics -- */
+
+/* With JSON_STATS, STATS() runs its statement with stats pointing at the
+ * caller's counters, if there are any, and CALLBACK() counts and times a
+ * call to the caller.  Without it, both compile to nothing (or the bare
+ * call).
+ */
+
+#ifdef JSON_STATS
+
+#ifdef JSON_STATS_CYCLES
+static inline uint64_t ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t t;
+        __asm__ volatile("mrs %0, cntvct_el0" : "=r"(t));
+        return t;
+#else
+        return clock();
+#endif
+}
+#else
+static inline uint64_t ticks(void) {
+        return 0;
+}
+#endif
+
+#define STATS(super,statement) do { \
+        json_stats *stats=(super)->callbacks.stats; \
+        if (stats) {statement;} \
+} while(0)
+
+#define CALLBACK(super,call) do { \
+        json_stats *stats=(super)->callbacks.stats; \
+        uint64_t t=(stats)?ticks():0; \
+        call; \
+        if (stats) { \
+                stats->callbacks++; \
+                stats->callback_ticks+=ticks()-t; \
+        } \
+} while(0)
+
+typedef struct {
+        uint64_t start,callback;
+} stats_mark;
+
+/* Count len bytes of text about to be parsed. */
+static stats_mark stats_begin(superelement *super,size_t len) {
+        json_stats *stats=super->callbacks.stats;
+        stats_mark m={};
+        if (stats) {
+                stats->bytes+=len;
+                m.callback=stats->callback_ticks;
+                m.start=ticks();
+        }
+        return m;
+}
+
+/* The time since stats_begin(), less that in callbacks, was parsing. */
+static void stats_end(superelement *super,stats_mark m) {
+        json_stats *stats=super->callbacks.stats;
+        if (stats) stats->parser_ticks+=ticks()-m.start-(stats->callback_ticks-m.callback);
+}
+
+/* The parallel parsers' workers would race on the counters. */
+static void stats_off(superelement *super) {
+        super->callbacks.stats=NULL;
+}
+
+#else
+
+#define STATS(super,statement) do {} while(0)
+#define CALLBACK(super,call) call
+
+typedef int stats_mark;
+static inline stats_mark stats_begin(superelement *super,size_t len) {
+        (void)super; (void)len;
+        return 0;
+}
+static inline void stats_end(superelement *super,stats_mark m) {
+        (void)super; (void)m;
+}
+static inline void stats_off(superelement *super) {
+        (void)super;
+}
+
+#endif
+
+/* Set the key ID for the name in c. */
+static inline void name_key(ctx *c) {
+        const json_keys *keys=getsuperelement(c)->callbacks.keys;
+        if (keys) c->key=json_key_id(keys,&c->name);
+}
+
 static json_in not_thing(ctx *c,const char *thing,json_in s,json_in p,const char *msg) {
         /* report invalid type of thing */
         superelement *super=getsuperelement(c);
         if (!super) return NULL;
+        if (super->stopped) return NULL; /* unwinding, not an error */
         const json_callbacks *cb=&super->callbacks;
         super->errcount++;
         if (super->errcount <= 1)
-                cb->error(&super->root,thing,s,p,msg,cb->context);
+                CALLBACK(super,cb->error(&super->root,thing,s,p,msg,cb->context));
         return NULL;
 }
 
@@ -79,6 +211,10 @@ static void default_got_value(const json_valuecontext *base,const json_value *v,
         OUT("\n");
 }
 
+static void ignore_value(const json_valuecontext *base,const json_value *v,void *context) {
+        (void)base; (void)v; (void)context;
+}
+
 static void default_error(const json_valuecontext *c,const char *dtype,json_in s,json_in p,const char *msg,void *context) {
         (void)context;
         OUT("%s %s (%s):\n",GETTEXT("bad"),dtype,msg);
@@ -89,7 +225,7 @@ static void default_error(const json_valuecontext *c,const char *dtype,json_in s
         }
         json_in q;
         /* highlight error */
-        for(q=super->string;*q;q++) {
+        for(q=super->string;q<super->end;q++) {
                 OUT("%s%s%c%s",
                         (q==s)?"!!!":"" /* highlight element */,
                         (q==p)?"<<<":"" /* highlight character in element */,
@@ -101,66 +237,41 @@ static void default_error(const json_valuecontext *c,const char *dtype,json_in s
 
 /* -- parser -- */
 
-static json_in eat_whitespace(json_in p) {
+static inline json_in eat_whitespace(json_in p,json_in end) {
         if (!p) return p;
-        for(;*p;p++) {
-                switch(*p) {
-                case ' ':
-                case '\n':
-                case '\r':
-                case '\t':
-                        continue;
-                }
-                break;
-        }
-        return p;
+        /* most tokens are followed by nothing, or by a single space */
+        if (p>=end || !json_isspace(*p)) return p;
+        p++;
+        if (p>=end || !json_isspace(*p)) return p;
+        /* indentation: jump over the rest of the run */
+        return json_scan_whitespace(p+1,end);
 }
 
-static json_in eat_hex(json_in p,int max,unsigned int *value) {
-        /* somewhat dependent on ASCII */
-        json_in s;
-        int d;
-        *value=0;
-        for(s=p;*s;s++) {
-                d=-1;
-                if (max>0 && s-p>=max) break;
-                switch(*s) {
-                case '0':
-                case '1':
-                case '2':
-                case '3':
-                case '4':
-                case '5':
-                case '6':
-                case '7':
-                case '8':
-                case '9':
-                        d = *s - '0';
-                        break;
-                case 'A':
-                case 'B':
-                case 'C':
-                case 'D':
-                case 'E':
-                case 'F':
-                        d = 10 + *s - 'A';
-                        break;
-                case 'a':
-                case 'b':
-                case 'c':
-                case 'd':
-                case 'e':
-                case 'f':
-                        d = 10 + *s - 'a';
-                        break;
-                default:
-                        break;
-                }
-                if (d<0) break;
-                *value = 0x10 * (*value) + d;
-        }
-        if (max>0 && s-p!=max) return NULL;
-        return s;
+/* One more than the value of each hex digit, or 0 for other bytes. */
+static const unsigned char hexdigit[256]={
+        ['0']=1,['1']=2,['2']=3,['3']=4,['4']=5,['5']=6,['6']=7,['7']=8,['8']=9,['9']=10,
+        ['A']=11,['B']=12,['C']=13,['D']=14,['E']=15,['F']=16,
+        ['a']=11,['b']=12,['c']=13,['d']=14,['e']=15,['f']=16,
+};
+
+/* The four hex digits at p, or -1. */
+static long hex4(json_in p) {
+        unsigned int a=hexdigit[(unsigned char)p[0]],b=hexdigit[(unsigned char)p[1]];
+        unsigned int c=hexdigit[(unsigned char)p[2]],d=hexdigit[(unsigned char)p[3]];
+        if (!a || !b || !c || !d) return -1;
+        return (a-1)<<12 | (b-1)<<8 | (c-1)<<4 | (d-1);
+}
+
+/* If *cp is a high surrogate and q holds the escaped low one, join them
+ * and step past it.
+ */
+static json_in low_surrogate(json_in q,json_in end,unsigned int *cp) {
+        long lo;
+        if (*cp<0xD800 || *cp>=0xDC00 || end-q<6 || q[0]!='\\' || q[1]!='u') return q;
+        lo=hex4(q+2);
+        if (lo<0xDC00 || lo>=0xE000) return q;
+        *cp=0x10000+((*cp-0xD800)<<10)+(lo-0xDC00);
+        return q+6;
 }
 
 typedef struct {
@@ -217,20 +328,23 @@ static bool accumulate(utf8_nchar *dest,unsigned int codepoint) {
         return true;
 }
 
-static json_in eat_char(json_in s,int max,utf8_nchar *build) {
+static json_in eat_char(json_in s,json_in end,utf8_nchar *build) {
         json_in q;
         unsigned int hexval;
+        long hex;
 
-        if (max<1) return NULL;
+        if (s>=end) return NULL;
         if (*s!='\\') {
-                accumulate(build,*s);
+                /* raw bytes, including UTF-8, go through as they are */
+                if (build) append(build,*s);
                 return s+1;
         }
         /* control characters */
-        if (max<=2) return NULL;
+        if (end-s<2) return NULL;
         s++;
         q=s+1;
         switch(*s) {
+        case '\"': /* fall through */
         case '\\': /* fall through */
         case '/': accumulate(build,*s); break;
 
@@ -241,9 +355,9 @@ static json_in eat_char(json_in s,int max,utf8_nchar *build) {
         case 't': accumulate(build,'\t'); break;
 
         case 'u':
-                if (max<6) return NULL;
-                q=eat_hex(q,4,&hexval);
-                if (!q) break;
+                if (end-q<4 || (hex=hex4(q))<0) return NULL;
+                hexval=hex;
+                q=low_surrogate(q+4,end,&hexval);
                 accumulate(build,hexval);
                 break;
         case '\0':
@@ -254,167 +368,125 @@ static json_in eat_char(json_in s,int max,utf8_nchar *build) {
         return q;
 }
 
-static json_in eat_string(ctx *c,json_in s,json_nchar *str,utf8_nchar *build) {
-        json_in p,q;
+static json_in eat_string(ctx *c,json_in s,json_in end,json_nchar *str,utf8_nchar *build) {
+        json_in p,q,high,bad;
         const char *err=NULL;
+        bool utf8=c && (getsuperelement(c)->callbacks.options & json_option_validate_utf8);
 
-        if (*s!='\"') return NULL;
+        if (peek(s,end)!='\"') return NULL;
         if (c) c->value.type=json_type_string;
         str->s = s+1;
-        for(p=str->s;*p;p=q) {
+        for(p=str->s;;p=q) {
+                /* skip the run of plain characters in one go */
+                if (!utf8) q=json_scan_string(p,end);
+                else {
+                        /* only runs that are not all ASCII need checking;
+                         * characters cannot span the ASCII that ends a run
+                         */
+                        high=NULL;
+                        q=json_scan_string_high(p,end,&high);
+                        if (high && (bad=json_scan_utf8(high,q))!=q) {p=bad; err=GETTEXT("invalid UTF-8"); break;}
+                }
+                if (build) for(;p<q;p++) append(build,*p);
+                p=q;
+                if (p>=end) break;
                 if (*p=='\"') {str->n = p - str->s; return p+1;}
-                q=eat_char(p,16,build);
+                if (c && *p=='\\') STATS(getsuperelement(c),stats->escapes++);
+                q=eat_char(p,end,build);
                 if (!q) {err=GETTEXT("invalid control sequence"); break;}
         }
         if (!err) err=GETTEXT("no closing quote");
         return not_thing(c,GETTEXT("string"),s,p,err);
 }
 
-static json_in eat_digits(json_in s,double *v,int *digits) {
-        json_in p;
-        for(p=s;*p>='0' && *p<='9';p++) {
-                *v=(*v * 10) + (*p-'0');
-                (*digits)++;
+/* Set v to the number [s,p) scanned into d, as the options ask. */
+static void number_value(json_value *v,const json_decimal *d,json_in s,json_in p,int options) {
+        if ((options & json_option_integers) && json_decimal_to_int64(d,&v->integer)) {
+                v->type=json_type_integer;
+                return;
         }
-        return p;
-}
-
-static double power10(int exp) {
-        double base,bbase;
-        double r=1.0;
-        int bb=0;
-
-        if (exp<0) {base=0.1; exp=-exp;}
-        else base=10.0;
-
-        bbase=base;
-        bb=1;
-        while(exp>0) {
-                if (exp <= bb) {
-                        bb=1;
-                        bbase=base;
-                }
-                else {
-                        bbase*=base;
-                        bb++;
-                        continue;
-                }
-                r*=bbase;
-                exp-=bb;
+        v->type=json_type_number;
+        v->lazy=(options & json_option_lazy_numbers)?true:false;
+        if (v->lazy) {
+                v->lexeme.s=s;
+                v->lexeme.n=p-s;
         }
-        return r;
+        else v->number=json_decimal_to_double(d,s,p);
 }
 
-static json_in eat_number(ctx *c,json_in s) {
-        json_in p;
-        bool neg=false;
-        int d=0;
-        p=s;
-        c->value.number=0.0;
-        if (*p=='-') {p++; neg=true;}
-        if (*p=='0') p++;
-        else {
-                p=eat_digits(p,&c->value.number,&d);
-                if (d==0) return NULL;
-        }
-
-        if (*p=='.') {
-                int d=0;
-                double f=0;
-                p++;
-                p=eat_digits(p,&f,&d);
-                f*=power10(-d);
-                c->value.number+=f;
-        }
-
-        if (*p=='e' || *p=='E') {
-                double pos=0,neg=0,*exp;
-                int d=0;
-                p++;
-                if (*p=='-') {p++; exp=&neg;}
-                else if (*p=='+') {p++; exp=&pos;}
-                else exp=&pos;
-                p=eat_digits(p,exp,&d);
-                if (d==0) return not_thing(c,GETTEXT("number"),s,p,GETTEXT("bad exponent"));
-                c->value.number *= power10(pos-neg);
-        }
+static json_in eat_number(ctx *c,json_in s,json_in end) {
+        superelement *super=getsuperelement(c);
+        json_decimal d;
+        json_in p=json_scan_number(s,end,&d);
 
-        if (neg) c->value.number = -c->value.number;
-        c->value.type=json_type_number;
+        if (!p) return NULL;
+        if (d.badexp) return not_thing(c,GETTEXT("number"),s,p,GETTEXT("bad exponent"));
+        number_value(&c->value,&d,s,p,super->callbacks.options);
+        STATS(super,if (c->value.type==json_type_integer || !c->value.lazy) stats->numbers++);
         return p;
 }
 
-static json_in eat_bool(ctx *c,json_in p) {
-        json_in q;
-        do {
-                q=startswith("true",p);
-                if (q) {c->value.truefalse=true; break;}
-                q=startswith("false",p);
-                if (q) {c->value.truefalse=false; break;}
-                return NULL;
-        } while(0);
+static json_in eat_bool(ctx *c,json_in p,json_in end) {
+        bool t=(peek(p,end)=='t');
+        json_in q=(t)?literal("true",4,p,end):literal("false",5,p,end);
+        if (!q) return NULL;
         c->value.type=json_type_bool;
+        c->value.truefalse=t;
         return q;
 }
 
-static json_in eat_null(ctx *c,json_in p) {
-        json_in q;
-        q=startswith("null",p);
+static json_in eat_null(ctx *c,json_in p,json_in end) {
+        json_in q=literal("null",4,p,end);
         if (q) c->value.type=json_type_null;
         return q;
 }
 
-static json_in get_value(ctx *c,json_in s) {
+static json_in get_value(ctx *c,json_in s,json_in end) {
         json_in p,q;
 
-        p=eat_whitespace(s);
+        p=eat_whitespace(s,end);
 
-        if (*p=='{') {
+        switch(first_byte[(unsigned char)peek(p,end)]) {
+        case L_OBJECT:
                 c->value.type=json_type_object;
                 c->value.object=p;
                 return p;
-        }
-
-        if (*p=='[') {
+        case L_ARRAY:
                 c->value.type=json_type_array;
                 c->value.array=p;
                 return p;
+        case L_STRING: q=eat_string(c,p,end,&c->value.string,NULL); break;
+        case L_NUMBER: q=eat_number(c,p,end); break;
+        case L_BOOL:   q=eat_bool(c,p,end); break;
+        case L_NULL:   q=eat_null(c,p,end); break;
+        default:       q=NULL; break;
         }
-
-        q=eat_string(c,p,&c->value.string,NULL);
-        if (q) return eat_whitespace(q);
-
-        q=eat_number(c,p);
-        if (q) return eat_whitespace(q);
-
-        q=eat_bool(c,p);
-        if (q) return eat_whitespace(q);
-
-        q=eat_null(c,p);
-        if (q) return eat_whitespace(q);
+        if (q) return eat_whitespace(q,end);
 
         return not_thing(c,GETTEXT("value"),s,p,GETTEXT("invalid value"));
 }
 
-static json_in eat_array(ctx *vc,json_in s) {
+static json_in eat_array(ctx *vc,json_in s,json_in end) {
         json_in p=s;
         ctx c={};
         const char *err=NULL;
 
-        if (*p!='[') return NULL;
+        if (peek(p,end)!='[') return NULL;
         p++;
         c.prev=vc;
+        c.root=(vc)?vc->root:&c;
         c.name.s=NULL;
         c.name.n=0;
-        p=eat_whitespace(p);
-        if (*p==']') return p+1;
+        p=eat_whitespace(p,end);
+        if (peek(p,end)==']') return p+1;
         if (vc) vc->next=&c;
         for(c.index=0;;c.index++) {
-                p=get_value(&c,p);
+                p=get_value(&c,p,end);
                 if (!p) {err=GETTEXT("bad value"); break;}
-                p=got_value(&c,p);
-                if (*p==']') break;
-                if (*p!=',') {err=GETTEXT("comma or bracket missing"); break;}
+                p=got_value(&c,p,end);
+                if (!p) {err=GETTEXT("bad array value"); break;}
+                if (peek(p,end)==']') break;
+                if (peek(p,end)!=',') {err=GETTEXT("comma or bracket missing"); break;}
                 p++;
         }
         if (err) return not_thing(&c,GETTEXT("array"),s,p,err);
@@ -422,76 +494,1071 @@ static json_in eat_array(ctx *vc,json_in s) {
         return p+1;
 }
 
-static json_in eat_object(ctx *vc,json_in s) {
+static json_in eat_object(ctx *vc,json_in s,json_in end) {
         json_in p=s,q;
         ctx c={};
         const char *err=NULL;
 
-        if (*p!='{') return NULL;
+        if (peek(p,end)!='{') return NULL;
         p++;
         c.prev=vc;
+        c.root=(vc)?vc->root:&c;
         c.index=0;
-        p=eat_whitespace(p);
-        if (*p=='}') return p+1;
+        p=eat_whitespace(p,end);
+        if (peek(p,end)=='}') return p+1;
         if (vc) vc->next=&c;
         for(;;) {
-                if (!*p) {err=GETTEXT("closure missing"); break;}
-                q=eat_string(&c,p,&c.name,NULL);
+                if (p>=end) {err=GETTEXT("closure missing"); break;}
+                q=eat_string(&c,p,end,&c.name,NULL);
                 if (!q) {err=GETTEXT("bad name"); break;}
-                p=eat_whitespace(q);
-                if (*p!=':') {err=GETTEXT("colon missing"); break;}
+                name_key(&c);
+                p=eat_whitespace(q,end);
+                if (peek(p,end)!=':') {err=GETTEXT("colon missing"); break;}
                 p++;
-                q=get_value(&c,p);
+                q=get_value(&c,p,end);
                 if (!q) {err=GETTEXT("bad value"); break;}
-                p=got_value(&c,q);
+                p=got_value(&c,q,end);
                 if (!p) {err=GETTEXT("bad object value"); break;}
-                if (*p=='}') break;
+                if (peek(p,end)=='}') break;
 
-                if (*p!=',') {err=GETTEXT("comma or brace missing"); break;}
+                if (peek(p,end)!=',') {err=GETTEXT("comma or brace missing"); break;}
                 p++;
-                p=eat_whitespace(p);
+                p=eat_whitespace(p,end);
         }
         if (err) return not_thing(&c,GETTEXT("object"),s,p,err);
         if (vc) vc->next=NULL;
         return p+1;
 }
 
-static json_in got_value(ctx *c,json_in s) {
-        switch(c->value.type) {
-        case json_type_object: return eat_whitespace(eat_object(c,s));
-        case json_type_array: return eat_whitespace(eat_array(c,s));
-        default: break;
+/* -- events common to both parsers -- */
+
+static bool emit_value(superelement *super,ctx *c) {
+        const json_callbacks *cb=&super->callbacks;
+        STATS(super,stats->values[c->value.type]++);
+        if (cb->queries) {
+                if (!json_query_value(cb->queries,&super->root,c,&super->stopped)) return false;
+                if ((cb->options & json_option_stop_when_found) && json_query_done(cb->queries)) super->stopped=true;
+                if (super->stopped) return true;
         }
+        CALLBACK(super,cb->got_value(&super->root,&c->value,cb->context));
+        return true;
+}
 
-        superelement *super=getsuperelement(c);
+static bool open_container(superelement *super,ctx *c) {
         const json_callbacks *cb=&super->callbacks;
-        cb->got_value(&super->root,&c->value,cb->context);
-        return s;
+        void (*fn)(const json_valuecontext *,json_in,void *);
+        STATS(super,
+                stats->values[c->value.type]++;
+                if (++stats->depth>stats->maxdepth) stats->maxdepth=stats->depth);
+        if (cb->queries && !json_query_enter(cb->queries,c)) return false;
+        fn=(c->value.type==json_type_object)?cb->begin_object:cb->begin_array;
+        if (fn) CALLBACK(super,fn(&super->root,c->value.object,cb->context));
+        return true;
+}
+
+/* Returns true if the user wants to pass over the container. */
+static bool skip_wanted(superelement *super,ctx *c) {
+        const json_callbacks *cb=&super->callbacks;
+        json_action a=json_action_descend;
+        if (cb->enter) CALLBACK(super,a=cb->enter(&super->root,&c->value,cb->context));
+        if (a==json_action_stop) super->stopped=true;
+        return a!=json_action_descend;
+}
+
+/* After calling back: true, noting p as where, if the parse was stopped. */
+static inline bool stopping(superelement *super,json_in p) {
+        if (!super->stopped) return false;
+        if (!super->stop) super->stop=p;
+        return true;
+}
+
+/* end is just past the closing bracket */
+static void close_container(superelement *super,ctx *c,json_in end) {
+        const json_callbacks *cb=&super->callbacks;
+        void (*fn)(const json_valuecontext *,json_in,json_in,void *);
+        STATS(super,stats->depth--);
+        fn=(c->value.type==json_type_object)?cb->end_object:cb->end_array;
+        if (fn) CALLBACK(super,fn(&super->root,c->value.object,end,cb->context));
+        if (cb->queries) json_query_leave(cb->queries,&super->root);
+}
+
+/* Pass over the container at s, without looking inside strings or
+ * numbers, linking contexts or calling back.
+ */
+static json_in skip_container(ctx *c,json_in s,json_in end) {
+        int depth=0;
+        bool string=false,escape=false;
+        json_in p=json_scan_skip(s,end,&depth,&string,&escape);
+        if (depth) return not_thing(c,(*s=='{')?GETTEXT("object"):GETTEXT("array"),s,p,GETTEXT("closure missing"));
+        return p;
+}
+
+static json_in got_value(ctx *c,json_in s,json_in end) {
+        superelement *super=getsuperelement(c);
+        json_in p;
+
+        switch(c->value.type) {
+        case json_type_object:
+        case json_type_array:
+                if (skip_wanted(super,c)) {
+                        if (stopping(super,s)) return NULL;
+                        return eat_whitespace(skip_container(c,s,end),end);
+                }
+                if (!open_container(super,c)) break;
+                if (stopping(super,s)) return NULL;
+                if (c->value.type==json_type_object) p=eat_object(c,s,end);
+                else p=eat_array(c,s,end);
+                if (p) {
+                        close_container(super,c,p);
+                        if (stopping(super,p)) return NULL;
+                }
+                return eat_whitespace(p,end);
+        default:
+                if (!emit_value(super,c)) break;
+                if (stopping(super,s)) return NULL;
+                return s;
+        }
+        return not_thing(c,GETTEXT("value"),s,s,GETTEXT("too many query states"));
+}
+
+static void setup(superelement *super,const json_callbacks *ucb) {
+        if (ucb) super->callbacks=*ucb;
+        if (!super->callbacks.got_value)
+                super->callbacks.got_value=(super->callbacks.queries)?ignore_value:default_got_value;
+        if (!super->callbacks.error)     super->callbacks.error=default_error;
+        super->root.name.s="";
+        super->root.name.n=0;
+        super->root.root=&super->root;
+        STATS(super,stats->depth=0);
 }
 
 const char *json_parse(const json_callbacks *ucb,const char *s) {
-        superelement super={};
         if (!s) return NULL;
-        if (ucb) super.callbacks=*ucb;
-        if (!super.callbacks.got_value) super.callbacks.got_value=default_got_value;
-        if (!super.callbacks.error)     super.callbacks.error=default_error;
-        super.root.name.s="";
-        super.root.name.n=0;
-        super.string=s;
+        return json_parse_n(ucb,s,strlen(s));
+}
 
+static json_in parse_text(superelement *super,json_in s,json_in end) {
         json_in p;
         const char *err=NULL;
-        ctx *c=&super.root;
+        ctx *c=&super->root;
         do {
-                p=get_value(c,s);
+                p=get_value(c,s,end);
                 if (!p) {err=GETTEXT("bad string"); break;}
-                p=got_value(c,p);
+                p=got_value(c,p,end);
                 if (!p) {err=GETTEXT("cannot parse string"); break;}
         } while(0);
         if (err) return not_thing(c,GETTEXT("JSON"),p,p,err);
         return p;
 }
 
+static json_in parse_whole(superelement *super,const json_callbacks *ucb,json_in s,size_t len) {
+        stats_mark m;
+        json_in p;
+        setup(super,ucb);
+        super->string=s;
+        super->end=s+len;
+        m=stats_begin(super,len);
+        p=parse_text(super,s,super->end);
+        stats_end(super,m);
+        return (super->stopped)?super->stop:p;
+}
+
+const char *json_parse_n(const json_callbacks *ucb,const char *s,size_t len) {
+        superelement super={};
+        if (!s) return NULL;
+        return parse_whole(&super,ucb,s,len);
+}
+
+json_status json_parse_status(const json_callbacks *ucb,const char *s,size_t len,const char **end) {
+        superelement super={};
+        json_in p=(s)?parse_whole(&super,ucb,s,len):NULL;
+        if (end) *end=p;
+        if (super.stopped) return json_status_stopped;
+        return (p)?json_status_done:json_status_error;
+}
+
+bool json_parse_record(const json_callbacks *ucb,const char *s,size_t len,size_t record,int worker) {
+        superelement super={};
+        json_in p;
+        setup(&super,ucb);
+        stats_off(&super);
+        super.string=s;
+        super.end=s+len;
+        super.record=record;
+        super.worker=worker;
+        p=parse_text(&super,s,super.end);
+        if (super.stopped) return true;
+        if (!p) return false;
+        if (p<super.end) {
+                not_thing(&super.root,GETTEXT("JSON"),p,p,GETTEXT("junk after value"));
+                return false;
+        }
+        return true;
+}
+
+bool json_parse_array_with(const json_callbacks *ucb,const char *s,const char *end,
+        bool (*contents)(json_parser *jp,void *arg),void *arg) {
+        superelement super={};
+        ctx *c=&super.root;
+        json_in p;
+
+        setup(&super,ucb);
+        stats_off(&super);
+        super.string=s;
+        super.end=end;
+        c->value.type=json_type_array;
+        c->value.array=s;
+        if (skip_wanted(&super,c)) {
+                if (super.stopped) return true;
+                p=skip_container(c,s,end);
+                return p==end;
+        }
+        if (!open_container(&super,c)) {
+                not_thing(c,GETTEXT("array"),s,s,GETTEXT("too many query states"));
+                return false;
+        }
+        if (super.stopped) return true;
+        if (!contents(&super,arg)) return false;
+        close_container(&super,c,end);
+        return true;
+}
+
+bool json_parse_elements(const json_callbacks *ucb,const char *array,const char *s,const char *end,
+        int index,int worker) {
+        superelement super={};
+        ctx *root=&super.root,c={};
+        json_in p=s;
+        const char *err=NULL;
+
+        setup(&super,ucb);
+        stats_off(&super);
+        super.string=s;
+        super.end=end;
+        super.worker=worker;
+        root->value.type=json_type_array;
+        root->value.array=array;
+        c.prev=root;
+        c.root=root;
+        root->next=&c;
+        for(c.index=index;;c.index++) {
+                p=get_value(&c,p,end);
+                if (!p) {err=GETTEXT("bad value"); break;}
+                p=got_value(&c,p,end);
+                if (!p) {err=GETTEXT("bad array value"); break;}
+                if (p>=end) break;
+                if (*p!=',') {err=GETTEXT("comma or bracket missing"); break;}
+                p++;
+        }
+        root->next=NULL;
+        if (err && !super.stopped) {
+                not_thing(&c,GETTEXT("array"),s,p,err);
+                return false;
+        }
+        return true;
+}
+
+/* -- resumable parser -- */
+
+/* The resumable parser keeps the context chain in the caller's stack
+ * array, so needs to remember only what it expects next.  Each token is
+ * passed to the eat_* routines above once its end has been seen; tokens
+ * split across chunks are first gathered in the caller's buffer.
+ */
+
+enum {
+        S_START,          /* nothing yet */
+        S_VALUE,          /* a value */
+        S_VALUE_OR_CLOSE, /* the first array value, or ']' */
+        S_NAME,           /* an object name */
+        S_NAME_OR_CLOSE,  /* the first object name, or '}' */
+        S_COLON,          /* ':' after a name */
+        S_NEXT,           /* ',' or the end of the container */
+        S_DONE,           /* a complete text */
+        S_STRING,         /* inside a string value */
+        S_KEY,            /* inside an object name */
+        S_NUMBER,         /* inside a number */
+        S_LITERAL,        /* inside true, false or null */
+        S_SKIP,           /* inside a skipped object or array */
+        S_ERROR,          /* gave up */
+        S_STOPPED,        /* stopped by the caller */
+};
+
+static ctx *stream_ctx(json_parser *jp) {
+        return (jp->depth>0)?&jp->stack[jp->depth-1]:&jp->root;
+}
+
+static bool stream_fail(json_parser *jp,const char *thing,json_in s,json_in p,const char *msg) {
+        not_thing(stream_ctx(jp),thing,s,p,msg);
+        jp->state=S_ERROR;
+        return false;
+}
+
+static void stream_after_value(json_parser *jp) {
+        jp->state=(jp->depth>0)?S_NEXT:S_DONE;
+}
+
+static bool stream_push(json_parser *jp,json_in p) {
+        ctx *c=stream_ctx(jp),*n;
+
+        if (*p=='{') {
+                c->value.type=json_type_object;
+                c->value.object=p;
+                jp->state=S_NAME_OR_CLOSE;
+        }
+        else {
+                c->value.type=json_type_array;
+                c->value.array=p;
+                jp->state=S_VALUE_OR_CLOSE;
+        }
+        if (skip_wanted(jp,c)) {
+                /* p is the opening bracket */
+                jp->state=S_SKIP;
+                jp->skipdepth=1;
+                jp->skipstring=jp->escape=false;
+                return true;
+        }
+        if (jp->depth>=jp->maxdepth) return stream_fail(jp,GETTEXT("value"),p,p,GETTEXT("nested too deeply"));
+        if (!open_container(jp,c)) return stream_fail(jp,GETTEXT("value"),p,p,GETTEXT("too many query states"));
+        n=&jp->stack[jp->depth++];
+        memset(n,0,sizeof(*n));
+        n->prev=c;
+        n->root=c->root;
+        c->next=n;
+        return true;
+}
+
+static bool stream_pop(json_parser *jp,json_in p) {
+        ctx *c=stream_ctx(jp);
+        bool object=(c->prev->value.type==json_type_object);
+
+        if (*p!=(object?'}':']')) {
+                if (object) return stream_fail(jp,GETTEXT("object"),p,p,GETTEXT("comma or brace missing"));
+                return stream_fail(jp,GETTEXT("array"),p,p,GETTEXT("comma or bracket missing"));
+        }
+        /* forget this level's name */
+        if (c->name.s && !jp->whole) jp->keys=jp->used=c->name.s-1-jp->buf;
+        c->prev->next=NULL;
+        jp->depth--;
+        close_container(jp,c->prev,p+1);
+        stream_after_value(jp);
+        return true;
+}
+
+static bool stream_start_value(json_parser *jp,json_in p) {
+        switch(first_byte[(unsigned char)*p]) {
+        case L_OBJECT:
+        case L_ARRAY:
+                return stream_push(jp,p);
+        case L_STRING:
+                jp->state=S_STRING;
+                break;
+        case L_BOOL:
+        case L_NULL:
+                jp->state=S_LITERAL;
+                break;
+        case L_NUMBER:
+                jp->state=S_NUMBER;
+                break;
+        default:
+                return stream_fail(jp,GETTEXT("value"),p,p,GETTEXT("invalid value"));
+        }
+        jp->token=p;
+        return true;
+}
+
+/* Keep the unfinished token [s,end) for the next chunk. */
+static bool stream_save(json_parser *jp,json_in s,json_in end) {
+        size_t n=end-s;
+        if (n > jp->buflen-jp->used) return stream_fail(jp,GETTEXT("value"),s,s,GETTEXT("token too long"));
+        memcpy(jp->buf+jp->used,s,n);
+        jp->used+=n;
+        jp->token=NULL;
+        return true;
+}
+
+/* Complete the value token [s,e). */
+static bool stream_value(json_parser *jp,json_in s,json_in e) {
+        ctx *c=stream_ctx(jp);
+        json_in q;
+
+        switch(first_byte[(unsigned char)*s]) {
+        case L_STRING: q=eat_string(c,s,e,&c->value.string,NULL); break;
+        case L_NULL:   q=eat_null(c,s,e); break;
+        case L_BOOL:   q=eat_bool(c,s,e); break;
+        default:       q=eat_number(c,s,e); break;
+        }
+        if (q!=e) return stream_fail(jp,GETTEXT("value"),s,(q)?q:s,GETTEXT("invalid value"));
+        if (!emit_value(jp,c)) return stream_fail(jp,GETTEXT("value"),s,s,GETTEXT("too many query states"));
+        stream_after_value(jp);
+        return true;
+}
+
+/* Complete the name token [s,e), keeping a copy in the buffer. */
+static bool stream_name(json_parser *jp,json_in s,json_in e) {
+        ctx *c=stream_ctx(jp);
+        json_nchar name;
+        size_t n=e-s;
+
+        if (eat_string(c,s,e,&name,NULL)!=e) return stream_fail(jp,GETTEXT("object"),s,s,GETTEXT("bad name"));
+        if (jp->whole) {
+                /* the text stays put */
+                c->name=name;
+                name_key(c);
+                jp->state=S_COLON;
+                return true;
+        }
+        /* replace the previous name at this level */
+        if (c->name.s) jp->keys=c->name.s-1-jp->buf;
+        if (n > jp->buflen-jp->keys) return stream_fail(jp,GETTEXT("object"),s,s,GETTEXT("name too long"));
+        memmove(jp->buf+jp->keys,s,n);
+        c->name.s=jp->buf+jp->keys+1;
+        c->name.n=n-2;
+        name_key(c);
+        jp->keys+=n;
+        jp->used=jp->keys;
+        jp->state=S_COLON;
+        return true;
+}
+
+/* The current token ends just before p. */
+static bool stream_token(json_parser *jp,json_in p) {
+        json_in s,e;
+
+        if (jp->token) {
+                s=jp->token;
+                e=p;
+        }
+        else {
+                /* gather the rest of a split token (p is NULL when finishing) */
+                if (p && !stream_save(jp,jp->string,p)) return false;
+                s=jp->buf+jp->keys;
+                e=jp->buf+jp->used;
+        }
+        jp->token=NULL;
+        jp->used=jp->keys;
+        if (jp->state==S_KEY) return stream_name(jp,s,e);
+        return stream_value(jp,s,e);
+}
+
+/* Returns the end of the string starting at or before p, or end. */
+static json_in stream_string(json_parser *jp,json_in p,json_in end) {
+        if (jp->escape) {
+                /* the previous chunk ended with a backslash */
+                jp->escape=false;
+                p++;
+        }
+        for(;;) {
+                p=json_scan_string(p,end);
+                if (p>=end) return end;
+                if (*p=='\"') return p;
+                if (*p=='\\') {
+                        if (end-p<2) {jp->escape=true; return end;}
+                        p+=2;
+                }
+                else p++; /* raw control character */
+        }
+}
+
+static bool number_char(char x) {
+        return (x>='0' && x<='9') || x=='-' || x=='+' || x=='.' || x=='e' || x=='E';
+}
+
+void json_parser_init(json_parser *jp,const json_callbacks *ucb,
+        json_valuecontext *stack,int maxdepth,char *buf,size_t buflen) {
+        memset(jp,0,sizeof(*jp));
+        setup(jp,ucb);
+        jp->stack=stack;
+        jp->maxdepth=(stack)?maxdepth:0;
+        jp->buf=buf;
+        jp->buflen=(buf)?buflen:0;
+        jp->state=S_START;
+}
+
+/* Parse [chunk,end).  Returns NULL on error, or where parsing stopped:
+ * end, or (for a whole text) just after the first complete value.
+ */
+static json_in stream_run(json_parser *jp,json_in chunk,json_in end) {
+        json_in p=chunk,q;
+        ctx *c;
+        bool ok=true;
+
+        if (jp->state==S_ERROR || jp->state==S_STOPPED) return NULL;
+        jp->string=chunk;
+        jp->end=end;
+        if (!jp->whole) {
+                /* containers that began in an earlier chunk */
+                for(c=&jp->root;c!=stream_ctx(jp);c=c->next) c->value.object=NULL;
+        }
+        while(ok && p<end && !jp->stopped) {
+                switch(jp->state) {
+                case S_STRING:
+                case S_KEY:
+                        q=stream_string(jp,(jp->token)?p+1:p,end);
+                        if (q<end) q++; /* past the closing quote */
+                        else if (!jp->whole) return (stream_save(jp,(jp->token)?jp->token:chunk,end))?end:NULL;
+                        ok=stream_token(jp,q);
+                        p=q;
+                        continue;
+                case S_NUMBER:
+                case S_LITERAL:
+                        q=(jp->token)?p+1:p;
+                        if (jp->state==S_NUMBER) while(q<end && number_char(*q)) q++;
+                        else while(q<end && *q>='a' && *q<='z') q++;
+                        if (q>=end && !jp->whole) return (stream_save(jp,(jp->token)?jp->token:chunk,end))?end:NULL;
+                        ok=stream_token(jp,q);
+                        p=q;
+                        continue;
+                case S_SKIP:
+                        q=json_scan_skip(p,end,&jp->skipdepth,&jp->skipstring,&jp->escape);
+                        if (jp->skipdepth) return end;
+                        stream_after_value(jp);
+                        p=q;
+                        continue;
+                case S_DONE:
+                        if (jp->whole) return eat_whitespace(p,end);
+                        break;
+                default:
+                        break;
+                }
+
+                p=eat_whitespace(p,end);
+                if (p>=end) break;
+                switch(jp->state) {
+                case S_VALUE_OR_CLOSE:
+                        if (*p==']') {ok=stream_pop(jp,p); break;}
+                        /* fall through */
+                case S_START:
+                case S_VALUE:
+                case S_DONE:
+                        ok=stream_start_value(jp,p);
+                        if (jp->token) continue; /* token starts at p */
+                        break;
+                case S_NAME_OR_CLOSE:
+                        if (*p=='}') {ok=stream_pop(jp,p); break;}
+                        /* fall through */
+                case S_NAME:
+                        if (*p!='\"') {ok=stream_fail(jp,GETTEXT("object"),p,p,GETTEXT("bad name")); break;}
+                        jp->state=S_KEY;
+                        jp->token=p;
+                        continue;
+                case S_COLON:
+                        if (*p!=':') {ok=stream_fail(jp,GETTEXT("object"),p,p,GETTEXT("colon missing")); break;}
+                        jp->state=S_VALUE;
+                        break;
+                case S_NEXT:
+                        if (*p!=',') {ok=stream_pop(jp,p); break;}
+                        c=stream_ctx(jp);
+                        if (c->prev->value.type==json_type_object) jp->state=S_NAME;
+                        else {
+                                c->index++;
+                                jp->state=S_VALUE;
+                        }
+                        break;
+                }
+                p++;
+        }
+        if (jp->stopped) {
+                jp->state=S_STOPPED;
+                jp->stop=p;
+        }
+        return (ok)?p:NULL;
+}
+
+bool json_parser_feed(json_parser *jp,const char *chunk,size_t len) {
+        stats_mark m=stats_begin(jp,len);
+        json_in p=stream_run(jp,chunk,chunk+len);
+        stats_end(jp,m);
+        return p!=NULL && !jp->stopped;
+}
+
+bool json_parser_stopped(const json_parser *jp) {
+        return jp->stopped;
+}
+
+const char *json_parse_stack(const json_callbacks *ucb,const char *s,size_t len,
+        json_valuecontext *stack,int maxdepth) {
+        json_parser jp;
+        stats_mark m;
+        json_in p;
+
+        if (!s) return NULL;
+        json_parser_init(&jp,ucb,stack,maxdepth,NULL,0);
+        jp.whole=true;
+        m=stats_begin(&jp,len);
+        p=stream_run(&jp,s,s+len);
+        stats_end(&jp,m);
+        if (!p) return NULL;
+        if (jp.stopped) return jp.stop;
+        if (jp.state!=S_DONE && !json_parser_finish(&jp)) return NULL;
+        return p;
+}
+
+bool json_parser_finish(json_parser *jp) {
+        ctx *c=stream_ctx(jp);
+        const char *err;
+
+        /* the last chunk may be gone */
+        if (!jp->whole) jp->string=jp->end=NULL;
+        switch(jp->state) {
+        case S_ERROR:
+                return false;
+        case S_STOPPED:
+                return true;
+        case S_NUMBER:
+        case S_LITERAL:
+                if (!stream_token(jp,NULL)) return false;
+                if (jp->stopped) jp->state=S_STOPPED;
+                if (jp->state==S_DONE || jp->state==S_STOPPED) return true;
+                c=stream_ctx(jp);
+                err=GETTEXT("closure missing");
+                break;
+        case S_DONE:
+                return true;
+        case S_START:
+                err=GETTEXT("no value");
+                break;
+        case S_STRING:
+        case S_KEY:
+                err=GETTEXT("no closing quote");
+                break;
+        default:
+                err=GETTEXT("closure missing");
+                break;
+        }
+        not_thing(c,GETTEXT("JSON"),NULL,NULL,err);
+        jp->state=S_ERROR;
+        return false;
+}
+
+/* -- pull reader -- */
+
+/* The reader uses the resumable parser's contexts and states, but steps
+ * through a whole text itself, returning at each event.  A container's
+ * context is only linked to the next level once its first name or value
+ * is read, so that begin and end events see the chain the callbacks do;
+ * later elements reuse the same link.
+ */
+
+void json_reader_init(json_reader *r,const json_callbacks *ucb,const char *s,size_t len,
+        json_valuecontext *stack,int maxdepth) {
+        json_parser_init(&r->parser,ucb,stack,maxdepth,NULL,0);
+        r->parser.whole=true;
+        r->parser.string=s;
+        r->parser.end=s+len;
+        r->next=s;
+}
+
+static bool read_fail(json_reader *r,json_event *e,const char *thing,json_in p,const char *msg) {
+        stream_fail(&r->parser,thing,p,p,msg);
+        e->type=json_event_error;
+        e->at=p;
+        return false;
+}
+
+/* Open the container at p, which is the value of c. */
+static bool read_push(json_reader *r,json_event *e,ctx *c,json_in p) {
+        json_parser *jp=&r->parser;
+        ctx *n;
+
+        if (jp->depth>=jp->maxdepth) return read_fail(r,e,GETTEXT("value"),p,GETTEXT("nested too deeply"));
+        if (*p=='{') {
+                c->value.type=json_type_object;
+                c->value.object=p;
+                jp->state=S_NAME_OR_CLOSE;
+                e->type=json_event_begin_object;
+        }
+        else {
+                c->value.type=json_type_array;
+                c->value.array=p;
+                jp->state=S_VALUE_OR_CLOSE;
+                e->type=json_event_begin_array;
+        }
+        n=&jp->stack[jp->depth++];
+        memset(n,0,sizeof(*n));
+        n->prev=c;
+        n->root=c->root;
+        e->at=p;
+        r->next=p+1;
+        return true;
+}
+
+/* Close the container at p. */
+static bool read_pop(json_reader *r,json_event *e,json_in p) {
+        json_parser *jp=&r->parser;
+        ctx *c=stream_ctx(jp);
+        bool object=(c->prev->value.type==json_type_object);
+
+        if (*p!=(object?'}':']')) {
+                if (object) return read_fail(r,e,GETTEXT("object"),p,GETTEXT("comma or brace missing"));
+                return read_fail(r,e,GETTEXT("array"),p,GETTEXT("comma or bracket missing"));
+        }
+        c->prev->next=NULL;
+        jp->depth--;
+        stream_after_value(jp);
+        e->type=(object)?json_event_end_object:json_event_end_array;
+        e->depth=jp->depth;
+        e->element=c->prev;
+        e->at=p;
+        r->next=p+1;
+        return true;
+}
+
+bool json_next(json_reader *r,json_event *e) {
+        json_parser *jp=&r->parser;
+        json_in end=jp->end,p=eat_whitespace(r->next,end),q;
+        ctx *c=stream_ctx(jp);
+        int state=jp->state;
+
+        e->path=&jp->root;
+        if (p>=end && state!=S_DONE && state!=S_ERROR)
+                return read_fail(r,e,GETTEXT("JSON"),p,(state==S_START)?GETTEXT("no value"):GETTEXT("closure missing"));
+        switch(state) {
+        case S_NEXT:
+                if (*p!=',') return read_pop(r,e,p);
+                p=eat_whitespace(p+1,end);
+                if (c->prev->value.type!=json_type_object) {
+                        c->index++;
+                        goto value;
+                }
+                /* fall through */
+        case S_NAME:
+        name:
+                e->at=p;
+                q=eat_string(c,p,end,&c->name,NULL);
+                if (!q) return read_fail(r,e,GETTEXT("object"),p,GETTEXT("bad name"));
+                name_key(c);
+                p=eat_whitespace(q,end);
+                if (peek(p,end)!=':') return read_fail(r,e,GETTEXT("object"),p,GETTEXT("colon missing"));
+                jp->state=S_VALUE;
+                e->type=json_event_key;
+                e->depth=jp->depth;
+                e->element=c;
+                r->next=p+1;
+                return true;
+        case S_NAME_OR_CLOSE:
+                if (*p=='}') return read_pop(r,e,p);
+                c->prev->next=c;
+                goto name;
+        case S_VALUE_OR_CLOSE:
+                if (*p==']') return read_pop(r,e,p);
+                c->prev->next=c;
+                /* fall through */
+        case S_START:
+        case S_VALUE:
+        value:
+                e->depth=jp->depth;
+                e->element=c;
+                e->at=p;
+                switch(first_byte[(unsigned char)peek(p,end)]) {
+                case L_OBJECT:
+                case L_ARRAY:  return read_push(r,e,c,p);
+                case L_STRING: q=eat_string(c,p,end,&c->value.string,NULL); break;
+                case L_NUMBER: q=eat_number(c,p,end); break;
+                case L_BOOL:   q=eat_bool(c,p,end); break;
+                case L_NULL:   q=eat_null(c,p,end); break;
+                default:       q=NULL; break;
+                }
+                if (!q) return read_fail(r,e,GETTEXT("value"),p,GETTEXT("invalid value"));
+                stream_after_value(jp);
+                e->type=json_event_value;
+                r->next=q;
+                return true;
+        case S_DONE:
+                /* the next call starts another text */
+                jp->state=S_START;
+                e->type=json_event_end;
+                e->at=r->next=p;
+                return false;
+        default:
+                e->type=json_event_error;
+                e->at=p;
+                return false;
+        }
+}
+
+/* -- structural index (tape) -- */
+
+/* Stage one, json_scan_structurals(), lists the quotes, brackets, braces,
+ * colons and commas.  Stage two walks that list, checking the grammar and
+ * the tokens between, and writes an entry for each value and name and for
+ * each closing bracket.  While a container is open, the next of its entry
+ * holds the entry of the container around it.
+ */
+
+#define TAPE_NONE 0x0FFFFFFF /* no container open (next is 28 bits) */
+
+static bool tape_add(json_tape *t,int type,json_in p,uint32_t next) {
+        json_tapeentry *e;
+        if (t->used>=t->size) return false;
+        e=&t->entry[t->used++];
+        e->offset=p-t->text;
+        e->type=type;
+        e->next=next;
+        return true;
+}
+
+/* The string at p, which must run to the closing quote that is
+ * structural character i+1.
+ */
+static json_in tape_string(ctx *c,json_in s,json_in p,const uint32_t *index,size_t i,size_t n) {
+        json_nchar str;
+        json_in e;
+        if (i+1>=n) return NULL;
+        e=s+index[i+1]+1;
+        return (eat_string(c,p,e,&str,NULL)==e)?e:NULL;
+}
+
+bool json_tape_build(json_tape *t,const json_callbacks *ucb,const char *s,size_t len,
+        uint32_t *index,size_t nindex,json_tapeentry *entry,size_t nentries) {
+        superelement super={};
+        ctx *c=&super.root;
+        json_in p=s,q,e,end=s+len;
+        const char *err=NULL;
+        size_t i=0,n;
+        uint32_t open=TAPE_NONE,k;
+        int state=S_VALUE;
+        bool string;
+        char x;
+
+        setup(&super,ucb);
+        super.string=s;
+        super.end=end;
+        /* numbers are only checked here */
+        super.callbacks.options=json_option_lazy_numbers | (super.callbacks.options & json_option_validate_utf8);
+        t->text=s;
+        t->len=len;
+        t->entry=entry;
+        t->size=(nentries<TAPE_NONE)?nentries:TAPE_NONE;
+        t->used=0;
+        t->options=(ucb)?ucb->options:0;
+
+        if (len>UINT32_MAX) {
+                not_thing(c,GETTEXT("JSON"),s,s,GETTEXT("text too long"));
+                return false;
+        }
+        n=json_scan_structurals(s,end,index,nindex,&string);
+        if (n>nindex) {
+                not_thing(c,GETTEXT("JSON"),s,s,GETTEXT("index full"));
+                return false;
+        }
+        if (string) {
+                not_thing(c,GETTEXT("string"),s+index[n-1],end,GETTEXT("no closing quote"));
+                return false;
+        }
+
+        for(;;) {
+                p=eat_whitespace(p,end);
+                if (state==S_DONE) break;
+                if (p>=end) {err=GETTEXT("unexpected end"); break;}
+                /* the structural character at p, if any */
+                x=(i<n && s+index[i]==p)?*p:'\0';
+
+                if ((x=='}' && (state==S_NEXT || state==S_NAME_OR_CLOSE)) ||
+                    (x==']' && (state==S_NEXT || state==S_VALUE_OR_CLOSE))) {
+                        k=open;
+                        if ((entry[k].type==json_type_object)!=(x=='}')) {err=GETTEXT("mismatched bracket"); break;}
+                        if (!tape_add(t,entry[k].type,p,t->used+1)) {err=GETTEXT("tape full"); break;}
+                        open=entry[k].next;
+                        entry[k].next=t->used;
+                        i++;
+                        p++;
+                        state=(open==TAPE_NONE)?S_DONE:S_NEXT;
+                        continue;
+                }
+
+                switch(state) {
+                case S_NEXT:
+                        if (x!=',') {err=GETTEXT("comma or bracket missing"); break;}
+                        i++;
+                        p++;
+                        state=(entry[open].type==json_type_object)?S_NAME:S_VALUE;
+                        continue;
+                case S_COLON:
+                        if (x!=':') {err=GETTEXT("colon missing"); break;}
+                        i++;
+                        p++;
+                        state=S_VALUE;
+                        continue;
+                case S_NAME:
+                case S_NAME_OR_CLOSE:
+                        if (x!='\"' || !(q=tape_string(c,s,p,index,i,n))) {err=GETTEXT("bad name"); break;}
+                        if (!tape_add(t,json_type_string,p,t->used+1)) {err=GETTEXT("tape full"); break;}
+                        i+=2;
+                        p=q;
+                        state=S_COLON;
+                        continue;
+                case S_VALUE:
+                case S_VALUE_OR_CLOSE:
+                        if (x=='{' || x=='[') {
+                                k=t->used;
+                                if (!tape_add(t,(x=='{')?json_type_object:json_type_array,p,open)) {err=GETTEXT("tape full"); break;}
+                                open=k;
+                                i++;
+                                p++;
+                                state=(x=='{')?S_NAME_OR_CLOSE:S_VALUE_OR_CLOSE;
+                                continue;
+                        }
+                        if (x=='\"') {
+                                if (!(q=tape_string(c,s,p,index,i,n))) {err=GETTEXT("bad value"); break;}
+                                i+=2;
+                        }
+                        else {
+                                if (x) {err=GETTEXT("invalid value"); break;}
+                                /* a number or literal runs to the next structural character */
+                                e=(i<n)?s+index[i]:end;
+                                q=get_value(c,p,e);
+                                if (q!=e) {err=GETTEXT("invalid value"); break;}
+                        }
+                        if (!tape_add(t,c->value.type,p,t->used+1)) {err=GETTEXT("tape full"); break;}
+                        p=q;
+                        state=(open==TAPE_NONE)?S_DONE:S_NEXT;
+                        continue;
+                }
+                break;
+        }
+        if (!err && p<end) err=GETTEXT("junk after value");
+        if (err) {
+                not_thing(c,GETTEXT("JSON"),s,p,err);
+                return false;
+        }
+        return true;
+}
+
+json_cursor json_tape_cursor(const json_tape *t) {
+        json_cursor c={t,0,(uint32_t)t->used,false};
+        return c;
+}
+
+int json_cursor_type(const json_cursor *c) {
+        return c->tape->entry[c->at].type;
+}
+
+bool json_cursor_child(json_cursor *c) {
+        const json_tapeentry *e=&c->tape->entry[c->at];
+        uint32_t close=e->next-1;
+        if (e->type!=json_type_object && e->type!=json_type_array) return false;
+        if (c->at+1==close) return false; /* empty */
+        c->member=(e->type==json_type_object);
+        c->end=close;
+        c->at+=(c->member)?2:1;
+        return true;
+}
+
+bool json_cursor_next(json_cursor *c) {
+        uint32_t n=c->tape->entry[c->at].next;
+        if (n>=c->end) return false;
+        c->at=(c->member)?n+1:n;
+        return true;
+}
+
+bool json_cursor_name(const json_cursor *c,json_nchar *name) {
+        const json_tape *t=c->tape;
+        if (!c->member) return false;
+        eat_string(NULL,t->text+t->entry[c->at-1].offset,t->text+t->len,name,NULL);
+        return true;
+}
+
+/* Decode the value at entry k, which the tape has already checked. */
+static void tape_value(const json_tape *t,uint32_t k,json_value *v,int options) {
+        json_in s=t->text+t->entry[k].offset,end=t->text+t->len;
+        json_decimal d;
+
+        v->type=t->entry[k].type;
+        v->lazy=false;
+        switch(v->type) {
+        case json_type_string:
+                eat_string(NULL,s,end,&v->string,NULL);
+                break;
+        case json_type_number:
+                number_value(v,&d,s,json_scan_number(s,end,&d),options);
+                break;
+        case json_type_bool:
+                v->truefalse=(*s=='t');
+                break;
+        case json_type_object:
+        case json_type_array:
+                v->object=s;
+                break;
+        default:
+                break;
+        }
+}
+
+void json_cursor_value(const json_cursor *c,json_value *v) {
+        tape_value(c->tape,c->at,v,c->tape->options);
+}
+
+bool json_cursor_find(json_cursor *c,...) {
+        json_cursor at=*c;
+        const char *name;
+        json_nchar str;
+        bool found=true;
+        va_list ap;
+
+        va_start(ap,c);
+        while(found && (name=va_arg(ap,const char *))) {
+                found=false;
+                if (name[0]=='#') {
+                        char *e;
+                        long index=strtol(name+1,&e,0);
+                        if (e==name+1 || *e!='\0' || index<0) break;
+                        if (json_cursor_type(&at)!=json_type_array || !json_cursor_child(&at)) break;
+                        while(index>0 && json_cursor_next(&at)) index--;
+                        found=(index==0);
+                }
+                else {
+                        if (json_cursor_type(&at)!=json_type_object || !json_cursor_child(&at)) break;
+                        do {
+                                json_cursor_name(&at,&str);
+                                found=match_nchar(name,&str);
+                        } while(!found && json_cursor_next(&at));
+                }
+        }
+        va_end(ap);
+        if (found) *c=at;
+        return found;
+}
+
+static bool tape_walk(superelement *super,const json_tape *t,ctx *c,uint32_t k) {
+        ctx n={};
+        uint32_t i,close;
+        bool ok=true;
+
+        tape_value(t,k,&c->value,super->callbacks.options);
+        if (c->value.type!=json_type_object && c->value.type!=json_type_array)
+                return emit_value(super,c) && !super->stopped;
+        if (skip_wanted(super,c)) return !super->stopped;
+        if (!open_container(super,c) || super->stopped) return false;
+        n.prev=c;
+        n.root=c->root;
+        close=t->entry[k].next-1;
+        c->next=&n;
+        for(i=k+1;ok && i<close;i=t->entry[i].next) {
+                if (c->value.type==json_type_object) {
+                        eat_string(NULL,t->text+t->entry[i].offset,t->text+t->len,&n.name,NULL);
+                        name_key(&n);
+                        i++;
+                }
+                ok=tape_walk(super,t,&n,i);
+                n.index++;
+        }
+        c->next=NULL;
+        if (ok) close_container(super,c,t->text+t->entry[close].offset+1);
+        return ok && !super->stopped;
+}
+
+bool json_cursor_walk(const json_cursor *cur,const json_callbacks *ucb) {
+        superelement super={};
+        const json_tape *t=cur->tape;
+
+        setup(&super,ucb);
+        super.string=t->text;
+        super.end=t->text+t->len;
+        if (tape_walk(&super,t,&super.root,cur->at) || super.stopped) return true;
+        not_thing(&super.root,GETTEXT("JSON"),NULL,NULL,GETTEXT("too many query states"));
+        return false;
+}
+
 /* -- auxiliary functions -- */
 
 const json_valuecontext *json_printpath(const json_valuecontext *c) {
@@ -526,7 +1593,11 @@ void json_printvalue(const json_value *v) {
                 OUT("\"%.*s\"",v->string.n,v->string.s);
                 break;
         case json_type_number:
-                OUT("%g",v->number);
+                if (v->lazy) OUT("%.*s",v->lexeme.n,v->lexeme.s);
+                else OUT("%g",v->number);
+                break;
+        case json_type_integer:
+                OUT("%lld",(long long)v->integer);
                 break;
         default:
                 OUT("<%s %d>",GETTEXT("bad type"),v->type);
@@ -559,7 +1630,7 @@ bool json_matches_path(const json_valuecontext *c,...) {
 
                 name=va_arg(ap,const char *);
                 if (name==NULL && c==NULL) {result=true; break;} /* matched all */
-                if (!c) break;
+                if (!c || !name) break;
                 if (strcmp(name,"*")==0) continue; /* match any */
                 if (strcmp(name,"**")==0) {result=true; break;} /* match remainder */
                 if (name[0]=='#') /* match array */ {
@@ -579,19 +1650,186 @@ bool json_matches_path(const json_valuecontext *c,...) {
         return result;
 }
 
+size_t json_record_number(const json_valuecontext *c) {
+        superelement *super=getsuperelement(c);
+        return (super)?super->record:0;
+}
+
+int json_worker_number(const json_valuecontext *c) {
+        superelement *super=getsuperelement(c);
+        return (super)?super->worker:0;
+}
+
+void json_stop(const json_valuecontext *c) {
+        superelement *super=getsuperelement(c);
+        if (super) super->stopped=true;
+}
+
+/* Write code point cp (below 0x110000) at d as UTF-8. */
+static char *put_utf8(char *d,unsigned int cp) {
+        if (cp<0x80) *d++=cp;
+        else if (cp<0x800) {
+                *d++=0xC0 | cp>>6;
+                *d++=0x80 | (cp & 0x3F);
+        }
+        else if (cp<0x10000) {
+                *d++=0xE0 | cp>>12;
+                *d++=0x80 | ((cp>>6) & 0x3F);
+                *d++=0x80 | (cp & 0x3F);
+        }
+        else {
+                *d++=0xF0 | cp>>18;
+                *d++=0x80 | ((cp>>12) & 0x3F);
+                *d++=0x80 | ((cp>>6) & 0x3F);
+                *d++=0x80 | (cp & 0x3F);
+        }
+        return d;
+}
+
+/* Unescape [s,end) to d, stopping at a NUL.  The output is never longer
+ * than the input, so d may be s itself.  Runs with no escapes are moved
+ * whole (or left alone in place).  Returns the end of the output, or NULL
+ * on a bad escape.
+ */
+static char *unescape(char *d,json_in s,json_in end) {
+        json_in q;
+        unsigned int cp;
+        long u;
+
+        while(s<end) {
+                q=json_scan_string(s,end);
+                if (d!=s) memmove(d,s,q-s);
+                d+=q-s;
+                s=q;
+                if (s>=end || !*s) break;
+                if (*s!='\\') {*d++=*s++; continue;}
+                if (end-s<2) return NULL;
+                switch(s[1]) {
+                case '\"': /* fall through */
+                case '\\': /* fall through */
+                case '/': *d++=s[1]; break;
+
+                case 'b': *d++='\b'; break;
+                case 'f': *d++='\f'; break;
+                case 'n': *d++='\n'; break;
+                case 'r': *d++='\r'; break;
+                case 't': *d++='\t'; break;
+
+                case 'u':
+                        if (end-s<6 || (u=hex4(s+2))<0) return NULL;
+                        cp=u;
+                        s=low_surrogate(s+6,end,&cp);
+                        d=put_utf8(d,cp);
+                        continue;
+                default:
+                        return NULL;
+                }
+                s+=2;
+        }
+        return d;
+}
+
 size_t json_string_to_utf8(char *dest,size_t destlen,const json_nchar *in) {
         utf8_nchar result;
         json_in p,q,top;
+        char *d;
 
+        top = in->s + in->n;
+        if (dest && destlen>(size_t)in->n) {
+                /* room for any result, so no counting */
+                d=unescape(dest,in->s,top);
+                if (!d) return 0;
+                *d='\0';
+                return d-dest+1;
+        }
         result.s=dest;
         result.required=0;
         result.max=destlen;
-        top = in->s + in->n;
         for(p = in->s;p;p=q) {
-                if (!*p) break;
-                q=eat_char(p,top-p,&result);
+                if (p>=top || !*p) break;
+                q=eat_char(p,top,&result);
         }
         if (!p) return 0;
         append(&result,'\0');
         return result.required;
 }
+
+char *json_string_in_place(char *s,int *n) {
+        char *d=unescape(s,s,s+*n);
+        if (!d) return NULL;
+        *d='\0';
+        *n=d-s;
+        return s;
+}
+
+double json_value_to_double(const json_value *v) {
+        json_decimal d;
+        json_in e;
+
+        switch(v->type) {
+        case json_type_integer:
+                return (double)v->integer;
+        case json_type_number:
+                if (!v->lazy) return v->number;
+                e=v->lexeme.s+v->lexeme.n;
+                if (json_scan_number(v->lexeme.s,e,&d)!=e || d.badexp) return 0;
+                return json_decimal_to_double(&d,v->lexeme.s,e);
+        default:
+                return 0;
+        }
+}
+
+bool json_value_to_int64(const json_value *v,int64_t *out) {
+        json_decimal d;
+        json_in e;
+        double x;
+
+        switch(v->type) {
+        case json_type_integer:
+                *out=v->integer;
+                return true;
+        case json_type_number:
+                if (v->lazy) {
+                        /* exact, even beyond 2^53 */
+                        e=v->lexeme.s+v->lexeme.n;
+                        if (json_scan_number(v->lexeme.s,e,&d)!=e || d.badexp) return false;
+                        if (json_decimal_to_int64(&d,out)) return true;
+                        x=json_decimal_to_double(&d,v->lexeme.s,e);
+                }
+                else x=v->number;
+                if (!(x>=-9223372036854775808.0 && x<9223372036854775808.0)) return false;
+                if ((double)(int64_t)x!=x) return false;
+                *out=(int64_t)x;
+                return true;
+        default:
+                return false;
+        }
+}
+
+size_t json_value_to_decimal_string(char *dest,size_t destlen,const json_value *v) {
+        char tmp[32];
+        json_nchar text;
+
+        switch(v->type) {
+        case json_type_integer:
+                text.s=tmp;
+                text.n=snprintf(tmp,sizeof(tmp),"%lld",(long long)v->integer);
+                break;
+        case json_type_number:
+                if (v->lazy) text=v->lexeme;
+                else {
+                        /* enough digits to read back the same double */
+                        text.s=tmp;
+                        text.n=snprintf(tmp,sizeof(tmp),"%.17g",v->number);
+                }
+                break;
+        default:
+                return 0;
+        }
+        if (destlen>0) {
+                size_t n=((size_t)text.n<destlen)?(size_t)text.n:destlen-1;
+                memcpy(dest,text.s,n);
+                dest[n]='\0';
+        }
+        return text.n+1;
+}
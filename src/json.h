@@ -19,6 +19,11 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /* Somewhere inside the JSON string in memory. */
 typedef const char *json_in;
@@ -40,28 +45,103 @@ typedef struct {
                 json_type_string,
                 json_type_array,
                 json_type_object,
+                json_type_integer, /* only with json_option_integers */
         } type;
+        bool lazy; /* a json_type_number with only the lexeme set */
         union {
                 /* set if... */
                 bool truefalse;    /* ... json_type_bool */
                 double number;     /* ... json_type_number */
+                int64_t integer;   /* ... json_type_integer */
+                json_nchar lexeme; /* ... json_type_number, if lazy */
                 json_nchar string; /* ... json_type_string */
                 json_in object;    /* ... json_type_object (pointer to start) */
                 json_in array;     /* ... json_type_array (pointer to start) */
         };
 } json_value;
 
+/* Parser options, or'd together in json_callbacks.options. */
+enum {
+        /* Numbers with no fraction or exponent that fit in an int64_t are
+         * json_type_integer rather than json_type_number.
+         */
+        json_option_integers=1<<0,
+
+        /* Numbers are checked but not converted: json_type_number values
+         * are lazy, holding the text of the number, for the
+         * json_value_to_*() functions to convert if needed.  Integers are
+         * still json_type_integer if json_option_integers is also given.
+         */
+        json_option_lazy_numbers=1<<1,
+
+        /* Strings and names must be valid UTF-8: no stray continuation
+         * bytes, overlong forms, surrogates or code points above
+         * U+10FFFF.  The error callback is given the first bad byte.
+         * Strings in skipped containers are not checked.
+         */
+        json_option_validate_utf8=1<<2,
+
+        /* Stop the parse (see json_stop()) once every compiled query has
+         * matched.  Only for query sets whose paths can each match once:
+         * no "*", "**" or "#" steps, and no numeric JSON Pointer steps,
+         * and at most JSON_QUERY_ONCE of them.
+         */
+        json_option_stop_when_found=1<<3,
+};
+
+/* What the parser should do with an object or array: see enter() in
+ * json_callbacks.
+ */
+typedef enum {
+        json_action_descend, /* parse the contents */
+        json_action_skip,    /* pass over the contents */
+        json_action_stop,    /* stop the parse: see json_stop() */
+} json_action;
+
+/* How a parse ended: see json_parse_status(). */
+typedef enum {
+        json_status_done,    /* a complete text */
+        json_status_error,   /* reported through the error callback */
+        json_status_stopped, /* by json_stop(), or json_option_stop_when_found */
+} json_status;
+
 /* A list of the names that contain the value. */
 typedef struct json_valuecontext_s json_valuecontext;
 struct json_valuecontext_s {
         /* double-linked list from NULL<->superelement<->root<->next...<->NULL */
         json_valuecontext *prev,*next;
+        json_valuecontext *root; /* start of the list (the superelement) */
 
         json_nchar name;  /* name of the JSON entity, or NULL if an array */
         int index;        /* index into an JSON array, if name.s==NULL */
+        int key;          /* ID of the name among json_callbacks.keys, or 0 */
         json_value value; /* the value of the entity */
 };
 
+/* A compiled set of path queries: see json_query_init(). */
+typedef struct json_queries_s json_queries;
+
+/* A set of registered object names: see json_keys_init(). */
+typedef struct json_keys_s json_keys;
+
+/* Counts of what the parser did, added to by each parse given one in
+ * json_callbacks.stats.  Only filled in if the library is built with
+ * JSON_STATS defined; the times also need JSON_STATS_CYCLES, and are in
+ * the CPU's time stamp counter ticks (clock() ticks elsewhere).  The
+ * tape functions count what they see, but not bytes or time; the
+ * parallel parsers do not count.
+ */
+typedef struct {
+        size_t bytes;            /* of text parsed */
+        size_t values[8];        /* by json_value type, containers included */
+        int depth,maxdepth;      /* current and deepest nesting */
+        size_t escapes;          /* escape sequences in strings and names */
+        size_t numbers;          /* numbers converted to double or integer */
+        size_t callbacks;        /* calls to the caller's functions */
+        uint64_t callback_ticks; /* time spent in the caller's functions */
+        uint64_t parser_ticks;   /* time spent parsing, less the above */
+} json_stats;
+
 /* A set of user-provided callback functions. If functions are NULL,
  * then some suitable printing functions will be used: see the default
  * values for these functions in the main file.
@@ -84,15 +164,106 @@ typedef struct {
                 json_in hint,               /* position in element of error */
                 const char *msg,            /* description of error */
                 void *context);             /* user-supplied context */
+
+        /* compiled path queries, checked for every value (optional) */
+        json_queries *queries;
+
+        /* called when an object or array is found, before its contents
+         * (optional).  If it returns json_action_skip, the contents are
+         * passed over with no callbacks, only checking that the quotes and
+         * brackets balance.  json_action_stop stops the parse there.
+         */
+        json_action (*enter)(
+                const json_valuecontext *root, /* element chain */
+                const json_value *value,       /* the object or array */
+                void *context);                /* user-supplied context */
+
+        /* called at the start and end of each object or array that is
+         * parsed, empty or not (optional).  start is the opening bracket
+         * and end is just past the closing bracket.  The element chain
+         * ends with the container's own context.
+         */
+        void (*begin_object)(const json_valuecontext *root,json_in start,void *context);
+        void (*end_object)(const json_valuecontext *root,json_in start,json_in end,void *context);
+        void (*begin_array)(const json_valuecontext *root,json_in start,void *context);
+        void (*end_array)(const json_valuecontext *root,json_in start,json_in end,void *context);
+
+        /* json_option_* flags */
+        int options;
+
+        /* registered names, whose IDs are given in each context's key
+         * (optional)
+         */
+        const json_keys *keys;
+
+        /* counters to add to, if built with JSON_STATS (optional) */
+        json_stats *stats;
 } json_callbacks;
 
+/* Parser state.  The members are private: use json_parse(), or the
+ * json_parser_*() functions for input that arrives in pieces.
+ */
+typedef struct {
+        json_valuecontext root;   /* the top-level value */
+        json_callbacks callbacks;
+        int errcount;
+        bool stopped;             /* json_stop() was called */
+        json_in stop;             /* where the parse stopped */
+        json_in string;           /* start of the JSON text (or chunk) */
+        json_in end;              /* one past the end of the text (or chunk) */
+
+        /* resumable parser only */
+        json_valuecontext *stack; /* caller's context for each nesting level */
+        int depth,maxdepth;       /* current and maximum nesting */
+        char *buf;                /* caller's buffer for names and split tokens */
+        size_t buflen;            /* size of buf */
+        size_t keys;              /* bytes of buf holding the names in the path */
+        size_t used;              /* keys plus the split token */
+        json_in token;            /* start of the token in the chunk, or NULL if in buf */
+        int state;                /* what is expected next */
+        bool escape;              /* the chunk ended inside an escape */
+        bool whole;               /* the text is complete and stays put */
+        int skipdepth;            /* brackets open in a skipped container */
+        bool skipstring;          /* inside a string in a skipped container */
+
+        /* json_parse_lines() only */
+        size_t record;            /* line number of the text */
+        int worker;               /* thread calling back */
+} json_parser;
+
 /* -- utility functions -- */
 
 /* Convert a json_nchar string to UTF-8.
  * Returns required length of dest or 0 on error.
+ * A dest of in->n+1 bytes is always enough, and is filled fastest.
+ * Escaped surrogate pairs are joined into one character.
  */
 extern size_t json_string_to_utf8(char *dest,size_t destlen,const json_nchar *in);
 
+/* Convert the n bytes at s (the inside of a string, as in a json_nchar
+ * from a mutable copy of the text) to UTF-8 where they are, and
+ * NUL-terminate them.  The result is never longer, so the terminator goes
+ * at or before s[n], which for a parsed string is its closing quote.
+ * Sets *n to the new length and returns s, or NULL on a bad escape.
+ */
+extern char *json_string_in_place(char *s,int *n);
+
+/* Returns the value of a number (lazy or not) as a double, or 0 if the
+ * value is not a number.
+ */
+extern double json_value_to_double(const json_value *v);
+
+/* Returns true, setting *out, if the value is a whole number that fits in
+ * an int64_t.
+ */
+extern bool json_value_to_int64(const json_value *v,int64_t *out);
+
+/* Write a number as decimal text: a lazy number is copied unchanged.
+ * Returns required length of dest (including the NUL) or 0 if the value
+ * is not a number.
+ */
+extern size_t json_value_to_decimal_string(char *dest,size_t destlen,const json_value *v);
+
 /* Print the chain of path variables described by the context.
  * Returns the final (leaf) json_valuecontext.
  */
@@ -118,13 +289,655 @@ extern bool json_matches_index(const json_valuecontext *c,int index);
  */
 extern bool json_matches_path(const json_valuecontext *c,...);
 
+/* The line number (from 0) of the text holding c, in json_parse_lines(). */
+extern size_t json_record_number(const json_valuecontext *c);
+
+/* The worker thread (from 0) calling back for c, in json_parse_lines(). */
+extern int json_worker_number(const json_valuecontext *c);
+
+/* Called from a callback, stop the parse holding c once the callback
+ * returns, without reading the rest of the text or calling back again.
+ * The parse reports json_status_stopped, which is not an error.  In
+ * json_parse_lines() only the line holding c stops, and in
+ * json_parse_array() only the calling thread's share of the elements.
+ */
+extern void json_stop(const json_valuecontext *c);
+
+/* -- compiled path queries -- */
+
+/* A query set compiles many paths into one automaton that the parser
+ * advances as it enters and leaves objects and arrays, so the cost per
+ * value does not grow with the number of queries.  Each query has its own
+ * callback, called for every (non-container) value on its path.  If
+ * queries are given and got_value is NULL, other values are ignored.
+ *
+ * The query set also holds the match state, so can be used by one parse
+ * at a time.  Names in the paths must outlive the query set.  Each level
+ * of nesting takes one entry of JSON_QUERY_ACTIVE per node matching its
+ * path, so wildcard-heavy sets on deep texts may need it defined larger:
+ * a parse that runs out fails with the error "too many query states".
+ *
+ * Example:
+ *   json_querynode nodes[64];
+ *   json_queries q;
+ *   json_query_init(&q,nodes,64);
+ *   json_query_compile(&q,johnny5,NULL,"johnny","#5",NULL);
+ *   json_query_compile_pointer(&q,first_title,NULL,"/glossary/title");
+ *   json_callbacks cb={.queries=&q};
+ *   json_parse(&cb,text);
+ */
+
+#ifndef JSON_QUERY_ACTIVE
+#define JSON_QUERY_ACTIVE 32 /* query states live at once */
+#endif
+#ifndef JSON_QUERY_LEVELS
+#define JSON_QUERY_LEVELS 16 /* nesting levels with distinct query states */
+#endif
+#ifndef JSON_QUERY_ONCE
+#define JSON_QUERY_ONCE 32   /* queries json_option_stop_when_found can wait for */
+#endif
+
+/* One step of a path.  The members are private. */
+typedef struct {
+        int parent;            /* node this step leads from, or -1 if unused */
+        int kind;              /* type of step */
+        json_nchar name;       /* name to match... */
+        int index;             /* ...or array index to match */
+        int star,anyindex,rest; /* "*", "#" and "**" steps from here, or -1 */
+        void (*got_value)(const json_valuecontext *root,const json_value *value,void *context);
+        void *context;         /* for got_value */
+        int more;              /* another query ending here, or -1 */
+        void (*end)(const json_valuecontext *root,void *context); /* after each value here */
+        void *end_context;     /* for end */
+        int once;              /* bit in fired[] if a query here matches once, or -1 */
+} json_querynode;
+
+struct json_queries_s {
+        json_querynode *node;  /* caller's array of nodes, used as a hash table */
+        int size,used;         /* nodes in the array and in use */
+
+        /* match state while parsing */
+        int active[JSON_QUERY_ACTIVE]; /* nodes matching the path so far */
+        struct {
+                int start,count;      /* this level's nodes in active[] */
+                int repeat;           /* number of levels with the same nodes */
+        } level[JSON_QUERY_LEVELS];
+        int levels;            /* entries in level[] */
+
+        /* for json_option_stop_when_found */
+        int once,wild;         /* nodes ending queries that match once, and other queries */
+        int found;             /* of the once nodes, matched in this parse */
+        uint32_t fired[(JSON_QUERY_ONCE+31)/32]; /* which have */
+};
+
+/* Set up an empty query set in the caller's array of nodes.  Each query
+ * takes one node per step (fewer when paths share a prefix), and the array
+ * is kept at most three quarters full.
+ */
+extern void json_query_init(json_queries *q,json_querynode *nodes,int nnodes);
+
+/* Add a query for the path given as for json_matches_path(), finalized
+ * with NULL.  fn is called with context for each value on the path.
+ * Returns false if the path is invalid or longer than JSON_QUERY_LEVELS-2
+ * steps, or the node array is full.
+ */
+extern bool json_query_compile(json_queries *q,
+        void (*fn)(const json_valuecontext *root,const json_value *value,void *context),
+        void *context,...);
+
+/* As json_query_compile(), with the path as a JSON Pointer (RFC 6901)
+ * such as "/johnny/5".  A numeric step matches either an array index or
+ * an object name.
+ */
+extern bool json_query_compile_pointer(json_queries *q,
+        void (*fn)(const json_valuecontext *root,const json_value *value,void *context),
+        void *context,const char *pointer);
+
+/* -- struct binding -- */
+
+/* A binding table says which paths go into which fields of a C struct,
+ * so that a parse fills the struct without a hand-written callback.  The
+ * paths are compiled into a query set, so the cost per value does not
+ * grow with the number of fields.  An array binding fills an array of
+ * structs (or of plain values), each element bound by its own table with
+ * paths relative to the element; an empty path binds the element itself.
+ *
+ * Example:
+ *   typedef struct {int32_t id; char name[16];} user;
+ *   typedef struct {double version; user users[8]; size_t nusers;} doc;
+ *   static const json_binding users[]={
+ *           {.path={"id"},.offset=offsetof(user,id),.type=json_bind_int32,.required=true},
+ *           {.path={"name"},.offset=offsetof(user,name),.type=json_bind_string,.size=16},
+ *   };
+ *   static const json_binding fields[]={
+ *           {.path={"version"},.offset=offsetof(doc,version),.type=json_bind_double},
+ *           {.path={"users"},.offset=offsetof(doc,users),.type=json_bind_array,
+ *                   .size=sizeof(user),.fields=users,.nfields=2,.max=8,
+ *                   .count=offsetof(doc,nusers)},
+ *   };
+ *   json_querynode nodes[32];
+ *   json_binder b;
+ *   doc d;
+ *   json_bind_init(&b,fields,2,nodes,32);
+ *   if (!json_bind_parse(&b,NULL,&d,text,len)) ... b.bad is the culprit
+ */
+
+#ifndef JSON_BIND_STEPS
+#define JSON_BIND_STEPS 8   /* steps in a binding's path */
+#endif
+#ifndef JSON_BIND_FIELDS
+#define JSON_BIND_FIELDS 32 /* bindings in a binder, counting array elements' */
+#endif
+
+typedef enum {
+        json_bind_int32,  /* int32_t, from a whole number in range */
+        json_bind_int64,  /* int64_t, from a whole number in range */
+        json_bind_double, /* double, from a number */
+        json_bind_bool,   /* bool, from true or false */
+        json_bind_string, /* char[size], UTF-8 with a terminating NUL */
+        json_bind_array,  /* elements size bytes apart, bound by fields */
+} json_bindtype;
+
+typedef struct json_binding_s {
+        const char *path[JSON_BIND_STEPS]; /* as for json_matches_path(), NULL ended if short */
+        size_t offset;      /* of the field in the struct */
+        json_bindtype type;
+        size_t size;        /* bytes in a string, or between array elements */
+        bool required;      /* in every element around it; arrays: not empty */
+
+        /* arrays only */
+        const struct json_binding_s *fields; /* each element's bindings */
+        int nfields;
+        size_t max;         /* elements room in the array */
+        size_t count;       /* offset of a size_t set to the number of elements */
+} json_binding;
+
+typedef struct json_binder_s json_binder;
+
+/* One binding, ready to use.  The members are private. */
+typedef struct {
+        const json_binding *binding;
+        json_binder *binder;
+        int array;          /* slot of the array around it, or -1 */
+        int depth;          /* arrays: steps from the top to an element */
+        bool seen;          /* stored (arrays: an element ended) in this element */
+} json_bindslot;
+
+struct json_binder_s {
+        json_queries queries;
+        json_bindslot slot[JSON_BIND_FIELDS];
+        int slots;
+        char *out;          /* the struct being filled */
+
+        /* after json_bind_parse(), the first binding that was missing, got
+         * a value of the wrong type or one too big, or NULL
+         */
+        const json_binding *bad;
+};
+
+/* Compile the count bindings in table into the caller's array of query
+ * nodes.  The table must outlive the binder.  Returns false if a path is
+ * invalid (an array's path may not hold "**", nor be another array's), or
+ * the nodes or slots run out.
+ */
+extern bool json_bind_init(json_binder *b,const json_binding *table,int count,
+        json_querynode *nodes,int nnodes);
+
+/* Parse the len byte text into the struct at out.  Fields without a value,
+ * or with null, are left alone, but array counts start at zero and count
+ * every element, even one with nothing bound in it.  Only
+ * errors, options, context and stats are used from cb, and numbers are
+ * always lazy (so int64s are exact).  Returns as json_parse_n(), or NULL,
+ * setting b->bad, if a binding failed.
+ */
+extern const char *json_bind_parse(json_binder *b,const json_callbacks *cb,void *out,
+        const char *json_string,size_t len);
+
+/* -- structural index (tape) -- */
+
+/* A tape indexes a whole text once, so that it can be read many times
+ * without rescanning.  Building it takes two passes: the first finds the
+ * quotes, brackets, braces, colons and commas (using SIMD where
+ * available), the second checks the grammar and writes the tape.  The
+ * tape holds one entry for each value, for each name in an object, and
+ * for each closing bracket.  Each entry links to the one after its value,
+ * so whole objects and arrays are stepped over at once.  Strings and
+ * numbers are decoded from the text when asked for, so the text must stay
+ * put while the tape is used.
+ *
+ * Example:
+ *   json_tapeentry entries[4096];
+ *   uint32_t index[4096];
+ *   json_tape t;
+ *   json_cursor c;
+ *   json_value v;
+ *   if (json_tape_build(&t,NULL,text,len,index,4096,entries,4096)) {
+ *           c=json_tape_cursor(&t);
+ *           if (json_cursor_find(&c,"johnny","#5",NULL)) json_cursor_value(&c,&v);
+ *           json_cursor_walk(&c,&cb);
+ *   }
+ */
+
+/* One entry of a tape. */
+typedef struct {
+        uint32_t offset;  /* start of the token in the text */
+        uint32_t type:4;  /* json_type_*: names are json_type_string */
+        uint32_t next:28; /* the entry after this value and its contents */
+} json_tapeentry;
+
+typedef struct {
+        json_in text;           /* the text, which must stay put */
+        size_t len;
+        json_tapeentry *entry;  /* caller's array */
+        size_t size,used;       /* entries in the array and in use */
+        int options;            /* json_option_* for json_cursor_value() */
+} json_tape;
+
+/* A position on a tape.  The members are private. */
+typedef struct {
+        const json_tape *tape;
+        uint32_t at;      /* entry of the value */
+        uint32_t end;     /* entry that closes the container around it */
+        bool member;      /* the value is in an object (its name is at at-1) */
+} json_cursor;
+
+/* Build a tape of the len byte text in the caller's arrays.  index needs
+ * a slot for each quote, bracket, brace, colon and comma; entries needs one
+ * for each value, name and closing bracket.  Neither needs more than len+1.
+ * Only errors and options are used from cb.  Returns false if the text is
+ * not a single JSON value, the text is over 4GB, or an array is too small.
+ */
+extern bool json_tape_build(json_tape *t,const json_callbacks *cb,const char *json_string,
+        size_t len,uint32_t *index,size_t nindex,json_tapeentry *entries,size_t nentries);
+
+/* A cursor at the top-level value of a tape. */
+extern json_cursor json_tape_cursor(const json_tape *t);
+
+/* The json_type_* of the value at the cursor. */
+extern int json_cursor_type(const json_cursor *c);
+
+/* Move to the first value in the object or array at the cursor.
+ * Returns false if there is none.
+ */
+extern bool json_cursor_child(json_cursor *c);
+
+/* Move to the next value in the same object or array, stepping over the
+ * contents of the current one.  Returns false if there is none.
+ */
+extern bool json_cursor_next(json_cursor *c);
+
+/* Returns true, setting name, if the value at the cursor is in an object. */
+extern bool json_cursor_name(const json_cursor *c,json_nchar *name);
+
+/* Decode the value at the cursor, as a parse with the options the tape
+ * was built with would.  Objects and arrays give their type and start.
+ */
+extern void json_cursor_value(const json_cursor *c,json_value *v);
+
+/* Move down the path given as element names and "#nnn" array indexes,
+ * finalized with NULL, as for json_matches_path() but without wildcards.
+ * Returns false, leaving the cursor alone, if the path is not there.
+ */
+extern bool json_cursor_find(json_cursor *c,...);
+
+/* Call back for the value at the cursor and everything in it, as
+ * json_parse() would for a text holding only that value.  Objects and
+ * arrays skipped by enter() cost nothing.  Returns false if the query
+ * state does not fit.
+ */
+extern bool json_cursor_walk(const json_cursor *c,const json_callbacks *cb);
+
+/* -- document tree (DOM) -- */
+
+/* For random access, json_dom_parse() builds a tree of the whole text in
+ * a caller-supplied arena, with no other allocation: strings and names
+ * stay slices of the text, which must stay put.  Objects with at least
+ * JSON_DOM_HASH_MIN members get a hash index, so looking up a name does
+ * not search them, and arrays that long get a vector of their elements.
+ * The whole tree is freed by resetting the arena.
+ *
+ * Example:
+ *   static char mem[1<<20];
+ *   json_arena a;
+ *   json_arena_init(&a,mem,sizeof(mem));
+ *   json_node *root=json_dom_parse(&a,NULL,text,len);
+ *   json_node *n=json_dom_index(json_dom_get(root,"johnny"),5);
+ *   ...
+ *   json_arena_reset(&a);
+ */
+
+#ifndef JSON_DOM_HASH_MIN
+#define JSON_DOM_HASH_MIN 8
+#endif
+
+/* A bump allocator over the caller's memory. */
+typedef struct {
+        char *base;
+        size_t size,used;
+} json_arena;
+
+typedef struct json_node_s json_node;
+
+/* The contents of an object or array.  The members are private. */
+typedef struct {
+        json_node *first,*last;
+        json_node *parent;   /* the container around, while parsing */
+        int count;
+        int hashsize;        /* slots in hash, or 0 if none */
+        json_node **hash;    /* an object's names hashed, or an array in order */
+} json_nodelist;
+
+struct json_node_s {
+        json_value value;    /* objects and arrays hold their start */
+        json_nchar name;     /* name in an object, or s==NULL */
+        json_node *next;     /* next in the same object or array */
+        json_nodelist *list; /* contents of an object or array, else NULL */
+};
+
+extern void json_arena_init(json_arena *a,void *mem,size_t size);
+
+/* Returns n bytes aligned for any node, or NULL if the arena is full. */
+extern void *json_arena_alloc(json_arena *a,size_t n);
+
+/* Free everything allocated from the arena. */
+extern void json_arena_reset(json_arena *a);
+
+/* Build the tree of the len byte text in the arena.  Only errors and
+ * options are used from cb.  Returns the top-level node, or NULL on error
+ * or if the arena is full.
+ */
+extern json_node *json_dom_parse(json_arena *a,const json_callbacks *cb,
+        const char *json_string,size_t len);
+
+/* Returns the member of an object with the given name, or NULL. */
+extern json_node *json_dom_get(const json_node *object,const char *name);
+
+/* Returns the element of an array at index, or NULL. */
+extern json_node *json_dom_index(const json_node *array,int index);
+
+/* Returns the first member or element of an object or array, or NULL.
+ * The rest follow through next.
+ */
+extern json_node *json_dom_first(const json_node *n);
+
+/* Returns the number of members or elements of an object or array. */
+extern int json_dom_count(const json_node *n);
+
+/* -- registered keys -- */
+
+/* Callers that know the object names they care about can register them,
+ * so that each context's key holds a small integer ID for its name: 1 for
+ * the first name registered, 2 for the next, and so on, with 0 for other
+ * names and for array elements.  Callbacks can then switch on the key
+ * instead of comparing strings.  The names are found with a perfect hash,
+ * so each costs one hash and one comparison.  As with json_matches_name(),
+ * names are compared as they are written, escapes and all.
+ *
+ * Example:
+ *   enum {K_OTHER,K_ID,K_NAME};
+ *   static const char *names[]={"id","name"};
+ *   int slots[8];
+ *   json_keys k;
+ *   json_keys_init(&k,names,2,slots,8);
+ *   json_callbacks cb={.got_value=fn,.keys=&k};
+ */
+
+struct json_keys_s {
+        const char *const *names; /* caller's names, which must outlive the set */
+        int count;
+        int *slot;         /* caller's array: the ID hashed to each slot, or 0 */
+        int bits;          /* log2 of the slots in use */
+        unsigned int seed; /* multiplier that separates the names */
+        bool full;         /* hash every byte of the name, not just a few */
+};
+
+/* Build a perfect hash of count different names into the caller's array
+ * of nslots slots.  A few slots per name make a hash easier to find.
+ * Returns false if none is found.
+ */
+extern bool json_keys_init(json_keys *k,const char *const *names,int count,int *slots,int nslots);
+
+/* Returns the ID of the name, or 0 if it was not registered. */
+extern int json_key_id(const json_keys *k,const json_nchar *name);
+
+/* -- writer -- */
+
+/* Writes JSON text into the caller's buffer, adding the commas and colons.
+ * When the buffer is full, flush() is given its contents to send on, or
+ * grow() is asked to make it bigger (with realloc(), say); with neither,
+ * writing stops there.  The text not yet flushed is buf[0..used).
+ *
+ * Example:
+ *   json_writer w;
+ *   json_writer_init(&w,buf,sizeof(buf));
+ *   w.flush=send;
+ *   w.context=sock;
+ *   json_write_begin_object(&w);
+ *   json_write_key(&w,"id",2);
+ *   json_write_integer(&w,42);
+ *   json_write_end_object(&w);
+ *   ok=json_writer_finish(&w);
+ */
+
+typedef struct json_writer_s json_writer;
+
+struct json_writer_s {
+        char *buf;
+        size_t size;              /* of buf */
+        size_t used;              /* bytes written to buf and not flushed */
+        /* send s on; returns false to stop writing */
+        bool (*flush)(const char *s,size_t n,void *context);
+        /* make room for at least need more bytes in buf, changing buf and
+         * size; returns false to stop writing
+         */
+        bool (*grow)(json_writer *w,size_t need,void *context);
+        void *context;
+        bool comma;               /* the next value or name needs a comma */
+        bool failed;              /* out of room, or flush() or grow() failed */
+};
+
+/* Start writing into buf, with no flush() or grow(). */
+extern void json_writer_init(json_writer *w,char *buf,size_t size);
+
+extern void json_write_begin_object(json_writer *w);
+extern void json_write_end_object(json_writer *w);
+extern void json_write_begin_array(json_writer *w);
+extern void json_write_end_array(json_writer *w);
+
+/* The name of the next member of an object. */
+extern void json_write_key(json_writer *w,const char *s,size_t n);
+
+/* Quotes, backslashes and control characters are escaped; other bytes,
+ * which should be UTF-8, are copied.
+ */
+extern void json_write_string(json_writer *w,const char *s,size_t n);
+
+/* The shortest digits that read back as x, for all but a few in a
+ * thousand (never too few).  NaN and infinities are written as null.
+ */
+extern void json_write_number(json_writer *w,double x);
+extern void json_write_integer(json_writer *w,int64_t x);
+extern void json_write_bool(json_writer *w,bool b);
+extern void json_write_null(json_writer *w);
+
+/* A value from the parser, as it was in the text where it can be:
+ * strings keep their escapes and lazy numbers their digits.  Not for
+ * objects and arrays.
+ */
+extern void json_write_value(json_writer *w,const json_value *v);
+
+/* flush() what is left.  Returns true if everything was written. */
+extern bool json_writer_finish(json_writer *w);
+
 /* -- main parser function -- */
 
 /* Parse a JSON text object with optional callback functions.
  * Returns a pointer to the character after the JSON object/array/value, or
- * NULL on error.
+ * NULL on error.  If the parse was stopped, returns where it stopped.
  * If cb or the entries in cb are NULL, printing callbacks will be used.
  */
 extern const char *json_parse(const json_callbacks *cb,const char *json_string);
 
+/* As json_parse(), but for a text of len bytes that need not be
+ * NUL-terminated, such as a read-only mmap'd file or a slice of a larger
+ * buffer.  Nothing at or beyond json_string+len is read.
+ */
+extern const char *json_parse_n(const json_callbacks *cb,const char *json_string,size_t len);
+
+/* As json_parse_n(), telling a stopped parse from a complete one.  end,
+ * if not NULL, is set to what json_parse_n() would return.
+ */
+extern json_status json_parse_status(const json_callbacks *cb,const char *json_string,size_t len,
+        const char **end);
+
+#ifndef ARDUINO
+
+/* -- parallel parsing -- */
+
+#ifndef JSON_THREADS_MAX
+#define JSON_THREADS_MAX 64
+#endif
+
+/* Parse a buffer of newline-separated JSON texts (JSON Lines, NDJSON)
+ * using nthreads threads, or one per processor if nthreads is 0.  The
+ * buffer is cut into pieces at newlines, and each thread parses whole
+ * pieces with its own parser state, so the callbacks are called from
+ * several threads at once and must be thread-safe: json_worker_number()
+ * tells them which thread is calling, e.g. to pick a per-thread result,
+ * and json_record_number() gives the line of the text, to put results back
+ * in order.  Each thread takes its own copy of the query match state.
+ * Blank lines are ignored, and each other line must hold one text.
+ * Returns false if any line is in error (the rest are still parsed).
+ */
+extern bool json_parse_lines(const json_callbacks *cb,const char *text,size_t len,int nthreads);
+
+/* Parse a text holding one big array, such as an export of records, with
+ * its elements shared among nthreads threads (or one per processor if
+ * nthreads is 0).  The element contexts have their index as usual, so "#n"
+ * paths match.  The splits between elements are found by a fast parallel
+ * pass over the text for brackets, commas and quotes; any other text is
+ * parsed on one thread.  The array's own callbacks (enter, begin_array,
+ * end_array) are called from the calling thread, before and after the
+ * rest.  Returns false on error.
+ */
+extern bool json_parse_array(const json_callbacks *cb,const char *text,size_t len,int nthreads);
+
+#endif
+
+/* -- resumable parser -- */
+
+/* A resumable parser takes the JSON text in chunks of any size, split
+ * anywhere (even inside a token), and calls the same callbacks with the
+ * same contexts as json_parse().  It does not use the C stack to track
+ * nesting: the caller supplies one json_valuecontext per nesting level
+ * and a buffer that holds the names on the current path plus any token
+ * split across chunks.  Strings passed to callbacks may point into that
+ * buffer, so are only valid during the callback.  The start of an object
+ * or array that began in an earlier chunk is NULL.
+ *
+ * Chunks need not outlive json_parser_feed().  A stream may hold several
+ * whitespace-separated JSON texts, e.g. JSON Lines.
+ *
+ * Example:
+ *   json_valuecontext stack[32];
+ *   char buf[1024];
+ *   json_parser jp;
+ *   json_parser_init(&jp,&cb,stack,32,buf,sizeof(buf));
+ *   while((n=read(fd,chunk,sizeof(chunk)))>0)
+ *           if (!json_parser_feed(&jp,chunk,n)) break;
+ *   ok=json_parser_finish(&jp);
+ */
+
+/* Set up a parser.  If cb or the entries in cb are NULL, printing callbacks
+ * will be used.  Nesting deeper than maxdepth is an error.
+ */
+extern void json_parser_init(json_parser *jp,const json_callbacks *cb,
+        json_valuecontext *stack,int maxdepth,char *buf,size_t buflen);
+
+/* Parse the next len bytes of text.  Returns false on error, or once the
+ * parse is stopped, after which the parser ignores further input.
+ */
+extern bool json_parser_feed(json_parser *jp,const char *chunk,size_t len);
+
+/* Returns true if the parse was stopped, so needs no more input. */
+extern bool json_parser_stopped(const json_parser *jp);
+
+/* Signal the end of the text.  Returns true if the text was complete, or
+ * the parse was stopped.
+ */
+extern bool json_parser_finish(json_parser *jp);
+
+/* As json_parse_n(), but without recursion: nesting is kept in the
+ * caller's stack array (one json_valuecontext per level) rather than on
+ * the C stack, so hostile or very deep input cannot overflow the C stack.
+ * Nesting deeper than maxdepth is reported as an error.  Names and strings
+ * point into the text, as with json_parse().
+ */
+extern const char *json_parse_stack(const json_callbacks *cb,const char *json_string,size_t len,
+        json_valuecontext *stack,int maxdepth);
+
+/* -- pull reader -- */
+
+/* A reader hands back the text one event at a time, for callers that
+ * would rather loop than be called back.  Like json_parse_stack(), it
+ * keeps nesting in the caller's stack array, and names and strings point
+ * into the text.
+ *
+ * Example:
+ *   json_valuecontext stack[32];
+ *   json_reader r;
+ *   json_event e;
+ *   json_reader_init(&r,NULL,text,len,stack,32);
+ *   while(json_next(&r,&e)) {
+ *           if (e.type==json_event_value && json_matches_path(e.path,"id",NULL)) ...
+ *   }
+ *   ok=(e.type==json_event_end);
+ */
+
+typedef enum {
+        json_event_end,          /* the value is complete */
+        json_event_error,        /* reported through the error callback */
+        json_event_value,        /* a string, number, bool or null */
+        json_event_key,          /* an object name, before its value */
+        json_event_begin_object,
+        json_event_end_object,
+        json_event_begin_array,
+        json_event_end_array,
+} json_event_type;
+
+typedef struct {
+        json_event_type type;
+        int depth;                        /* containers around the element */
+        const json_valuecontext *path;    /* element chain, as given to got_value() */
+        const json_valuecontext *element; /* its name or index, and value */
+        json_in at;                       /* the start of the token, or for
+                                           * json_event_end where reading
+                                           * stopped */
+} json_event;
+
+/* Reader state.  The members are private. */
+typedef struct {
+        json_parser parser;
+        json_in next;
+} json_reader;
+
+/* Set up a reader of the text [s,s+len).  Only the options, keys and
+ * error function of cb are used; if cb or its error function is NULL,
+ * errors are printed.  Nesting deeper than maxdepth is an error.
+ */
+extern void json_reader_init(json_reader *r,const json_callbacks *cb,const char *s,size_t len,
+        json_valuecontext *stack,int maxdepth);
+
+/* Read the next event into e.  Returns false, with e->type
+ * json_event_end or json_event_error, when there are no more.  Reading
+ * stops after each complete value (and any whitespace after it); if
+ * e->at is not the end of the text, calling again reads the next value,
+ * as for JSON Lines.
+ */
+extern bool json_next(json_reader *r,json_event *e);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,157 @@
+/* > json.hpp */
+/* (C) Daniel F. Smith, 2019 */
+/* SPDX-License-Identifier: LGPL-3.0-only */
+
+/* C++17 front end: handlers are lambdas and paths are constants, so each
+ * set of handlers gets its own parse loop, with the path tests compiled
+ * in rather than looked up through json_callbacks and varargs.
+ *
+ * Example:
+ *   using namespace stack_json;
+ *   constexpr auto johnny5=path("johnny",idx<5>);
+ *   parse(text,on(johnny5,[](const json_value &v) {...}),
+ *              on(path("#","id"),[&](const json_value &v) {...}));
+ *
+ * A path is as for json_matches_path(): names, "#n" or idx<n> for an
+ * array index, and "#", "*" and "**" for any index, any element and
+ * anything below.  Every handler whose path matches a value is
+ * called, in order.  The text is read with the pull reader.
+ */
+
+#ifndef STACK_JSON_HPP
+#define STACK_JSON_HPP
+
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include "json.h"
+
+namespace stack_json {
+
+/* -- paths -- */
+
+/* One element of a path, worked out when compiling. */
+struct step {
+        enum kind {name,index,any_index,any,rest} k;
+        std::string_view s;
+        int i;
+};
+
+/* A name, "#", "#n", "*" or "**", as json_matches_path() takes them. */
+constexpr step element(const char *s) {
+        std::string_view v(s);
+        if (v=="*") return step{step::any,{},0};
+        if (v=="**") return step{step::rest,{},0};
+        if (v.size()>0 && v[0]=='#') {
+                int i=0;
+                if (v.size()==1) return step{step::any_index,{},0};
+                for(size_t k=1;k<v.size();k++) i=i*10+(v[k]-'0');
+                return step{step::index,{},i};
+        }
+        return step{step::name,v,0};
+}
+constexpr step element(int i) {return step{step::index,{},i};}
+constexpr step element(step s) {return s;}
+
+/* An array index, as in path("johnny",idx<5>). */
+template<int N> constexpr step idx{step::index,{},N};
+
+template<size_t N> struct path_t {
+        step steps[(N)?N:1]; /* path() is the top value */
+
+        /* Matches the value at the end of the chain, depth deep. */
+        bool matches(const json_valuecontext *root,int depth) const {
+                const json_valuecontext *c=root->next;
+                if (N>0 && steps[(N)?N-1:0].k==step::rest) {
+                        /* "**" needs something to match */
+                        if (depth<(int)N) return false;
+                }
+                else if (depth!=(int)N) return false;
+                for(size_t k=0;k<N;k++,c=c->next) {
+                        const step &p=steps[k];
+                        switch(p.k) {
+                        case step::name:
+                                if (!c->name.s || (size_t)c->name.n!=p.s.size()) return false;
+                                if (std::memcmp(c->name.s,p.s.data(),p.s.size())!=0) return false;
+                                break;
+                        case step::index:
+                                if (c->name.s || c->index!=p.i) return false;
+                                break;
+                        case step::any_index:
+                                if (c->name.s) return false;
+                                break;
+                        case step::any:
+                                break;
+                        case step::rest:
+                                return true;
+                        }
+                }
+                return true;
+        }
+};
+
+template<class... A> constexpr path_t<sizeof...(A)> path(A... a) {
+        return path_t<sizeof...(A)>{{element(a)...}};
+}
+
+/* -- handlers -- */
+
+template<class P,class F> struct handler_t {
+        P path;
+        F f;
+};
+
+/* Call f(const json_value &) for each value at path p, or
+ * f(const json_valuecontext *root,const json_value &) to see the path.
+ * f may return bool: false stops the parse.
+ */
+template<class P,class F> constexpr handler_t<P,F> on(P p,F f) {
+        return handler_t<P,F>{p,f};
+}
+
+/* Returns false if f wants to stop. */
+template<class F,class... A> inline bool call(F &f,A... a) {
+        if constexpr (std::is_void_v<std::invoke_result_t<F &,A...>>) {
+                f(a...);
+                return true;
+        }
+        else return f(a...);
+}
+
+template<class P,class F> inline bool dispatch(const json_event &e,handler_t<P,F> &h) {
+        if (!h.path.matches(e.path,e.depth)) return true;
+        if constexpr (std::is_invocable_v<F &,const json_valuecontext *,const json_value &>)
+                return call<F,const json_valuecontext *,const json_value &>(h.f,e.path,e.element->value);
+        else return call<F,const json_value &>(h.f,e.element->value);
+}
+
+/* Parse the text, calling the handlers for each value.  cb, if given,
+ * supplies options, registered keys and the error function.  Depth is
+ * the deepest nesting allowed.  Returns false on error, but not when a
+ * handler stopped the parse.
+ */
+template<int Depth=64,class... H> bool parse(const json_callbacks *cb,const char *s,size_t len,H... handlers) {
+        json_valuecontext stack[Depth];
+        json_reader r;
+        json_event e;
+
+        json_reader_init(&r,cb,s,len,stack,Depth);
+        do {
+                while(json_next(&r,&e)) {
+                        if (e.type!=json_event_value) continue;
+                        /* every handler runs, in order, then any may stop */
+                        bool go=true;
+                        ((go=dispatch(e,handlers) && go),...);
+                        if (!go) return true;
+                }
+        } while(e.type==json_event_end && e.at<s+len);
+        return e.type==json_event_end;
+}
+
+template<int Depth=64,class... H> bool parse(std::string_view text,H... handlers) {
+        return parse<Depth>(nullptr,text.data(),text.size(),handlers...);
+}
+
+}
+
+#endif